@@ -0,0 +1,632 @@
+/**
+ * @file bench_compare.c
+ * @brief Compara dois resultados JSON de benchmark e falha em regressões significativas.
+ *
+ * Lê um resultado de referência (baseline) e um resultado atual no formato do
+ * bench_rsa (lista "metrics" com nome, unidade, sentido da melhoria, mediana,
+ * MAD e amostras), imprime uma tabela com a diferença de cada métrica e termina
+ * com código diferente de zero se alguma piorar além do ruído medido.
+ *
+ * O limite de ruído de cada métrica vem das suas próprias repetições: k desvios
+ * robustos (1,4826 * MAD, o equivalente ao desvio padrão para ruído normal) da
+ * mais ruidosa das duas execuções, nunca abaixo de uma variação relativa mínima.
+ *
+ * Compilação: gcc -O2 -o bench_compare bench_compare.c
+ *
+ * Autor: Yan Tavares e Eduardo Marques
+ * Disciplina: CIC0201 - Segurança Computacional
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// --- Constantes ---
+#define DEFAULT_SIGMAS 3.0       // Desvios robustos que uma diferença precisa superar
+#define DEFAULT_MIN_CHANGE 0.05  // Variação relativa mínima considerada (5%)
+#define MAD_TO_SIGMA 1.4826      // MAD -> desvio padrão para ruído normal
+#define EXIT_NO_REGRESSION 0
+#define EXIT_REGRESSION 1
+#define EXIT_BAD_INPUT 2
+
+// --- Leitor de JSON ---
+//
+// Leitor mínimo, suficiente para os resultados dos benchmarks: objetos, listas,
+// strings (com escapes), números, true, false e null.
+
+typedef enum
+{
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} json_type;
+
+typedef struct json_value
+{
+    json_type type;
+    double number;            // JSON_NUMBER e JSON_BOOL
+    char *string;             // JSON_STRING
+    struct json_value *items; // Elementos (JSON_ARRAY) ou valores (JSON_OBJECT)
+    char **keys;              // Chaves (JSON_OBJECT)
+    size_t count;
+} json_value;
+
+typedef struct
+{
+    const char *p;
+    const char *end;
+} json_parser;
+
+static int json_parse_value(json_parser *ps, json_value *out);
+
+/**
+ * @brief Libera a árvore de um valor JSON.
+ */
+static void json_free(json_value *v)
+{
+    for (size_t i = 0; i < v->count; i++)
+    {
+        json_free(&v->items[i]);
+        if (v->keys)
+            free(v->keys[i]);
+    }
+    free(v->items);
+    free(v->keys);
+    free(v->string);
+    memset(v, 0, sizeof(*v));
+}
+
+static void json_skip_space(json_parser *ps)
+{
+    while (ps->p < ps->end && (*ps->p == ' ' || *ps->p == '\t' || *ps->p == '\n' || *ps->p == '\r'))
+        ps->p++;
+}
+
+/**
+ * @brief Lê uma string JSON; \\uXXXX é convertido para UTF-8 (sem pares substitutos).
+ * @return String alocada com malloc, ou NULL se for inválida.
+ */
+static char *json_parse_string(json_parser *ps)
+{
+    if (ps->p >= ps->end || *ps->p != '"')
+        return NULL;
+    ps->p++;
+    char *out = malloc(ps->end - ps->p + 1);
+    size_t n = 0;
+    while (out && ps->p < ps->end && *ps->p != '"')
+    {
+        char c = *ps->p++;
+        if (c != '\\')
+        {
+            out[n++] = c;
+            continue;
+        }
+        if (ps->p >= ps->end)
+            break;
+        c = *ps->p++;
+        switch (c)
+        {
+        case 'b':
+            out[n++] = '\b';
+            break;
+        case 'f':
+            out[n++] = '\f';
+            break;
+        case 'n':
+            out[n++] = '\n';
+            break;
+        case 'r':
+            out[n++] = '\r';
+            break;
+        case 't':
+            out[n++] = '\t';
+            break;
+        case 'u':
+        {
+            unsigned cp = 0;
+            for (int i = 0; i < 4 && ps->p < ps->end; i++)
+            {
+                char h = *ps->p++;
+                cp = cp * 16 + (h >= '0' && h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+            }
+            if (cp < 0x80)
+                out[n++] = (char)cp;
+            else if (cp < 0x800)
+            {
+                out[n++] = (char)(0xC0 | (cp >> 6));
+                out[n++] = (char)(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                out[n++] = (char)(0xE0 | (cp >> 12));
+                out[n++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                out[n++] = (char)(0x80 | (cp & 0x3F));
+            }
+            break;
+        }
+        default: // '"', '\\' e '/'
+            out[n++] = c;
+        }
+    }
+    if (!out || ps->p >= ps->end)
+    {
+        free(out);
+        return NULL;
+    }
+    ps->p++; // Aspas finais
+    out[n] = '\0';
+    return out;
+}
+
+/**
+ * @brief Lê uma lista ou um objeto (a chave só é lida em objetos).
+ * @return 1 em sucesso, 0 em erro de sintaxe.
+ */
+static int json_parse_container(json_parser *ps, json_value *out, int is_object)
+{
+    char close = is_object ? '}' : ']';
+    size_t capacity = 0;
+    out->type = is_object ? JSON_OBJECT : JSON_ARRAY;
+    ps->p++;
+    json_skip_space(ps);
+    if (ps->p < ps->end && *ps->p == close)
+    {
+        ps->p++;
+        return 1;
+    }
+
+    for (;;)
+    {
+        if (out->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 8;
+            json_value *items = realloc(out->items, capacity * sizeof(json_value));
+            if (!items)
+                return 0;
+            out->items = items;
+            if (is_object)
+            {
+                char **keys = realloc(out->keys, capacity * sizeof(char *));
+                if (!keys)
+                    return 0;
+                out->keys = keys;
+            }
+        }
+
+        json_value *item = &out->items[out->count];
+        memset(item, 0, sizeof(*item));
+        if (is_object)
+        {
+            json_skip_space(ps);
+            out->keys[out->count] = json_parse_string(ps);
+            if (!out->keys[out->count])
+                return 0;
+            out->count++;
+            json_skip_space(ps);
+            if (ps->p >= ps->end || *ps->p++ != ':')
+                return 0;
+        }
+        else
+            out->count++;
+        if (!json_parse_value(ps, item))
+            return 0;
+
+        json_skip_space(ps);
+        if (ps->p >= ps->end)
+            return 0;
+        if (*ps->p == ',')
+        {
+            ps->p++;
+            continue;
+        }
+        if (*ps->p++ != close)
+            return 0;
+        return 1;
+    }
+}
+
+/**
+ * @brief Lê um valor JSON qualquer.
+ * @return 1 em sucesso, 0 em erro de sintaxe (o valor parcial deve ser liberado).
+ */
+static int json_parse_value(json_parser *ps, json_value *out)
+{
+    json_skip_space(ps);
+    if (ps->p >= ps->end)
+        return 0;
+
+    switch (*ps->p)
+    {
+    case '{':
+        return json_parse_container(ps, out, 1);
+    case '[':
+        return json_parse_container(ps, out, 0);
+    case '"':
+        out->type = JSON_STRING;
+        out->string = json_parse_string(ps);
+        return out->string != NULL;
+    }
+
+    static const char *const words[3] = {"true", "false", "null"};
+    for (int i = 0; i < 3; i++)
+    {
+        size_t len = strlen(words[i]);
+        if ((size_t)(ps->end - ps->p) >= len && memcmp(ps->p, words[i], len) == 0)
+        {
+            out->type = i < 2 ? JSON_BOOL : JSON_NULL;
+            out->number = i == 0;
+            ps->p += len;
+            return 1;
+        }
+    }
+
+    char *end;
+    out->type = JSON_NUMBER;
+    out->number = strtod(ps->p, &end);
+    if (end == ps->p || end > ps->end)
+        return 0;
+    ps->p = end;
+    return 1;
+}
+
+/**
+ * @brief Procura uma chave em um objeto.
+ * @return O valor, ou NULL se não existir (ou se v não for um objeto).
+ */
+static const json_value *json_get(const json_value *v, const char *key)
+{
+    if (!v || v->type != JSON_OBJECT)
+        return NULL;
+    for (size_t i = 0; i < v->count; i++)
+    {
+        if (strcmp(v->keys[i], key) == 0)
+            return &v->items[i];
+    }
+    return NULL;
+}
+
+static const char *json_get_string(const json_value *v, const char *key, const char *fallback)
+{
+    const json_value *s = json_get(v, key);
+    return s && s->type == JSON_STRING ? s->string : fallback;
+}
+
+/**
+ * @brief Lê e interpreta um arquivo JSON inteiro.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int json_load(const char *filename, json_value *out)
+{
+    memset(out, 0, sizeof(*out));
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = len >= 0 ? malloc(len + 1) : NULL;
+    int ok = text && fread(text, 1, len, f) == (size_t)len;
+    fclose(f);
+
+    if (ok)
+    {
+        text[len] = '\0'; // strtod não passa do fim do texto
+        json_parser ps = {text, text + len};
+        ok = json_parse_value(&ps, out);
+        json_skip_space(&ps);
+        ok = ok && ps.p == ps.end;
+    }
+    if (!ok)
+        json_free(out);
+    free(text);
+    return ok;
+}
+
+// --- Métricas ---
+
+/**
+ * @brief Resumo de uma métrica: mediana e MAD (recalculados das amostras, se houver).
+ */
+typedef struct
+{
+    const char *name;
+    const char *unit;
+    int higher_is_better;
+    double median;
+    double mad;
+    int samples;
+} metric_summary;
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median_of(double *values, size_t n)
+{
+    qsort(values, n, sizeof(double), compare_doubles);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/**
+ * @brief Extrai o resumo de uma entrada de "metrics".
+ * @return 1 em sucesso, 0 se a entrada não tiver nome ou mediana, ou tiver uma
+ *         amostra que não seja um número.
+ */
+static int read_metric(const json_value *entry, metric_summary *m)
+{
+    const json_value *median = json_get(entry, "median");
+    const json_value *mad = json_get(entry, "mad");
+    const json_value *samples = json_get(entry, "samples");
+
+    m->name = json_get_string(entry, "name", NULL);
+    m->unit = json_get_string(entry, "unit", "");
+    m->higher_is_better = strcmp(json_get_string(entry, "better", "lower"), "higher") == 0;
+    m->median = median && median->type == JSON_NUMBER ? median->number : NAN;
+    m->mad = mad && mad->type == JSON_NUMBER ? mad->number : 0.0;
+    m->samples = 1;
+
+    // As amostras, quando presentes, são a fonte da mediana e do MAD
+    if (samples && samples->type == JSON_ARRAY && samples->count > 0)
+    {
+        size_t n = samples->count;
+        double *values = malloc(n * sizeof(double));
+        if (!values)
+            return 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (samples->items[i].type != JSON_NUMBER)
+            {
+                free(values);
+                return 0;
+            }
+            values[i] = samples->items[i].number;
+        }
+        m->median = median_of(values, n);
+        for (size_t i = 0; i < n; i++)
+            values[i] = fabs(samples->items[i].number - m->median);
+        m->mad = median_of(values, n);
+        m->samples = (int)n;
+        free(values);
+    }
+    return m->name != NULL && !isnan(m->median);
+}
+
+/**
+ * @brief Lista "metrics" de um resultado.
+ */
+static const json_value *metric_list(const json_value *root)
+{
+    const json_value *list = json_get(root, "metrics");
+    return list && list->type == JSON_ARRAY ? list : NULL;
+}
+
+/**
+ * @brief Confere que todas as entradas de "metrics" de um resultado são legíveis.
+ * @return 1 em sucesso, 0 (com a mensagem de erro) na primeira entrada inválida.
+ */
+static int check_metrics(const json_value *root, const char *filename)
+{
+    const json_value *list = metric_list(root);
+    for (size_t i = 0; i < list->count; i++)
+    {
+        metric_summary m;
+        if (!read_metric(&list->items[i], &m))
+        {
+            const char *name = json_get_string(&list->items[i], "name", NULL);
+            fprintf(stderr, "Erro: Métrica %zu ('%s') de '%s' sem nome, sem mediana ou com amostra não numérica.\n",
+                    i, name ? name : "?", filename);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Procura uma métrica pelo nome em um resultado.
+ * @return 1 se encontrada, 0 caso contrário.
+ */
+static int find_metric(const json_value *root, const char *name, metric_summary *m)
+{
+    const json_value *list = metric_list(root);
+    for (size_t i = 0; list && i < list->count; i++)
+    {
+        const char *other = json_get_string(&list->items[i], "name", NULL);
+        if (other && strcmp(other, name) == 0)
+            return read_metric(&list->items[i], m);
+    }
+    return 0;
+}
+
+// --- Comparação ---
+
+typedef struct
+{
+    double sigmas;     // Desvios robustos exigidos
+    double min_change; // Variação relativa mínima
+    const char *only;  // Prefixo de nome das métricas comparadas (NULL = todas)
+    int allow_missing; // Métricas da base ausentes no resultado atual não causam falha
+} compare_config;
+
+/**
+ * @brief Avisa quando os dois resultados vêm de hosts ou ferramentas diferentes.
+ */
+static void warn_mismatch(const json_value *base, const json_value *cur)
+{
+    const char *tb = json_get_string(base, "tool", "?"), *tc = json_get_string(cur, "tool", "?");
+    if (strcmp(tb, tc) != 0)
+        printf("Aviso: resultados de ferramentas diferentes ('%s' e '%s').\n", tb, tc);
+
+    static const char *const fields[3] = {"cpu_model", "logical_cpus", "compiler"};
+    const json_value *hb = json_get(base, "host"), *hc = json_get(cur, "host");
+    for (int i = 0; i < 3; i++)
+    {
+        const json_value *vb = json_get(hb, fields[i]), *vc = json_get(hc, fields[i]);
+        if (!vb || !vc || vb->type != vc->type)
+            continue;
+        int differs = vb->type == JSON_STRING ? strcmp(vb->string, vc->string) != 0 : vb->number != vc->number;
+        if (differs)
+            printf("Aviso: '%s' difere entre as execuções; as diferenças podem não ser regressões.\n", fields[i]);
+    }
+}
+
+/**
+ * @brief Compara as métricas e imprime a tabela.
+ * @return Número de regressões significativas, somado ao de métricas da base
+ *         ausentes no resultado atual (a menos que cfg->allow_missing).
+ */
+static int compare_results(const json_value *base, const json_value *cur, const compare_config *cfg)
+{
+    const json_value *list = metric_list(cur);
+    int regressions = 0, improvements = 0, compared = 0;
+
+    printf("%-27s | %-6s | %12s | %12s | %9s | %8s | %s\n", "Métrica", "Unid.", "Base", "Atual", "Δ", "Limite",
+           "Estado");
+    for (size_t i = 0; i < list->count; i++)
+    {
+        metric_summary mc, mb;
+        if (!read_metric(&list->items[i], &mc))
+            continue;
+        if (cfg->only && strncmp(mc.name, cfg->only, strlen(cfg->only)) != 0)
+            continue;
+        if (!find_metric(base, mc.name, &mb))
+        {
+            printf("%-26s | %-6s | %12s | %12.4g | %8s | %8s | nova\n", mc.name, mc.unit, "-", mc.median, "-", "-");
+            continue;
+        }
+        compared++;
+
+        // Ruído: k desvios robustos da execução mais ruidosa, com um piso relativo
+        double noise = cfg->sigmas * MAD_TO_SIGMA * (mb.mad > mc.mad ? mb.mad : mc.mad);
+        double floor = cfg->min_change * fabs(mb.median);
+        double limit = noise > floor ? noise : floor;
+        double delta = mc.median - mb.median;
+        double worse = mc.higher_is_better ? -delta : delta; // > 0 quando piorou
+
+        const char *state = "ok";
+        if (worse > limit)
+        {
+            state = "REGRESSÃO";
+            regressions++;
+        }
+        else if (-worse > limit)
+        {
+            state = "melhora";
+            improvements++;
+        }
+
+        double pct = mb.median != 0 ? 100.0 * delta / fabs(mb.median) : 0.0;
+        double limit_pct = mb.median != 0 ? 100.0 * limit / fabs(mb.median) : 0.0;
+        printf("%-26s | %-6s | %12.4g | %12.4g | %+7.1f%% | %7.1f%% | %s\n", mc.name, mc.unit, mb.median, mc.median,
+               pct, limit_pct, state);
+    }
+
+    // Métricas que sumiram do resultado atual
+    const json_value *base_list = metric_list(base);
+    int missing = 0;
+    for (size_t i = 0; i < base_list->count; i++)
+    {
+        metric_summary mb, mc;
+        if (!read_metric(&base_list->items[i], &mb) || (cfg->only && strncmp(mb.name, cfg->only, strlen(cfg->only)) != 0))
+            continue;
+        if (!find_metric(cur, mb.name, &mc))
+        {
+            printf("%-26s | %-6s | %12.4g | %12s | %8s | %8s | %s\n", mb.name, mb.unit, mb.median, "-", "-", "-",
+                   cfg->allow_missing ? "ausente" : "AUSENTE");
+            missing++;
+        }
+    }
+
+    printf("\n%d métrica(s) comparada(s): %d regressão(ões), %d melhora(s), %d ausente(s).\n", compared, regressions,
+           improvements, missing);
+    return regressions + (cfg->allow_missing ? 0 : missing);
+}
+
+// --- Programa principal ---
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr,
+            "Uso: %s [--sigmas K] [--min-change PCT] [--only prefixo] [--allow-missing] base.json atual.json\n"
+            "Sai com %d sem regressões, %d com alguma regressão significativa (ou métrica da base ausente,\n"
+            "sem --allow-missing) e %d em erro de entrada.\n",
+            program, EXIT_NO_REGRESSION, EXIT_REGRESSION, EXIT_BAD_INPUT);
+}
+
+int main(int argc, char *argv[])
+{
+    compare_config cfg = {DEFAULT_SIGMAS, DEFAULT_MIN_CHANGE, NULL, 0};
+    const char *files[2];
+    int file_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--sigmas") == 0 && value)
+        {
+            cfg.sigmas = atof(value);
+            i++;
+        }
+        else if (strcmp(argv[i], "--min-change") == 0 && value)
+        {
+            cfg.min_change = atof(value) / 100.0;
+            i++;
+        }
+        else if (strcmp(argv[i], "--only") == 0 && value)
+        {
+            cfg.only = value;
+            i++;
+        }
+        else if (strcmp(argv[i], "--allow-missing") == 0)
+            cfg.allow_missing = 1;
+        else if (argv[i][0] != '-' && file_count < 2)
+            files[file_count++] = argv[i];
+        else
+        {
+            print_usage(argv[0]);
+            return EXIT_BAD_INPUT;
+        }
+    }
+    if (file_count != 2 || cfg.sigmas < 0 || cfg.min_change < 0)
+    {
+        print_usage(argv[0]);
+        return EXIT_BAD_INPUT;
+    }
+
+    json_value base, cur;
+    if (!json_load(files[0], &base))
+    {
+        fprintf(stderr, "Erro: Não foi possível ler o JSON '%s'.\n", files[0]);
+        return EXIT_BAD_INPUT;
+    }
+    if (!json_load(files[1], &cur))
+    {
+        fprintf(stderr, "Erro: Não foi possível ler o JSON '%s'.\n", files[1]);
+        json_free(&base);
+        return EXIT_BAD_INPUT;
+    }
+    if (!metric_list(&base) || !metric_list(&cur))
+    {
+        fprintf(stderr, "Erro: Os resultados não têm a lista \"metrics\".\n");
+        json_free(&base);
+        json_free(&cur);
+        return EXIT_BAD_INPUT;
+    }
+    if (!check_metrics(&base, files[0]) || !check_metrics(&cur, files[1]))
+    {
+        json_free(&base);
+        json_free(&cur);
+        return EXIT_BAD_INPUT;
+    }
+
+    warn_mismatch(&base, &cur);
+    int regressions = compare_results(&base, &cur, &cfg);
+    json_free(&base);
+    json_free(&cur);
+    return regressions ? EXIT_REGRESSION : EXIT_NO_REGRESSION;
+}
@@ -0,0 +1,746 @@
+/**
+ * @file bench_rsa.c
+ * @brief Benchmark de ponta a ponta da librsa_sign com saída em JSON.
+ *
+ * Mede a geração de chaves (mediana de N execuções), assinaturas e verificações
+ * por segundo com 1, 2, 4 e N threads, OAEP pad/unpad, a vazão do Base64 e a
+ * assinatura/verificação completa de arquivos de 1 KB, 1 MB e 1 GB. Cada métrica
+ * é repetida várias vezes; o JSON traz as amostras, a mediana e o desvio absoluto
+ * mediano (MAD), além das informações do host e da CPU, para comparar execuções
+ * em máquinas diferentes.
+ *
+ * Compilação: gcc -O2 -o bench_rsa bench_rsa.c rsa_sign.c -lgmp -pthread
+ *
+ * Autor: Yan Tavares e Eduardo Marques
+ * Disciplina: CIC0201 - Segurança Computacional
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/utsname.h>
+#include <gmp.h>
+
+#include "rsa_sign.h"
+
+// --- Constantes ---
+#define BENCH_SCHEMA_VERSION 1
+#define BENCH_MAX_METRICS 128
+#define BENCH_MAX_RUNS 64
+#define BENCH_MAX_SIZES 8
+#define BENCH_MAX_THREADS 256
+#define BENCH_BASE64_BYTES (16 << 20) // Buffer da medição do Base64
+#define BENCH_FILE_CHUNK (1 << 20)    // Bloco de escrita dos arquivos de teste
+
+// --- Métricas ---
+
+/**
+ * @brief Uma métrica e as suas amostras (uma por repetição).
+ */
+typedef struct
+{
+    char name[64];
+    const char *unit;
+    int higher_is_better; // 1 para vazão (ops/s, MB/s), 0 para latência
+    double samples[BENCH_MAX_RUNS];
+    int count;
+} metric;
+
+static metric metrics[BENCH_MAX_METRICS];
+static int metric_count = 0;
+
+/**
+ * @brief Cria uma métrica vazia.
+ * @return Ponteiro para a métrica, ou NULL se a tabela estiver cheia.
+ */
+static metric *metric_new(const char *unit, int higher_is_better, const char *format, ...)
+{
+    if (metric_count == BENCH_MAX_METRICS)
+        return NULL;
+    metric *m = &metrics[metric_count++];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(m->name, sizeof(m->name), format, args);
+    va_end(args);
+    m->unit = unit;
+    m->higher_is_better = higher_is_better;
+    m->count = 0;
+    return m;
+}
+
+/**
+ * @brief Acrescenta uma amostra à métrica.
+ */
+static void metric_add(metric *m, double value)
+{
+    if (m && m->count < BENCH_MAX_RUNS)
+        m->samples[m->count++] = value;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Mediana de n valores (o vetor é ordenado no lugar).
+ */
+static double median(double *values, int n)
+{
+    if (n == 0)
+        return 0.0;
+    qsort(values, n, sizeof(double), compare_doubles);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/**
+ * @brief Mediana e desvio absoluto mediano (MAD) das amostras de uma métrica.
+ */
+static void metric_summary(const metric *m, double *med, double *mad)
+{
+    double tmp[BENCH_MAX_RUNS];
+    memcpy(tmp, m->samples, m->count * sizeof(double));
+    *med = median(tmp, m->count);
+    for (int i = 0; i < m->count; i++)
+        tmp[i] = m->samples[i] > *med ? m->samples[i] - *med : *med - m->samples[i];
+    *mad = median(tmp, m->count);
+}
+
+// --- Informações do host ---
+
+/**
+ * @brief Nome do modelo da CPU lido de /proc/cpuinfo.
+ */
+static void cpu_model(char *out, size_t size)
+{
+    snprintf(out, size, "desconhecido");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f)
+        return;
+    char line[512];
+    while (fgets(line, sizeof(line), f))
+    {
+        if (strncmp(line, "model name", 10) != 0)
+            continue;
+        char *value = strchr(line, ':');
+        if (value)
+        {
+            value += value[1] == ' ' ? 2 : 1;
+            value[strcspn(value, "\n")] = '\0';
+            snprintf(out, size, "%s", value);
+        }
+        break;
+    }
+    fclose(f);
+}
+
+/**
+ * @brief Grava uma string JSON com aspas e escapes.
+ */
+static void json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(out, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(out, "\\u%04x", *s);
+        else
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+// --- Configuração ---
+
+typedef struct
+{
+    int bits;
+    int runs;         // Repetições de cada métrica
+    int keygen_runs;  // Execuções da geração de chaves
+    double seconds;   // Duração de cada repetição das medições por vazão
+    size_t sizes[BENCH_MAX_SIZES];
+    char size_names[BENCH_MAX_SIZES][16];
+    int size_count;
+    int threads[8];
+    int thread_count;
+    const char *dir;  // Diretório dos arquivos temporários
+    const char *output;
+} bench_config;
+
+/**
+ * @brief Converte "1K", "4M", "1G" (potências de 1024) em bytes.
+ * @return O tamanho, ou 0 se for inválido.
+ */
+static size_t parse_size(const char *text)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    switch (*end)
+    {
+    case 'G':
+    case 'g':
+        value <<= 10;
+        // fallthrough
+    case 'M':
+    case 'm':
+        value <<= 10;
+        // fallthrough
+    case 'K':
+    case 'k':
+        value <<= 10;
+        end++;
+        break;
+    }
+    return *end == '\0' ? (size_t)value : 0;
+}
+
+/**
+ * @brief Lê a lista de tamanhos "1K,1M,1G".
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int parse_sizes(bench_config *cfg, const char *list)
+{
+    char copy[256], *save = NULL;
+    snprintf(copy, sizeof(copy), "%s", list);
+    cfg->size_count = 0;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save))
+    {
+        size_t size = parse_size(tok);
+        if (!size || cfg->size_count == BENCH_MAX_SIZES)
+            return 0;
+        cfg->sizes[cfg->size_count] = size;
+        snprintf(cfg->size_names[cfg->size_count], sizeof(cfg->size_names[0]), "%s", tok);
+        cfg->size_count++;
+    }
+    return cfg->size_count > 0;
+}
+
+/**
+ * @brief Threads medidas: 1, 2, 4 e o número de processadores, sem repetições.
+ */
+static void default_threads(bench_config *cfg)
+{
+    int online = keygen_thread_count();
+    int candidates[4] = {1, 2, 4, online};
+    cfg->thread_count = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int t = candidates[i] > BENCH_MAX_THREADS ? BENCH_MAX_THREADS : candidates[i];
+        int seen = 0;
+        for (int j = 0; j < cfg->thread_count; j++)
+            seen |= cfg->threads[j] == t;
+        if (!seen)
+            cfg->threads[cfg->thread_count++] = t;
+    }
+}
+
+/**
+ * @brief Lê a lista de threads "1,2,8".
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int parse_threads(bench_config *cfg, const char *list)
+{
+    char copy[256], *save = NULL;
+    snprintf(copy, sizeof(copy), "%s", list);
+    cfg->thread_count = 0;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save))
+    {
+        int t = atoi(tok);
+        if (t < 1 || t > BENCH_MAX_THREADS || cfg->thread_count == 8)
+            return 0;
+        cfg->threads[cfg->thread_count++] = t;
+    }
+    return cfg->thread_count > 0;
+}
+
+// --- Geração de chaves ---
+
+/**
+ * @brief Gera a chave usada nos demais testes e mede a geração (mediana de N).
+ *
+ * Cada execução usa um DRBG com semente fixa diferente, de modo que duas
+ * execuções do benchmark percorrem os mesmos candidatos.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int bench_keygen(const bench_config *cfg, rsa_key *key)
+{
+    metric *m = metric_new("ms", 0, "keygen_%d_ms", cfg->bits);
+    int threads = keygen_thread_count();
+    for (int run = 0; run < cfg->keygen_runs; run++)
+    {
+        // A primeira chave é a dos testes seguintes; as demais são descartadas
+        drbg rng;
+        drbg_seed_ui(&rng, BENCHMARK_SEED + run);
+        rsa_key tmp;
+        rsa_key *target = run == 0 ? key : &tmp;
+        if (run > 0)
+            rsa_key_init(&tmp);
+
+        double start = monotonic_seconds();
+        int ok = rsa_key_generate(target, cfg->bits, &rng, threads);
+        double elapsed = monotonic_seconds() - start;
+        if (run > 0)
+            rsa_key_clear(&tmp);
+        if (!ok)
+            return 0;
+        metric_add(m, elapsed * 1e3);
+        fprintf(stderr, "keygen %d bits: %.1f ms\n", cfg->bits, elapsed * 1e3);
+    }
+    return 1;
+}
+
+// --- Assinatura e verificação em várias threads ---
+
+typedef struct
+{
+    const rsa_key *key; // Chave compartilhada por todas as threads (somente leitura)
+    int verify;         // 0 = assinar, 1 = verificar
+    const unsigned char *signature;
+    double seconds;
+    pthread_barrier_t *barrier;
+    unsigned long ops;
+    int ok;
+} op_worker;
+
+/**
+ * @brief Thread de medição: assina (ou verifica) o mesmo digest até o prazo.
+ *
+ * Todas as threads usam a mesma chave; só o gerador e o contexto OAEP são da thread.
+ */
+static void *op_worker_run(void *arg)
+{
+    op_worker *w = (op_worker *)arg;
+    const rsa_key *key = w->key;
+    size_t k = rsa_key_bytes(key);
+
+    unsigned char digest[SHA3_256_DIGEST_SIZE], recovered[SHA3_256_DIGEST_SIZE];
+    unsigned char *signature = malloc(k);
+    drbg *rng = thread_rng();
+    memset(digest, 0xA5, sizeof(digest));
+    w->ok = signature && rng;
+
+    pthread_barrier_wait(w->barrier);
+    double deadline = monotonic_seconds() + w->seconds;
+    w->ops = 0;
+    while (w->ok && monotonic_seconds() < deadline)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            if (w->verify)
+                w->ok = rsa_recover_digest(key, SIGN_DOMAIN_PLAIN, w->signature, k, recovered);
+            else
+                w->ok = rsa_sign_digest(key, SIGN_DOMAIN_PLAIN, digest, signature, rng);
+        }
+        w->ops += 8;
+    }
+
+    free(signature);
+    oaep_thread_ctx_release();
+    thread_rng_release();
+    return NULL;
+}
+
+/**
+ * @brief Mede operações por segundo com 'threads' threads por 'seconds' segundos.
+ * @return Operações por segundo (somadas entre as threads), ou -1 em falha.
+ */
+static double run_ops(const rsa_key *key, const unsigned char *signature, int verify, int threads, double seconds)
+{
+    op_worker workers[BENCH_MAX_THREADS];
+    pthread_t tids[BENCH_MAX_THREADS];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads);
+
+    for (int t = 0; t < threads; t++)
+    {
+        workers[t] = (op_worker){key, verify, signature, seconds, &barrier, 0, 0};
+        pthread_create(&tids[t], NULL, op_worker_run, &workers[t]);
+    }
+
+    unsigned long ops = 0;
+    int ok = 1;
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(tids[t], NULL);
+        ops += workers[t].ops;
+        ok = ok && workers[t].ok;
+    }
+    pthread_barrier_destroy(&barrier);
+    return ok ? ops / seconds : -1.0;
+}
+
+/**
+ * @brief Assinaturas e verificações por segundo para cada número de threads.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int bench_sign_verify(const bench_config *cfg, const rsa_key *key)
+{
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    unsigned char *signature = malloc(rsa_key_bytes(key));
+    memset(digest, 0xA5, sizeof(digest));
+    int ok = signature && rsa_sign_digest(key, SIGN_DOMAIN_PLAIN, digest, signature, thread_rng());
+
+    for (int i = 0; ok && i < cfg->thread_count; i++)
+    {
+        int threads = cfg->threads[i];
+        metric *sign = metric_new("ops/s", 1, "sign_%d_t%d_ops", cfg->bits, threads);
+        metric *verify = metric_new("ops/s", 1, "verify_%d_t%d_ops", cfg->bits, threads);
+        for (int run = 0; ok && run < cfg->runs; run++)
+        {
+            double s = run_ops(key, signature, 0, threads, cfg->seconds);
+            double v = run_ops(key, signature, 1, threads, cfg->seconds);
+            ok = s >= 0 && v >= 0;
+            metric_add(sign, s);
+            metric_add(verify, v);
+        }
+        fprintf(stderr, "%d thread(s): %.0f assinaturas/s, %.0f verificações/s\n", threads,
+                sign->samples[0], verify->samples[0]);
+    }
+
+    free(signature);
+    return ok;
+}
+
+// --- OAEP e Base64 ---
+
+/**
+ * @brief OAEP pad e unpad por segundo, em uma thread, com o contexto do tamanho da chave.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int bench_oaep(const bench_config *cfg, const rsa_key *key)
+{
+    int k = rsa_key_bytes(key);
+    oaep_ctx ctx;
+    if (!oaep_ctx_init(&ctx, k))
+        return 0;
+    unsigned char digest[SHA3_256_DIGEST_SIZE], out[SHA3_256_DIGEST_SIZE];
+    unsigned char *padded = malloc(k);
+    memset(digest, 0x5A, sizeof(digest));
+    int ok = padded && rsa_oaep_pad(&ctx, SIGN_DOMAIN_PLAIN, digest, sizeof(digest), padded, thread_rng()) == OAEP_OK;
+
+    metric *pad = metric_new("ops/s", 1, "oaep_pad_%d_ops", cfg->bits);
+    metric *unpad = metric_new("ops/s", 1, "oaep_unpad_%d_ops", cfg->bits);
+    for (int run = 0; ok && run < cfg->runs; run++)
+    {
+        unsigned long ops = 0;
+        double start = monotonic_seconds(), elapsed;
+        do
+        {
+            for (int i = 0; i < 64; i++)
+                ok &= rsa_oaep_pad(&ctx, SIGN_DOMAIN_PLAIN, digest, sizeof(digest), padded, thread_rng()) == OAEP_OK;
+            ops += 64;
+        } while ((elapsed = monotonic_seconds() - start) < cfg->seconds);
+        metric_add(pad, ops / elapsed);
+
+        ops = 0;
+        start = monotonic_seconds();
+        do
+        {
+            size_t out_len;
+            for (int i = 0; i < 64; i++)
+                ok &= rsa_oaep_unpad(&ctx, SIGN_DOMAIN_PLAIN, padded, out, sizeof(out), &out_len) == OAEP_OK;
+            ops += 64;
+        } while ((elapsed = monotonic_seconds() - start) < cfg->seconds);
+        metric_add(unpad, ops / elapsed);
+    }
+    if (ok)
+        fprintf(stderr, "OAEP: %.0f pad/s, %.0f unpad/s\n", pad->samples[0], unpad->samples[0]);
+
+    free(padded);
+    oaep_ctx_clear(&ctx);
+    return ok;
+}
+
+/**
+ * @brief Vazão da codificação e da decodificação Base64, em MB/s de dados binários.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int bench_base64(const bench_config *cfg)
+{
+    unsigned char *data = malloc(BENCH_BASE64_BYTES);
+    if (!data)
+        return 0;
+    drbg rng;
+    drbg_seed_ui(&rng, BENCHMARK_SEED);
+    drbg_bytes(&rng, data, BENCH_BASE64_BYTES);
+
+    metric *enc = metric_new("MB/s", 1, "base64_encode_mbps");
+    metric *dec = metric_new("MB/s", 1, "base64_decode_mbps");
+    int ok = 1;
+    for (int run = 0; ok && run < cfg->runs; run++)
+    {
+        size_t text_len, decoded_len;
+        double start = monotonic_seconds();
+        char *text = base64_encode(data, BENCH_BASE64_BYTES, &text_len);
+        double encode_seconds = monotonic_seconds() - start;
+
+        start = monotonic_seconds();
+        unsigned char *decoded = text ? base64_decode(text, text_len, &decoded_len) : NULL;
+        double decode_seconds = monotonic_seconds() - start;
+
+        ok = decoded && decoded_len == BENCH_BASE64_BYTES && memcmp(decoded, data, decoded_len) == 0;
+        metric_add(enc, BENCH_BASE64_BYTES / encode_seconds / 1e6);
+        metric_add(dec, BENCH_BASE64_BYTES / decode_seconds / 1e6);
+        free(text);
+        free(decoded);
+    }
+    if (ok)
+        fprintf(stderr, "Base64: codificação %.0f MB/s, decodificação %.0f MB/s\n", enc->samples[0],
+                dec->samples[0]);
+    free(data);
+    return ok;
+}
+
+// --- Assinatura e verificação de arquivos ---
+
+/**
+ * @brief Cria um arquivo de 'size' bytes pseudoaleatórios.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int create_test_file(const char *path, size_t size)
+{
+    FILE *f = fopen(path, "wb");
+    unsigned char *chunk = malloc(BENCH_FILE_CHUNK);
+    int ok = f && chunk;
+    drbg rng;
+    drbg_seed_ui(&rng, BENCHMARK_SEED);
+    for (size_t done = 0; ok && done < size;)
+    {
+        size_t n = size - done < BENCH_FILE_CHUNK ? size - done : BENCH_FILE_CHUNK;
+        drbg_bytes(&rng, chunk, n);
+        ok = fwrite(chunk, 1, n, f) == n;
+        done += n;
+    }
+    if (f)
+        ok = fclose(f) == 0 && ok;
+    free(chunk);
+    return ok;
+}
+
+/**
+ * @brief Assinatura e verificação completas de um arquivo de cada tamanho:
+ *        leitura, hash, OAEP, operação RSA, Base64 e gravação.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int bench_files(const bench_config *cfg, const rsa_key *key)
+{
+    int ok = 1;
+    for (int i = 0; ok && i < cfg->size_count; i++)
+    {
+        char path[512], signed_path[520];
+        snprintf(path, sizeof(path), "%s/bench_rsa_%d_%s.bin", cfg->dir, (int)getpid(), cfg->size_names[i]);
+        snprintf(signed_path, sizeof(signed_path), "%s.signed", path);
+        if (!create_test_file(path, cfg->sizes[i]))
+        {
+            fprintf(stderr, "Erro: Não foi possível criar '%s'.\n", path);
+            return 0;
+        }
+
+        metric *sign = metric_new("ms", 0, "file_sign_%s_ms", cfg->size_names[i]);
+        metric *verify = metric_new("ms", 0, "file_verify_%s_ms", cfg->size_names[i]);
+        for (int run = 0; ok && run < cfg->runs; run++)
+        {
+            double start = monotonic_seconds();
+            unsigned char *content;
+            size_t content_len, signed_len;
+            char *signed_text = NULL;
+            ok = read_file_content(path, &content, &content_len);
+            if (ok)
+            {
+                signed_text = rsa_sign_message(key, content, content_len, thread_rng(), &signed_len);
+                free(content);
+            }
+            FILE *out = signed_text ? fopen(signed_path, "wb") : NULL;
+            ok = out && fwrite(signed_text, 1, signed_len, out) == signed_len;
+            if (out)
+                ok = fclose(out) == 0 && ok;
+            free(signed_text);
+            metric_add(sign, (monotonic_seconds() - start) * 1e3);
+
+            start = monotonic_seconds();
+            signed_message msg;
+            ok = ok && read_signed_file(signed_path, &msg) && rsa_verify_message(key, &msg) == VERIFY_OK;
+            signed_message_clear(&msg);
+            metric_add(verify, (monotonic_seconds() - start) * 1e3);
+        }
+        if (ok)
+            fprintf(stderr, "Arquivo de %s: assinatura %.1f ms, verificação %.1f ms\n", cfg->size_names[i],
+                    sign->samples[0], verify->samples[0]);
+        remove(path);
+        remove(signed_path);
+    }
+    return ok;
+}
+
+// --- Saída JSON ---
+
+/**
+ * @brief Grava o resultado: host, configuração e métricas com amostras, mediana e MAD.
+ */
+static void write_json(FILE *out, const bench_config *cfg)
+{
+    char hostname[256] = "desconhecido", model[256], timestamp[32];
+    struct utsname uts;
+    gethostname(hostname, sizeof(hostname));
+    hostname[sizeof(hostname) - 1] = '\0';
+    cpu_model(model, sizeof(model));
+    time_t now = time(NULL);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    int have_uts = uname(&uts) == 0;
+
+    fprintf(out, "{\n  \"tool\": \"bench_rsa\",\n  \"schema\": %d,\n  \"timestamp\": \"%s\",\n",
+            BENCH_SCHEMA_VERSION, timestamp);
+    fprintf(out, "  \"host\": {\n    \"hostname\": ");
+    json_string(out, hostname);
+    fprintf(out, ",\n    \"os\": ");
+    json_string(out, have_uts ? uts.sysname : "desconhecido");
+    fprintf(out, ",\n    \"kernel\": ");
+    json_string(out, have_uts ? uts.release : "desconhecido");
+    fprintf(out, ",\n    \"arch\": ");
+    json_string(out, have_uts ? uts.machine : "desconhecido");
+    fprintf(out, ",\n    \"cpu_model\": ");
+    json_string(out, model);
+    fprintf(out, ",\n    \"logical_cpus\": %d,\n    \"avx512_ifma\": %s,\n", keygen_thread_count(),
+            mb_ifma_available() ? "true" : "false");
+    fprintf(out, "    \"compiler\": ");
+    json_string(out, __VERSION__);
+    fprintf(out, ",\n    \"gmp\": ");
+    json_string(out, gmp_version);
+    fprintf(out, "\n  },\n");
+
+    fprintf(out, "  \"config\": {\"bits\": %d, \"runs\": %d, \"keygen_runs\": %d, \"seconds\": %g, "
+                 "\"api_version\": %d},\n",
+            cfg->bits, cfg->runs, cfg->keygen_runs, cfg->seconds, RSA_SIGN_API_VERSION);
+
+    fprintf(out, "  \"metrics\": [\n");
+    for (int i = 0; i < metric_count; i++)
+    {
+        const metric *m = &metrics[i];
+        double med, mad;
+        metric_summary(m, &med, &mad);
+        fprintf(out, "    {\"name\": \"%s\", \"unit\": \"%s\", \"better\": \"%s\", \"median\": %.6g, \"mad\": %.6g, "
+                     "\"samples\": [",
+                m->name, m->unit, m->higher_is_better ? "higher" : "lower", med, mad);
+        for (int s = 0; s < m->count; s++)
+            fprintf(out, "%s%.6g", s ? ", " : "", m->samples[s]);
+        fprintf(out, "]}%s\n", i + 1 < metric_count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// --- Programa principal ---
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr,
+            "Uso: %s [--bits N] [--runs R] [--keygen-runs N] [--seconds S] [--threads 1,2,4,N]\n"
+            "          [--sizes 1K,1M,1G] [--dir diretório] [-o resultado.json] [--quick]\n",
+            program);
+}
+
+int main(int argc, char *argv[])
+{
+    bench_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.bits = DEFAULT_KEY_BITS;
+    cfg.runs = 5;
+    cfg.keygen_runs = 5;
+    cfg.seconds = 0.5;
+    cfg.dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    parse_sizes(&cfg, "1K,1M,1G");
+    default_threads(&cfg);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        int used = 1;
+        if (strcmp(argv[i], "--bits") == 0 && value)
+            cfg.bits = atoi(value);
+        else if (strcmp(argv[i], "--runs") == 0 && value)
+            cfg.runs = atoi(value);
+        else if (strcmp(argv[i], "--keygen-runs") == 0 && value)
+            cfg.keygen_runs = atoi(value);
+        else if (strcmp(argv[i], "--seconds") == 0 && value)
+            cfg.seconds = atof(value);
+        else if (strcmp(argv[i], "--sizes") == 0 && value)
+        {
+            if (!parse_sizes(&cfg, value))
+            {
+                fprintf(stderr, "Erro: Lista de tamanhos inválida '%s'.\n", value);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && value)
+        {
+            if (!parse_threads(&cfg, value))
+            {
+                fprintf(stderr, "Erro: Lista de threads inválida '%s'.\n", value);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--dir") == 0 && value)
+            cfg.dir = value;
+        else if (strcmp(argv[i], "-o") == 0 && value)
+            cfg.output = value;
+        else if (strcmp(argv[i], "--quick") == 0)
+        {
+            // Execução curta para verificação rápida: sem o arquivo de 1 GB
+            cfg.runs = 3;
+            cfg.keygen_runs = 3;
+            cfg.seconds = 0.2;
+            parse_sizes(&cfg, "1K,1M");
+            used = 0;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+        i += used;
+    }
+    if (!key_size_supported(cfg.bits) || cfg.runs < 1 || cfg.runs > BENCH_MAX_RUNS || cfg.keygen_runs < 1 ||
+        cfg.keygen_runs > BENCH_MAX_RUNS || cfg.seconds <= 0)
+    {
+        fprintf(stderr, "Erro: Parâmetros inválidos.\n");
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    arena_install_gmp();
+    if (!thread_rng())
+    {
+        fprintf(stderr, "Erro: Não foi possível obter entropia do sistema para o gerador.\n");
+        return 1;
+    }
+
+    rsa_key key;
+    rsa_key_init(&key);
+    int ok = bench_keygen(&cfg, &key) && bench_sign_verify(&cfg, &key) && bench_oaep(&cfg, &key) &&
+             bench_base64(&cfg) && bench_files(&cfg, &key);
+    rsa_key_clear(&key);
+    if (!ok)
+    {
+        fprintf(stderr, "Erro: Falha durante o benchmark.\n");
+        return 1;
+    }
+
+    FILE *out = cfg.output ? fopen(cfg.output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Erro: Não foi possível criar '%s'.\n", cfg.output);
+        return 1;
+    }
+    write_json(out, &cfg);
+    if (out != stdout && fclose(out) != 0)
+        return 1;
+    if (cfg.output)
+        fprintf(stderr, "Resultado gravado em '%s'.\n", cfg.output);
+    return 0;
+}
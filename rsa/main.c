@@ -3,13 +3,12 @@
  * @brief Implementação de um gerador/verificador de assinaturas RSA.
  *
  * Este programa implementa as seguintes funcionalidades:
- * 1. Geração de pares de chaves RSA (pública e privada) de 2048 bits.
+ * 1. Geração de pares de chaves RSA (pública e privada) de 2048, 3072, 4096 ou 8192 bits.
  * 2. Assinatura de arquivos usando RSA com padding OAEP e hash SHA3-256.
  * 3. Verificação de assinaturas em arquivos.
  *
- * O código utiliza a biblioteca GMP para aritmética de múltiplos precisão e implementa
- * SHA3-256 do zero. As primitivas criptográficas de geração de chaves
- * e cifração/decifração RSA-OAEP foram implementadas do zero.
+ * Este arquivo contém apenas a interface de menus; toda a criptografia está na
+ * biblioteca librsa_sign (rsa_sign.h / rsa_sign.c).
  *
  * Autor: Yan Tavares e Eduardo Marques
  * Disciplina: CIC0201 - Segurança Computacional
@@ -18,1044 +17,2791 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <pthread.h>
 #include <gmp.h>
-#include <stdint.h>
 
-// --- Constantes ---
-#define KEY_BITS 2048
-#define MILLER_RABIN_ITERATIONS 40
-#define SHA3_256_DIGEST_SIZE 32
+#include "rsa_sign.h"
 
-// --- Implementação SHA3-256 do zero ---
+// --- Interface (menus) ---
+
+static int trace_enabled = 0; // --trace: tempo por etapa de cada assinatura e verificação
+
+/**
+ * @brief Salva chaves RSA em arquivos.
+ * @param n Módulo n.
+ * @param e Expoente público e.
+ * @param d Expoente privado d.
+ */
+void save_keys(mpz_t n, mpz_t e, mpz_t d)
+{
+    save_key_hex("public_key.txt", n, e);
+    save_key_hex("private_key.txt", n, d);
+
+    printf("Chaves salvas em 'public_key.txt' e 'private_key.txt'.\n");
+}
+
+/**
+ * @brief Pergunta o tamanho da chave; 0 escolhe DEFAULT_KEY_BITS.
+ * @return O tamanho escolhido, ou 0 se não for aceito.
+ */
+int prompt_key_bits()
+{
+    int bits;
+    printf("Tamanho da chave em bits (2048, 3072, 4096 ou 8192; 0 = %d): ", DEFAULT_KEY_BITS);
+    if (scanf("%d", &bits) != 1 || bits == 0)
+        bits = DEFAULT_KEY_BITS;
+    if (!key_size_supported(bits))
+    {
+        printf("Erro: Tamanho de chave não suportado: %d bits.\n", bits);
+        return 0;
+    }
+    return bits;
+}
+
+/**
+ * @brief Menu para gerar um par de chaves RSA.
+ */
+void generate_keys_menu()
+{
+    int bits = prompt_key_bits();
+    if (!bits)
+        return;
+
+    rsa_key key;
+    rsa_key_init(&key);
+
+    int choice;
+    printf("Teste de primalidade (1 = Miller-Rabin FIPS 186-5, 2 = Baillie-PSW): ");
+    if (scanf("%d", &choice) != 1)
+        choice = 1;
+    prime_test_mode = choice == 2 ? PRIMALITY_BPSW : PRIMALITY_MILLER_RABIN;
+    printf("Threads para a geração de primos (0 = automático): ");
+    if (scanf("%d", &keygen_threads) != 1 || keygen_threads < 0)
+        keygen_threads = 0;
+
+    printf("\nGerando par de chaves RSA de %d bits...\n", bits);
+    if (prime_test_mode == PRIMALITY_BPSW)
+        printf("Testando primalidade com Baillie-PSW...\n");
+    else
+        printf("Testando primalidade com Miller-Rabin (%d iterações)...\n", fips_miller_rabin_rounds(bits / 2));
+    keygen_stats_reset();
+    double start = monotonic_seconds();
+    printf("Gerando primos p e q de %d bits (%d thread(s))... ", bits / 2, keygen_thread_count());
+    fflush(stdout);
+    generate_rsa_keys(key.n, key.e, key.d, key.p, key.q, bits, thread_rng());
+    printf("OK\n");
+    double elapsed = monotonic_seconds() - start;
+    printf("Chaves geradas em %.0f ms.\n", elapsed * 1e3);
+    if (keygen_stats_enabled)
+    {
+        keygen_stats_print(stdout, elapsed);
+        if (keygen_stats_write_json(keygen_stats_path, bits, keygen_thread_count(), elapsed))
+            printf("Estatísticas gravadas em '%s'.\n", keygen_stats_path);
+        else
+            printf("Erro: Não foi possível gravar as estatísticas em '%s'.\n", keygen_stats_path);
+    }
+    save_keys(key.n, key.e, key.d);
+
+    // Formato binário, com constantes de Montgomery e parâmetros CRT
+    key.is_private = 1;
+    rsa_key_compute_crt(&key);
+    if (rsa_key_finalize(&key) && save_key_binary("public_key.bin", &key, 0) &&
+        save_key_binary("private_key.bin", &key, 1))
+    {
+        printf("Chaves binárias salvas em 'public_key.bin' e 'private_key.bin'.\n");
+    }
+    else
+    {
+        printf("Erro ao salvar as chaves no formato binário.\n");
+    }
+
+    rsa_key_clear(&key);
+}
+
+/**
+ * @brief Menu para assinar um arquivo.
+ */
+void sign_file_menu()
+{
+    char file_to_sign[256], key_file[256];
+    unsigned char *file_content;
+    size_t file_len;
+
+    printf("Digite o nome do arquivo a ser assinado: ");
+    scanf("%255s", file_to_sign);
+    printf("Digite o nome do arquivo da chave privada (ex: private_key.txt): ");
+    scanf("%255s", key_file);
+
+    trace_record trace;
+    memset(&trace, 0, sizeof(trace));
+    trace_attach(trace_enabled ? &trace : NULL);
+
+    double t = trace_start();
+    if (!read_file_content(file_to_sign, &file_content, &file_len))
+    {
+        printf("Erro: Não foi possível ler o arquivo '%s'.\n", file_to_sign);
+        trace_attach(NULL);
+        return;
+    }
+    trace_stop(TRACE_READ, t);
+
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 1))
+    {
+        printf("Erro: Não foi possível carregar a chave privada de '%s'.\n", key_file);
+        free(file_content);
+        rsa_key_clear(&key);
+        trace_attach(NULL);
+        return;
+    }
+
+    // Hash, padding OAEP, operação privada e formatação em Base64
+    size_t signed_len;
+    char *signed_text = rsa_sign_message(&key, file_content, file_len, thread_rng(), &signed_len);
+    if (!signed_text)
+    {
+        printf("Erro ao aplicar padding OAEP.\n");
+        free(file_content);
+        rsa_key_clear(&key);
+        trace_attach(NULL);
+        return;
+    }
+
+    char signed_filename[300];
+    snprintf(signed_filename, sizeof(signed_filename), "%s.signed", file_to_sign);
+
+    t = trace_start();
+    FILE *out_file = fopen(signed_filename, "w");
+    int written = out_file && fwrite(signed_text, 1, signed_len, out_file) == signed_len;
+    if (out_file)
+        written = fclose(out_file) == 0 && written;
+    trace_stop(TRACE_WRITE, t);
+    trace_attach(NULL);
+    if (!written)
+    {
+        printf("Erro ao criar arquivo de saída '%s'.\n", signed_filename);
+    }
+    else
+    {
+        printf("Arquivo assinado com sucesso e salvo como '%s'.\n", signed_filename);
+    }
+    if (trace_enabled)
+        trace_record_print(stdout, &trace, file_to_sign);
+
+    // Limpeza
+    free(file_content);
+    free(signed_text);
+    rsa_key_clear(&key);
+}
+
+/**
+ * @brief Retorna o keyring do diretório informado, carregando-o apenas na primeira vez.
+ * @return Ponteiro para o keyring, ou NULL se o diretório não puder ser lido.
+ */
+const keyring *get_keyring(const char *dirname)
+{
+    static keyring cached;
+    static char cached_dir[256];
+    static int loaded = 0;
+
+    if (loaded && strcmp(cached_dir, dirname) == 0)
+        return &cached;
+
+    if (loaded)
+        keyring_clear(&cached);
+    loaded = keyring_load(&cached, dirname);
+    if (!loaded)
+        return NULL;
+
+    snprintf(cached_dir, sizeof(cached_dir), "%s", dirname);
+    printf("Keyring '%s' carregado com %zu chave(s).\n", dirname, cached.count);
+    return &cached;
+}
+
+/**
+ * @brief Menu para verificar a assinatura de um arquivo.
+ */
+void verify_file_menu()
+{
+    char signed_file_name[256], key_file[256];
+
+    printf("Digite o nome do arquivo assinado (ex: arquivo.txt.signed): ");
+    scanf("%255s", signed_file_name);
+    printf("Digite o nome do arquivo da chave pública ou do diretório do keyring (ex: public_key.txt): ");
+    scanf("%255s", key_file);
+
+    trace_record trace;
+    memset(&trace, 0, sizeof(trace));
+    trace_attach(trace_enabled ? &trace : NULL);
+
+    // 1. Ler o arquivo assinado e decodificar o Base64
+    signed_message msg;
+    if (!read_signed_file(signed_file_name, &msg) || !msg.signature)
+    {
+        printf("Erro: Formato de arquivo assinado inválido.\n");
+        signed_message_clear(&msg);
+        trace_attach(NULL);
+        return;
+    }
+    trace_attach(NULL); // A escolha da chave não é uma etapa da verificação
+
+    // Seleção da chave: arquivo informado ou busca no keyring pela impressão digital
+    rsa_key loaded_key;
+    const rsa_key *vkey = &loaded_key;
+    rsa_key_init(&loaded_key);
+
+    struct stat st;
+    if (stat(key_file, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        const keyring *kr = get_keyring(key_file);
+        vkey = NULL;
+        if (!kr)
+            printf("Erro: Não foi possível ler o keyring '%s'.\n", key_file);
+        else if (!msg.has_fingerprint)
+            printf("Erro: O arquivo assinado não contém a impressão digital da chave.\n");
+        else if (!(vkey = keyring_find(kr, msg.fingerprint)))
+            printf("Erro: Nenhuma chave do keyring corresponde à impressão digital do arquivo.\n");
+    }
+    else if (!load_rsa_key(key_file, &loaded_key, 0))
+    {
+        printf("Erro: Não foi possível carregar a chave pública de '%s'.\n", key_file);
+        vkey = NULL;
+    }
+
+    // 2. "Decifrar" a assinatura, remover o padding OAEP e comparar com o hash do conteúdo
+    trace_attach(trace_enabled ? &trace : NULL);
+    verify_status status = vkey ? rsa_verify_message(vkey, &msg) : VERIFY_NO_SIGNATURE;
+    trace_attach(NULL);
+    if (vkey && status == VERIFY_KEY_MISMATCH)
+    {
+        printf("Erro: O arquivo foi assinado com uma chave de %d bits, mas a chave informada tem %d bits.\n",
+               msg.bits, rsa_key_bits(vkey));
+    }
+    else if (vkey)
+    {
+        printf("\n=========================\n");
+        if (status == VERIFY_OK)
+            printf("ASSINATURA VÁLIDA!\n");
+        else if (status == VERIFY_BAD_PADDING)
+            printf("VERIFICAÇÃO FALHOU! (Erro no unpadding)\n");
+        else
+            printf("VERIFICAÇÃO FALHOU! (Hashes não correspondem)\n");
+        printf("=========================\n");
+    }
+    if (trace_enabled && vkey)
+        trace_record_print(stdout, &trace, signed_file_name);
+
+    // Limpeza
+    signed_message_clear(&msg);
+    rsa_key_clear(&loaded_key);
+}
+
+/**
+ * @brief Menu para extrair a mensagem original de um arquivo assinado.
+ */
+void extract_message_menu()
+{
+    char signed_file_name[256], output_file[256];
+
+    printf("Digite o nome do arquivo assinado (ex: arquivo.txt.signed): ");
+    scanf("%255s", signed_file_name);
+
+    // 1. Ler o arquivo assinado e decodificar a mensagem
+    signed_message msg;
+    if (!read_signed_file(signed_file_name, &msg))
+    {
+        printf("Erro: Não foi possível encontrar a mensagem no arquivo assinado '%s'.\n", signed_file_name);
+        signed_message_clear(&msg);
+        return;
+    }
+    const unsigned char *original_content = msg.content;
+    size_t original_content_len = msg.content_len;
+
+    printf("\nConteúdo da mensagem: ");
+    for (size_t i = 0; i < original_content_len; i++)
+    {
+        printf("%c", original_content[i]);
+    }
+    printf("\n\n");
+
+    printf("Deseja salvar a mensagem original em um arquivo? (s/n): ");
+    char save_choice;
+    scanf(" %c", &save_choice);
+    if (save_choice == 's' || save_choice == 'S')
+    {
+        printf("Digite o nome do arquivo de saída (ex: mensagem.txt): ");
+        scanf("%255s", output_file);
+
+        FILE *out_file = fopen(output_file, "wb");
+        if (!out_file)
+        {
+            printf("Erro ao criar o arquivo de saída '%s'.\n", output_file);
+        }
+        else
+        {
+            fwrite(original_content, 1, original_content_len, out_file);
+            fclose(out_file);
+            printf("Mensagem original salva em '%s'.\n", output_file);
+        }
+    }
+    else
+    {
+        printf("Mensagem original não salva.\n");
+    }
+    // Limpeza
+    signed_message_clear(&msg);
+}
+
+/**
+ * @brief Cliente: calcula o SHA3-256 do artefato localmente e grava o pedido '<arquivo>.sigreq'.
+ */
+static void create_digest_request()
+{
+    char file_name[256];
+    printf("Digite o nome do arquivo a ser assinado: ");
+    scanf("%255s", file_name);
+
+    unsigned char *content;
+    size_t len;
+    if (!read_file_content(file_name, &content, &len))
+    {
+        printf("Erro: Não foi possível ler o arquivo '%s'.\n", file_name);
+        return;
+    }
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    sha3_256(content, len, digest);
+    free(content);
+
+    char request_name[300];
+    snprintf(request_name, sizeof(request_name), "%s%s", file_name, DIGEST_REQUEST_SUFFIX);
+    if (!write_digest_request(request_name, digest))
+    {
+        printf("Erro ao criar arquivo de pedido '%s'.\n", request_name);
+        return;
+    }
+    printf("Pedido salvo em '%s' (%d bytes de digest). Envie-o ao host de assinatura.\n", request_name,
+           SHA3_256_DIGEST_SIZE);
+}
+
+/**
+ * @brief Host de assinatura: assina o digest de um pedido e grava a resposta '.sigresp'.
+ */
+static void sign_digest_request()
+{
+    char request_name[256], key_file[256];
+    printf("Digite o nome do arquivo de pedido (ex: arquivo.txt%s): ", DIGEST_REQUEST_SUFFIX);
+    scanf("%255s", request_name);
+    printf("Digite o nome do arquivo da chave privada (ex: private_key.txt): ");
+    scanf("%255s", key_file);
+
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    if (!read_digest_request(request_name, digest))
+    {
+        printf("Erro: '%s' não é um pedido de assinatura válido.\n", request_name);
+        return;
+    }
+
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 1))
+    {
+        printf("Erro: Não foi possível carregar a chave privada de '%s'.\n", key_file);
+        rsa_key_clear(&key);
+        return;
+    }
+
+    int k = rsa_key_bytes(&key);
+    unsigned char *signature = (unsigned char *)malloc(k);
+    if (!rsa_sign_digest(&key, SIGN_DOMAIN_PLAIN, digest, signature, thread_rng()))
+    {
+        printf("Erro ao aplicar padding OAEP.\n");
+        free(signature);
+        rsa_key_clear(&key);
+        return;
+    }
+    size_t sig_b64_len;
+    char *sig_b64 = base64_encode(signature, k, &sig_b64_len);
+
+    // arquivo.txt.sigreq -> arquivo.txt.sigresp
+    char response_name[300];
+    size_t base_len = strlen(request_name);
+    size_t suffix_len = strlen(DIGEST_REQUEST_SUFFIX);
+    if (base_len > suffix_len && strcmp(request_name + base_len - suffix_len, DIGEST_REQUEST_SUFFIX) == 0)
+        base_len -= suffix_len;
+    snprintf(response_name, sizeof(response_name), "%.*s%s", (int)base_len, request_name, DIGEST_RESPONSE_SUFFIX);
+
+    if (!write_digest_response(response_name, &key, digest, sig_b64))
+        printf("Erro ao criar arquivo de resposta '%s'.\n", response_name);
+    else
+        printf("Digest assinado; resposta salva em '%s'.\n", response_name);
+
+    free(signature);
+    free(sig_b64);
+    rsa_key_clear(&key);
+}
+
+/**
+ * @brief Cliente: confere a resposta do host contra o artefato local e monta '<arquivo>.signed'.
+ *
+ * A assinatura só é aceita se o digest da resposta for o do arquivo local, se a
+ * resposta vier da chave pública informada e se a assinatura recuperar o digest.
+ */
+static void assemble_signed_file()
+{
+    char file_name[256], response_name[256], key_file[256];
+    printf("Digite o nome do arquivo original: ");
+    scanf("%255s", file_name);
+    printf("Digite o nome do arquivo de resposta (ex: arquivo.txt%s): ", DIGEST_RESPONSE_SUFFIX);
+    scanf("%255s", response_name);
+    printf("Digite o nome do arquivo da chave pública (ex: public_key.txt): ");
+    scanf("%255s", key_file);
+
+    unsigned char fingerprint[SHA3_256_DIGEST_SIZE], signed_digest[SHA3_256_DIGEST_SIZE];
+    char *sig_b64;
+    if (!read_digest_response(response_name, fingerprint, signed_digest, &sig_b64))
+    {
+        printf("Erro: '%s' não é uma resposta de assinatura válida.\n", response_name);
+        return;
+    }
+
+    unsigned char *content;
+    size_t len;
+    if (!read_file_content(file_name, &content, &len))
+    {
+        printf("Erro: Não foi possível ler o arquivo '%s'.\n", file_name);
+        free(sig_b64);
+        return;
+    }
+
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 0))
+    {
+        printf("Erro: Não foi possível carregar a chave pública de '%s'.\n", key_file);
+        free(content);
+        free(sig_b64);
+        rsa_key_clear(&key);
+        return;
+    }
+
+    unsigned char digest[SHA3_256_DIGEST_SIZE], recovered[SHA3_256_DIGEST_SIZE];
+    sha3_256(content, len, digest);
+    size_t signature_len;
+    unsigned char *signature = base64_decode(sig_b64, strlen(sig_b64), &signature_len);
+
+    if (memcmp(fingerprint, key.fingerprint, SHA3_256_DIGEST_SIZE) != 0)
+        printf("Erro: A resposta foi assinada com outra chave.\n");
+    else if (memcmp(signed_digest, digest, SHA3_256_DIGEST_SIZE) != 0)
+        printf("Erro: O digest assinado não é o do arquivo '%s'.\n", file_name);
+    else if (!signature || !rsa_recover_digest(&key, SIGN_DOMAIN_PLAIN, signature, signature_len, recovered) ||
+             memcmp(recovered, digest, SHA3_256_DIGEST_SIZE) != 0)
+        printf("Erro: A assinatura da resposta não confere com o digest.\n");
+    else
+    {
+        size_t content_b64_len;
+        char *content_b64 = base64_encode(content, len, &content_b64_len);
+        char signed_filename[300];
+        snprintf(signed_filename, sizeof(signed_filename), "%s.signed", file_name);
+        if (!write_signed_file(signed_filename, &key, content_b64, sig_b64))
+            printf("Erro ao criar arquivo de saída '%s'.\n", signed_filename);
+        else
+            printf("Arquivo assinado com sucesso e salvo como '%s'.\n", signed_filename);
+        free(content_b64);
+    }
+
+    free(content);
+    free(signature);
+    free(sig_b64);
+    rsa_key_clear(&key);
+}
+
+/**
+ * @brief Menu de assinatura remota: o artefato fica no cliente e só o digest vai ao host da chave.
+ */
+void remote_sign_menu()
+{
+    int choice;
+
+    do
+    {
+        printf("\n--- Assinatura remota por digest ---\n");
+        printf("1. Criar pedido (cliente: calcula o hash localmente)\n");
+        printf("2. Assinar pedido (host da chave privada)\n");
+        printf("3. Montar arquivo assinado (cliente)\n");
+        printf("0. Voltar\n");
+        printf("Escolha uma opção: ");
+        if (scanf("%d", &choice) != 1)
+        {
+            while (getchar() != '\n')
+                ; // Limpa buffer de entrada
+            choice = -1;
+        }
+
+        switch (choice)
+        {
+        case 1:
+            create_digest_request();
+            break;
+        case 2:
+            sign_digest_request();
+            break;
+        case 3:
+            assemble_signed_file();
+            break;
+        case 0:
+            break;
+        default:
+            printf("Opção inválida! Tente novamente.\n");
+        }
+    } while (choice != 0);
+}
 
 /**
- * @brief Rotaciona bits à esquerda.
+ * @brief Menu para converter uma chave entre os formatos hexadecimal e binário.
+ *
+ * O sentido da conversão é detectado pelo formato do arquivo de entrada. Ao
+ * converter uma chave privada hexadecimal, p e q são recuperados a partir de
+ * n, e = 65537 e d para que os parâmetros CRT sejam gravados.
  */
-static uint64_t rotl64(uint64_t x, int n)
+void convert_key_menu()
 {
-    return (x << n) | (x >> (64 - n));
+    char input_file[256], output_file[256];
+    int type;
+
+    printf("Digite o nome do arquivo da chave de entrada: ");
+    scanf("%255s", input_file);
+    printf("Digite o nome do arquivo de saída: ");
+    scanf("%255s", output_file);
+    printf("Tipo da chave (1 = pública, 2 = privada): ");
+    if (scanf("%d", &type) != 1 || (type != 1 && type != 2))
+    {
+        printf("Tipo de chave inválido.\n");
+        return;
+    }
+    int is_private = type == 2;
+
+    rsa_key key;
+    rsa_key_init(&key);
+    int binary_input = is_binary_key_file(input_file);
+    if (!load_rsa_key(input_file, &key, is_private))
+    {
+        printf("Erro: Não foi possível carregar a chave de '%s'.\n", input_file);
+        rsa_key_clear(&key);
+        return;
+    }
+
+    int ok;
+    if (binary_input)
+    {
+        ok = save_key_hex(output_file, key.n, is_private ? key.d : key.e);
+    }
+    else
+    {
+        if (is_private)
+        {
+            if (!rsa_recover_primes(key.n, key.e, key.d, key.p, key.q))
+            {
+                printf("Erro: Não foi possível recuperar p e q (a chave usa e = 65537?).\n");
+                rsa_key_clear(&key);
+                return;
+            }
+            rsa_key_compute_crt(&key);
+        }
+        ok = save_key_binary(output_file, &key, is_private);
+    }
+
+    if (ok)
+        printf("Chave convertida para o formato %s e salva em '%s'.\n", binary_input ? "hexadecimal" : "binário", output_file);
+    else
+        printf("Erro ao salvar a chave em '%s'.\n", output_file);
+
+    rsa_key_clear(&key);
 }
 
 /**
- * @brief Implementação da função SHA3-256.
- * @param input Dados de entrada.
- * @param input_len Comprimento dos dados.
- * @param output Buffer para o hash (32 bytes).
+ * @brief Menu de benchmark: verificação genérica (mpz_powm) vs. caminho rápido e = 65537.
  */
-void sha3_256(const unsigned char *input, size_t input_len, unsigned char *output)
+void benchmark_verify_menu()
 {
-    // Constantes Keccak
-    static const uint64_t keccak_round_constants[24] = {
-        0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
-        0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
-        0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
-        0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
-        0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
-        0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
-        0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
-        0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+    char key_file[256];
+    int iterations;
+
+    printf("Digite o nome do arquivo da chave pública (ex: public_key.txt): ");
+    scanf("%255s", key_file);
+    printf("Número de iterações: ");
+    if (scanf("%d", &iterations) != 1 || iterations <= 0)
+    {
+        printf("Número de iterações inválido.\n");
+        return;
+    }
 
-    static const int rho_offsets[25] = {
-        0, 1, 62, 28, 27, 36, 44, 6, 55, 20, 3, 10, 43, 25, 39, 41, 45,
-        15, 21, 8, 18, 2, 61, 56, 14};
+    mpz_t n, e;
+    mpz_inits(n, e, NULL);
+    if (!load_key(key_file, n, e))
+    {
+        printf("Erro: Não foi possível carregar a chave pública de '%s'.\n", key_file);
+        mpz_clears(n, e, NULL);
+        return;
+    }
+    if (mpz_cmp_ui(e, 65537) != 0)
+    {
+        printf("Erro: O caminho rápido exige e = 65537.\n");
+        mpz_clears(n, e, NULL);
+        return;
+    }
 
-    uint64_t state[25] = {0};
-    size_t rate = 136;    // 1088 bits = 136 bytes para SHA3-256
-    size_t capacity = 64; // 512 bits = 64 bytes
+    // Assinatura de teste aleatória (apenas o custo da exponenciação importa)
+    int k = mpz_sizeinbase(n, 256);
+    drbg rng;
+    drbg_seed_ui(&rng, BENCHMARK_SEED);
+    mpz_t s, m;
+    mpz_inits(s, m, NULL);
+    drbg_urandomm(s, &rng, n);
+    size_t sig_len;
+    unsigned char *sig = (unsigned char *)mpz_export(NULL, &sig_len, 1, sizeof(unsigned char), 0, 0, s);
+    unsigned char *out_generic = calloc(k, 1);
+    unsigned char *out_fast = calloc(k, 1);
+
+    // Caminho atual: mpz_import + mpz_powm + mpz_export a cada chamada
+    double start = monotonic_seconds();
+    for (int i = 0; i < iterations; i++)
+    {
+        mpz_import(s, sig_len, 1, sizeof(unsigned char), 0, 0, sig);
+        mpz_powm(m, s, e, n);
+        size_t len;
+        unsigned char *buf = (unsigned char *)mpz_export(NULL, &len, 1, sizeof(unsigned char), 0, 0, m);
+        memset(out_generic, 0, k);
+        memcpy(out_generic + (k - len), buf, len);
+        arena_free(buf, len);
+    }
+    double generic_time = monotonic_seconds() - start;
 
-    // Padding
-    size_t padded_len = input_len;
-    if ((input_len % rate) != (rate - 1))
+    // Caminho rápido: contexto de Montgomery criado uma vez por chave
+    mont_ctx ctx;
+    mont_ctx_init(&ctx, n);
+    start = monotonic_seconds();
+    for (int i = 0; i < iterations; i++)
     {
-        padded_len = ((input_len / rate) + 1) * rate;
+        rsa_verify_e65537(&ctx, sig, sig_len, out_fast, k);
     }
+    double fast_time = monotonic_seconds() - start;
+    mont_ctx_clear(&ctx);
+
+    printf("\nChave de %d bits, %d iterações\n", (int)mpz_sizeinbase(n, 2), iterations);
+    printf("mpz_powm genérico:    %10.2f us/verificação\n", generic_time * 1e6 / iterations);
+    printf("Montgomery e = 65537: %10.2f us/verificação\n", fast_time * 1e6 / iterations);
+    printf("Aceleração: %.2fx\n", generic_time / fast_time);
+    printf("Resultados %s.\n", memcmp(out_generic, out_fast, k) == 0 ? "idênticos" : "DIVERGENTES");
+
+    arena_free(sig, sig_len);
+    free(out_generic);
+    free(out_fast);
+    mpz_clears(n, e, s, m, NULL);
+}
+
+/**
+ * @brief Garante que uma chave privada tenha os parâmetros CRT, recuperando p e q se preciso.
+ * @return 1 se os parâmetros CRT estiverem disponíveis, 0 caso contrário.
+ */
+static int ensure_crt(rsa_key *key)
+{
+    if (key->has_crt)
+        return 1;
+    if (!rsa_recover_primes(key->n, key->e, key->d, key->p, key->q))
+        return 0;
+    rsa_key_compute_crt(key);
+    return 1;
+}
+
+/**
+ * @brief Menu para assinar em lote os arquivos listados em um arquivo (um por linha).
+ *
+ * Os arquivos são processados em grupos de MB_LANES, cujas operações privadas
+ * são feitas juntas por rsa_private_op_batch.
+ */
+void batch_sign_menu()
+{
+    char list_file[256], key_file[256];
+
+    printf("Digite o nome do arquivo com a lista de arquivos a assinar (um por linha): ");
+    scanf("%255s", list_file);
+    printf("Digite o nome do arquivo da chave privada (ex: private_key.txt): ");
+    scanf("%255s", key_file);
 
-    unsigned char *padded = calloc(padded_len, 1);
-    memcpy(padded, input, input_len);
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 1))
+    {
+        printf("Erro: Não foi possível carregar a chave privada de '%s'.\n", key_file);
+        rsa_key_clear(&key);
+        return;
+    }
+    if (!ensure_crt(&key))
+        printf("Aviso: Parâmetros CRT indisponíveis; o lote será assinado sem CRT.\n");
 
-    // Aplicar padding 10*1
-    padded[input_len] = 0x06; // SHA3 padding
-    padded[padded_len - 1] |= 0x80;
+    FILE *list = fopen(list_file, "r");
+    if (!list)
+    {
+        printf("Erro ao abrir a lista '%s'.\n", list_file);
+        rsa_key_clear(&key);
+        return;
+    }
 
-    // Absorção
-    for (size_t i = 0; i < padded_len; i += rate)
+    int k = rsa_key_bytes(&key);
+    oaep_ctx *oaep = oaep_thread_ctx(k);
+    if (!oaep)
+    {
+        fprintf(stderr, "Erro: Não foi possível preparar o contexto OAEP.\n");
+        fclose(list);
+        rsa_key_clear(&key);
+        return;
+    }
+    int signed_count = 0, failed_count = 0, ifma_batches = 0, batches = 0;
+    char names[MB_LANES][512];
+    int done = 0;
+    trace_histogram hist;
+    trace_histogram_init(&hist);
+    double start = monotonic_seconds();
+
+    while (!done)
     {
-        for (size_t j = 0; j < rate / 8; j++)
+        // Coleta até MB_LANES nomes de arquivo
+        int count = 0;
+        char line[512];
+        while (count < MB_LANES && fgets(line, sizeof(line), list))
+        {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '\0')
+                continue;
+            snprintf(names[count++], sizeof(names[0]), "%s", line);
+        }
+        if (count < MB_LANES)
+            done = 1;
+        if (count == 0)
+            break;
+
+        arena_begin();
+        mpz_t in[MB_LANES], out[MB_LANES];
+        unsigned char *contents[MB_LANES];
+        size_t lengths[MB_LANES];
+        int index[MB_LANES];
+        int ready = 0;
+        trace_record traces[MB_LANES];
+        memset(traces, 0, sizeof(traces));
+
+        for (int i = 0; i < count; i++)
+        {
+            unsigned char *file_hash, padded_hash[k];
+            unsigned int hash_len;
+            trace_attach(trace_enabled ? &traces[i] : NULL);
+            double t = trace_start();
+            if (!read_file_content(names[i], &contents[ready], &lengths[ready]))
+            {
+                printf("Erro: Não foi possível ler o arquivo '%s'.\n", names[i]);
+                failed_count++;
+                continue;
+            }
+            trace_stop(TRACE_READ, t);
+            t = trace_start();
+            sha3_hash(contents[ready], lengths[ready], &file_hash, &hash_len);
+            trace_stop(TRACE_HASH, t);
+            t = trace_start();
+            oaep_status padded = rsa_oaep_pad(oaep, SIGN_DOMAIN_PLAIN, file_hash, hash_len, padded_hash, thread_rng());
+            trace_stop(TRACE_OAEP, t);
+            if (padded != OAEP_OK)
+            {
+                fprintf(stderr, "Erro: '%s': %s.\n", names[i], oaep_status_message(padded));
+                free(contents[ready]);
+                free(file_hash);
+                failed_count++;
+                continue;
+            }
+            mpz_inits(in[ready], out[ready], NULL);
+            mpz_import(in[ready], k, 1, sizeof(unsigned char), 0, 0, padded_hash);
+            free(file_hash);
+            index[ready++] = i;
+        }
+
+        trace_attach(NULL);
+
+        if (ready > 0)
+        {
+            // As operações privadas do lote são simultâneas: cada assinatura recebe uma parte igual
+            double t = monotonic_seconds();
+            ifma_batches += rsa_private_op_batch(&key, out, in, ready, 1);
+            batches++;
+            t = monotonic_seconds() - t;
+            for (int r = 0; trace_enabled && r < ready; r++)
+                trace_record_add(&traces[index[r]], TRACE_MODEXP, t / ready);
+        }
+
+        for (int r = 0; r < ready; r++)
         {
-            uint64_t word = 0;
-            for (int k = 0; k < 8; k++)
+            trace_attach(trace_enabled ? &traces[index[r]] : NULL);
+            double t = trace_start();
+            // Largura fixa de k bytes (zeros à esquerda), como em rsa_sign_digest
+            size_t signature_len = k, exported, content_b64_len, sig_b64_len;
+            unsigned char *signature = (unsigned char *)arena_alloc(signature_len);
+            memset(signature, 0, signature_len);
+            mpz_export(signature + k - mpz_sizeinbase(out[r], 256), &exported, 1, sizeof(unsigned char), 0, 0, out[r]);
+            char *content_b64 = base64_encode(contents[r], lengths[r], &content_b64_len);
+            char *sig_b64 = base64_encode(signature, signature_len, &sig_b64_len);
+            trace_stop(TRACE_BASE64, t);
+
+            char signed_filename[600];
+            snprintf(signed_filename, sizeof(signed_filename), "%s.signed", names[index[r]]);
+            t = trace_start();
+            int written = write_signed_file(signed_filename, &key, content_b64, sig_b64);
+            trace_stop(TRACE_WRITE, t);
+            trace_attach(NULL);
+            if (written)
+            {
+                signed_count++;
+                if (trace_enabled)
+                    trace_histogram_add(&hist, &traces[index[r]]);
+            }
+            else
             {
-                if (i + j * 8 + k < padded_len)
-                {
-                    word |= ((uint64_t)padded[i + j * 8 + k]) << (k * 8);
-                }
+                printf("Erro ao criar arquivo de saída '%s'.\n", signed_filename);
+                failed_count++;
             }
-            state[j] ^= word;
+
+            arena_free(signature, signature_len);
+            free(content_b64);
+            free(sig_b64);
+            free(contents[r]);
+            mpz_clears(in[r], out[r], NULL);
         }
+        arena_end();
+    }
+    fclose(list);
+
+    double elapsed = monotonic_seconds() - start;
+    printf("\n%d arquivo(s) assinado(s), %d falha(s), em %.3f s.\n", signed_count, failed_count, elapsed);
+    printf("Lotes com AVX-512 IFMA: %d de %d.\n", ifma_batches, batches);
+    if (trace_enabled && signed_count > 0)
+        trace_histogram_print(stdout, &hist, "Assinatura em lote");
+    rsa_key_clear(&key);
+}
+
+/**
+ * @brief Menu de benchmark: assinatura em lote com GMP vs. AVX-512 IFMA.
+ *
+ * Mede apenas a operação privada (CRT) sobre mensagens aleatórias, em uma
+ * única thread, e reporta assinaturas por segundo por núcleo.
+ */
+void benchmark_batch_sign_menu()
+{
+    char key_file[256];
+    int total;
 
-        // Keccak-f[1600]
-        for (int round = 0; round < 24; round++)
+    printf("Digite o nome do arquivo da chave privada (ex: private_key.txt): ");
+    scanf("%255s", key_file);
+    printf("Número de assinaturas: ");
+    if (scanf("%d", &total) != 1 || total <= 0)
+    {
+        printf("Número de assinaturas inválido.\n");
+        return;
+    }
+
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 1) || !ensure_crt(&key))
+    {
+        printf("Erro: Não foi possível carregar a chave privada (com CRT) de '%s'.\n", key_file);
+        rsa_key_clear(&key);
+        return;
+    }
+    if (!mb_ifma_available())
+        printf("Aviso: AVX-512 IFMA indisponível; os dois caminhos usarão o GMP.\n");
+
+    drbg rng;
+    drbg_seed_ui(&rng, BENCHMARK_SEED);
+    mpz_t *msgs = malloc(total * sizeof(mpz_t));
+    mpz_t *sig_gmp = malloc(total * sizeof(mpz_t));
+    mpz_t *sig_ifma = malloc(total * sizeof(mpz_t));
+    for (int i = 0; i < total; i++)
+    {
+        mpz_inits(msgs[i], sig_gmp[i], sig_ifma[i], NULL);
+        drbg_urandomm(msgs[i], &rng, key.n);
+    }
+
+    double start = monotonic_seconds();
+    for (int i = 0; i < total; i += MB_LANES)
+    {
+        int count = total - i < MB_LANES ? total - i : MB_LANES;
+        rsa_private_op_batch(&key, sig_gmp + i, msgs + i, count, 0);
+    }
+    double gmp_time = monotonic_seconds() - start;
+
+    start = monotonic_seconds();
+    for (int i = 0; i < total; i += MB_LANES)
+    {
+        int count = total - i < MB_LANES ? total - i : MB_LANES;
+        rsa_private_op_batch(&key, sig_ifma + i, msgs + i, count, 1);
+    }
+    double ifma_time = monotonic_seconds() - start;
+
+    int mismatches = 0;
+    for (int i = 0; i < total; i++)
+        mismatches += mpz_cmp(sig_gmp[i], sig_ifma[i]) != 0;
+
+    printf("\nChave de %d bits (CRT), %d assinaturas, 1 thread\n", rsa_key_bits(&key), total);
+    printf("GMP (mpz_powm):    %10.1f assinaturas/s/núcleo\n", total / gmp_time);
+    printf("AVX-512 IFMA (x8): %10.1f assinaturas/s/núcleo\n", total / ifma_time);
+    printf("Aceleração: %.2fx\n", gmp_time / ifma_time);
+    printf("Resultados %s.\n", mismatches == 0 ? "idênticos" : "DIVERGENTES");
+
+    for (int i = 0; i < total; i++)
+        mpz_clears(msgs[i], sig_gmp[i], sig_ifma[i], NULL);
+    free(msgs);
+    free(sig_gmp);
+    free(sig_ifma);
+    rsa_key_clear(&key);
+}
+
+/**
+ * @brief Mede a geração de 'count' primos com o crivo e o teste de primalidade dado.
+ * @return Tempo total em segundos.
+ */
+static double time_prime_generation(primality_mode mode, int rounds, int bits, int count, unsigned long seed)
+{
+    primality_mode saved_mode = prime_test_mode;
+    int saved_rounds = prime_test_rounds;
+    prime_test_mode = mode;
+    prime_test_rounds = rounds;
+
+    drbg rng;
+    drbg_seed_ui(&rng, seed);
+    mpz_t prime;
+    mpz_init(prime);
+
+    double start = monotonic_seconds();
+    for (int i = 0; i < count; i++)
+        generate_prime(prime, bits, &rng);
+    double elapsed = monotonic_seconds() - start;
+
+    mpz_clear(prime);
+    prime_test_mode = saved_mode;
+    prime_test_rounds = saved_rounds;
+    return elapsed;
+}
+
+/**
+ * @brief Mede a geração de 'count' pares de primos com generate_prime_pair.
+ * @return Tempo total em segundos.
+ */
+static double time_prime_pairs(int threads, int bits, int count, unsigned long seed)
+{
+    drbg rng;
+    drbg_seed_ui(&rng, seed);
+    mpz_t p, q;
+    mpz_inits(p, q, NULL);
+
+    double start = monotonic_seconds();
+    for (int i = 0; i < count; i++)
+        generate_prime_pair(p, q, bits, &rng, threads);
+    double elapsed = monotonic_seconds() - start;
+
+    mpz_clears(p, q, NULL);
+    return elapsed;
+}
+
+/**
+ * @brief Compara os motores de Miller-Rabin (mpz e Montgomery) em primos e em compostos.
+ *
+ * Os primos recebem as rodadas do FIPS 186-5 (caso da confirmação final; o motor
+ * de Montgomery faz ainda a rodada prévia na base 2); os compostos são ímpares
+ * aleatórios sem fatores pequenos, como os sobreviventes do crivo, e quase sempre
+ * caem na primeira rodada.
+ */
+static void benchmark_miller_rabin_engines(int bits, unsigned long seed)
+{
+    enum
+    {
+        SAMPLES = 32
+    };
+    int rounds = fips_miller_rabin_rounds(bits);
+    drbg rng;
+    drbg_seed_ui(&rng, seed);
+
+    mpz_t primes[SAMPLES], composites[SAMPLES];
+    for (int i = 0; i < SAMPLES; i++)
+    {
+        mpz_inits(primes[i], composites[i], NULL);
+        generate_prime(primes[i], bits, &rng);
+        do
+        {
+            drbg_urandomb(composites[i], &rng, bits);
+            mpz_setbit(composites[i], bits - 1);
+            mpz_setbit(composites[i], 0);
+        } while (mpz_probab_prime_p(composites[i], 1) || mpz_gcd_ui(NULL, composites[i], 3234846615UL) != 1);
+    }
+
+    // Os motores se alternam a cada amostra, para que variações de frequência os afetem igualmente
+    double times[2][2] = {{0}}; // [motor][primo/composto]
+    int agree = 1;
+    for (int kind = 0; kind < 2; kind++)
+    {
+        mpz_t *set = kind == 0 ? primes : composites;
+        for (int i = 0; i < SAMPLES; i++)
         {
-            // θ (Theta)
-            uint64_t C[5], D[5];
-            for (int x = 0; x < 5; x++)
+            for (int engine = 0; engine < 2; engine++)
             {
-                C[x] = state[x] ^ state[x + 5] ^ state[x + 10] ^ state[x + 15] ^ state[x + 20];
+                double start = monotonic_seconds();
+                int result = engine == 0 ? miller_rabin_test(set[i], rounds, &rng)
+                                         : miller_rabin_test_mont(set[i], rounds, &rng);
+                times[engine][kind] += (monotonic_seconds() - start) / SAMPLES;
+                agree &= result == (kind == 0);
             }
-            for (int x = 0; x < 5; x++)
+        }
+    }
+
+    printf("\nMiller-Rabin isolado (%d bits, %d rodadas nos primos)\n", bits, rounds);
+    printf("%-14s %14s %14s\n", "Motor", "Primo (us)", "Composto (us)");
+    printf("%-14s %14.1f %14.1f\n", "mpz", times[0][0] * 1e6, times[0][1] * 1e6);
+    printf("%-14s %14.1f %14.1f\n", mb_ifma_available() ? "Montgomery52" : "Montgomery", times[1][0] * 1e6,
+           times[1][1] * 1e6);
+    printf("Aceleração: %.2fx (primo), %.2fx (composto); resultados %s.\n", times[0][0] / times[1][0],
+           times[0][1] / times[1][1], agree ? "corretos" : "DIVERGENTES");
+    printf("Motor usado na geração de primos de %d bits: %s (Montgomery a partir de %d bits).\n", bits,
+           bits < MR_MONT_MIN_BITS ? "mpz" : "Montgomery", MR_MONT_MIN_BITS);
+
+    for (int i = 0; i < SAMPLES; i++)
+        mpz_clears(primes[i], composites[i], NULL);
+}
+
+/**
+ * @brief Menu de benchmark: métodos de busca e testes de primalidade na geração de primos.
+ *
+ * Compara o sorteio simples com 40 rodadas (método original) e a busca com crivo
+ * usando 40 rodadas de Miller-Rabin, as rodadas do FIPS 186-5 e o Baillie-PSW.
+ * O custo de uma chave é o de dois primos de metade do tamanho do módulo. Por fim,
+ * mede a geração de pares p, q com uma thread e com o pool de keygen_thread_count().
+ */
+void benchmark_prime_menu()
+{
+    int bits, count;
+
+    printf("Número de bits de cada primo (ex: 1024): ");
+    if (scanf("%d", &bits) != 1 || bits < 16)
+    {
+        printf("Número de bits inválido.\n");
+        return;
+    }
+    printf("Número de primos: ");
+    if (scanf("%d", &count) != 1 || count <= 0)
+    {
+        printf("Número de primos inválido.\n");
+        return;
+    }
+
+    // A mesma semente fixa para todos os métodos: todos percorrem os mesmos candidatos
+    unsigned long seed = BENCHMARK_SEED;
+    drbg rng;
+    mpz_t prime;
+    mpz_init(prime);
+
+    drbg_seed_ui(&rng, seed);
+    double start = monotonic_seconds();
+    for (int i = 0; i < count; i++)
+        generate_prime_trial(prime, bits, &rng);
+    double trial_time = monotonic_seconds() - start;
+
+    mpz_clear(prime);
+
+    double mr40_time = time_prime_generation(PRIMALITY_MILLER_RABIN, MILLER_RABIN_ITERATIONS, bits, count, seed);
+    double fips_time = time_prime_generation(PRIMALITY_MILLER_RABIN, 0, bits, count, seed);
+    double bpsw_time = time_prime_generation(PRIMALITY_BPSW, 0, bits, count, seed);
+
+    printf("\n%d primo(s) de %d bits (chave de %d bits = 2 primos), semente fixa %lu\n", count, bits, 2 * bits,
+           seed);
+    char fips_label[64];
+    snprintf(fips_label, sizeof(fips_label), "Crivo + M-R (FIPS 186-5, %d)", fips_miller_rabin_rounds(bits));
+    printf("%-37s %12s %12s\n", "Método", "ms/primo", "ms/chave");
+    printf("%-36s %12.2f %12.2f\n", "Sorteio simples + M-R (40)", trial_time * 1e3 / count, 2 * trial_time * 1e3 / count);
+    printf("%-36s %12.2f %12.2f\n", "Crivo + M-R (40)", mr40_time * 1e3 / count, 2 * mr40_time * 1e3 / count);
+    printf("%-36s %12.2f %12.2f\n", fips_label, fips_time * 1e3 / count, 2 * fips_time * 1e3 / count);
+    printf("%-36s %12.2f %12.2f\n", "Crivo + Baillie-PSW", bpsw_time * 1e3 / count, 2 * bpsw_time * 1e3 / count);
+    printf("Aceleração do crivo (40 rodadas): %.2fx\n", trial_time / mr40_time);
+    printf("Rodadas FIPS vs. 40 rodadas: %.2fx | Baillie-PSW vs. 40 rodadas: %.2fx\n", mr40_time / fips_time,
+           mr40_time / bpsw_time);
+
+    // Miller-Rabin isolado: motor mpz (mpz_powm + mpz_powm_ui) vs. motor de Montgomery
+    benchmark_miller_rabin_engines(bits, seed);
+
+    // Latência de um par p, q com o teste atual, serial e com o pool de threads
+    int threads = keygen_thread_count();
+    double pair_serial = time_prime_pairs(1, bits, count, seed);
+    double pair_parallel = time_prime_pairs(threads, bits, count, seed);
+    printf("\nPar p, q (%s), %d par(es)\n", prime_test_mode == PRIMALITY_BPSW ? "Baillie-PSW" : "M-R FIPS 186-5",
+           count);
+    printf("1 thread:   %10.2f ms/par\n", pair_serial * 1e3 / count);
+    printf("%d thread(s): %8.2f ms/par (%.2fx)\n", threads, pair_parallel * 1e3 / count, pair_serial / pair_parallel);
+}
+
+/**
+ * @brief Menu de benchmark por tamanho de chave: geração, assinatura e verificação.
+ *
+ * Para cada tamanho em key_sizes (até o maior escolhido), gera 'keys' chaves com
+ * o teste de primalidade e as threads atuais e mede, com a última chave,
+ * 'ops' assinaturas (OAEP + CRT) e verificações (e = 65537 + remoção do OAEP)
+ * de um hash SHA3-256 fixo. Cada assinatura é conferida na verificação.
+ */
+void benchmark_key_sizes_menu()
+{
+    int max_bits, keys, ops;
+
+    printf("Maior tamanho de chave (2048, 3072, 4096 ou 8192): ");
+    if (scanf("%d", &max_bits) != 1 || !key_size_supported(max_bits))
+    {
+        printf("Tamanho de chave inválido.\n");
+        return;
+    }
+    printf("Chaves geradas por tamanho: ");
+    if (scanf("%d", &keys) != 1 || keys <= 0)
+    {
+        printf("Número de chaves inválido.\n");
+        return;
+    }
+    printf("Assinaturas e verificações por tamanho: ");
+    if (scanf("%d", &ops) != 1 || ops <= 0)
+    {
+        printf("Número de operações inválido.\n");
+        return;
+    }
+
+    drbg rng;
+    drbg_seed_ui(&rng, BENCHMARK_SEED);
+
+    unsigned char hash[SHA3_256_DIGEST_SIZE];
+    sha3_256((const unsigned char *)"benchmark", 9, hash);
+
+    int threads = keygen_thread_count();
+    printf("\n%d chave(s) e %d operação(ões) por tamanho, %d thread(s) na geração, %s\n", keys, ops, threads,
+           prime_test_mode == PRIMALITY_BPSW ? "Baillie-PSW" : "Miller-Rabin FIPS 186-5");
+    printf("%6s %16s %14s %16s %12s %12s\n", "Bits", "Geração (ms)", "Assinar (ms)", "Verificar (us)", "Assin./s",
+           "Verif./s");
+
+    for (int i = 0; i < KEY_SIZE_COUNT && key_sizes[i] <= max_bits; i++)
+    {
+        int bits = key_sizes[i];
+        rsa_key key;
+        rsa_key_init(&key);
+
+        double start = monotonic_seconds();
+        for (int j = 0; j < keys; j++)
+        {
+            rsa_key_clear(&key);
+            rsa_key_init(&key);
+            rsa_key_generate(&key, bits, &rng, threads);
+        }
+        double keygen_time = (monotonic_seconds() - start) / keys;
+
+        int k = rsa_key_bytes(&key);
+        unsigned char *sig = calloc(k, 1);
+        unsigned char *decoded = calloc(k, 1);
+        unsigned char *padded = calloc(k, 1);
+        oaep_ctx *oaep = oaep_thread_ctx(k);
+        mpz_t em, s;
+        mpz_init2(em, bits); // Alocados fora da arena: sobrevivem aos escopos do laço
+        mpz_init2(s, bits);
+        int failures = 0;
+        double sign_time = 0, verify_time = 0;
+
+        for (int j = 0; j < ops; j++)
+        {
+            arena_begin();
+            start = monotonic_seconds();
+            rsa_oaep_pad(oaep, SIGN_DOMAIN_PLAIN, hash, SHA3_256_DIGEST_SIZE, padded, &rng);
+            mpz_import(em, k, 1, 1, 0, 0, padded);
+            rsa_private_op(&key, s, em);
+            size_t sig_len;
+            memset(sig, 0, k);
+            mpz_export(sig + k - (mpz_sizeinbase(s, 256)), &sig_len, 1, 1, 0, 0, s);
+            sign_time += monotonic_seconds() - start;
+
+            start = monotonic_seconds();
+            unsigned char recovered[SHA3_256_DIGEST_SIZE];
+            size_t recovered_len;
+            int ok = rsa_verify_e65537(&key.mont, sig, k, decoded, k) &&
+                     rsa_oaep_unpad(oaep, SIGN_DOMAIN_PLAIN, decoded, recovered, sizeof(recovered), &recovered_len) ==
+                         OAEP_OK;
+            verify_time += monotonic_seconds() - start;
+            if (ok)
             {
-                D[x] = C[(x + 4) % 5] ^ rotl64(C[(x + 1) % 5], 1);
+                if (recovered_len != SHA3_256_DIGEST_SIZE || memcmp(recovered, hash, recovered_len) != 0)
+                    failures++;
             }
-            for (int x = 0; x < 5; x++)
+            else
             {
-                for (int y = 0; y < 5; y++)
-                {
-                    state[y * 5 + x] ^= D[x];
-                }
+                failures++;
             }
+            arena_end();
+        }
+
+        printf("%6d %14.1f %14.3f %16.1f %12.0f %12.0f%s\n", bits, keygen_time * 1e3, sign_time * 1e3 / ops,
+               verify_time * 1e6 / ops, ops / sign_time, ops / verify_time, failures ? "  FALHAS!" : "");
+        fflush(stdout);
+
+        free(sig);
+        free(decoded);
+        free(padded);
+        mpz_clears(em, s, NULL);
+        rsa_key_clear(&key);
+    }
+}
+
+static keypool key_pool; // Pool do menu 10; key_pool.keys == NULL quando parado
+
+/**
+ * @brief Menu do pool de chaves pré-geradas: iniciar, provisionar, métricas e parar.
+ *
+ * O pool continua sendo reposto em segundo plano enquanto o programa usa os
+ * outros menus, e é parado ao sair.
+ */
+void keypool_menu()
+{
+    int choice;
+
+    do
+    {
+        printf("\n--- Pool de chaves (%s) ---\n", key_pool.keys ? "em execução" : "parado");
+        printf("1. Iniciar pool\n");
+        printf("2. Provisionar chave\n");
+        printf("3. Métricas\n");
+        printf("4. Parar pool\n");
+        printf("0. Voltar\n");
+        printf("Escolha uma opção: ");
+        if (scanf("%d", &choice) != 1)
+        {
+            while (getchar() != '\n')
+                ; // Limpa buffer de entrada
+            choice = -1;
+        }
 
-            // ρ (Rho) and π (Pi)
-            uint64_t current = state[1];
-            for (int t = 0; t < 24; t++)
+        switch (choice)
+        {
+        case 1:
+        {
+            if (key_pool.keys)
+            {
+                printf("O pool já está em execução.\n");
+                break;
+            }
+            int bits = prompt_key_bits();
+            if (!bits)
+                break;
+            int depth, refillers;
+            printf("Profundidade do pool (chaves prontas, 1 a %d): ", KEYPOOL_MAX_DEPTH);
+            if (scanf("%d", &depth) != 1)
+                depth = 0;
+            printf("Threads de reposição (1 a %d): ", KEYPOOL_MAX_REFILLERS);
+            if (scanf("%d", &refillers) != 1)
+                refillers = 0;
+            if (keypool_start(&key_pool, depth, bits, refillers))
+                printf("Pool iniciado: %d chave(s) de %d bits, %d thread(s) de reposição.\n", depth, bits,
+                       key_pool.refiller_count);
+            else
+                fprintf(stderr, "Erro: Não foi possível iniciar o pool: %s.\n", strerror(errno));
+            break;
+        }
+        case 2:
+        {
+            if (!key_pool.keys)
+            {
+                printf("Erro: O pool não está em execução.\n");
+                break;
+            }
+            char prefix[256], public_file[300], private_file[300];
+            printf("Prefixo dos arquivos da chave (ex: sessao1): ");
+            scanf("%255s", prefix);
+            snprintf(public_file, sizeof(public_file), "%s_public.bin", prefix);
+            snprintf(private_file, sizeof(private_file), "%s_private.bin", prefix);
+
+            rsa_key key;
+            double start = monotonic_seconds();
+            if (!keypool_take(&key_pool, &key))
             {
-                int x = ((t + 1) * (t + 2) / 2) % 25;
-                uint64_t temp = state[x];
-                state[x] = rotl64(current, rho_offsets[x]);
-                current = temp;
+                printf("Erro: O pool foi parado.\n");
+                break;
             }
+            double take_time = monotonic_seconds() - start;
+            int saved = save_key_binary(public_file, &key, 0) && save_key_binary(private_file, &key, 1);
+            double total_time = monotonic_seconds() - start;
 
-            // χ (Chi)
-            for (int y = 0; y < 5; y++)
+            if (saved)
+            {
+                char fp_hex[2 * SHA3_256_DIGEST_SIZE + 1];
+                bytes_to_hex(key.fingerprint, SHA3_256_DIGEST_SIZE, fp_hex);
+                printf("Chave provisionada em '%s' e '%s'.\n", public_file, private_file);
+                printf("Impressão digital: %s\n", fp_hex);
+                printf("Latência: %.3f ms no pool, %.3f ms no total.\n", take_time * 1e3, total_time * 1e3);
+            }
+            else
+            {
+                printf("Erro ao salvar a chave provisionada.\n");
+            }
+            rsa_key_clear(&key);
+            break;
+        }
+        case 3:
+            if (key_pool.keys)
+                keypool_print_metrics(stdout, &key_pool);
+            else
+                printf("O pool não está em execução.\n");
+            break;
+        case 4:
+            if (key_pool.keys)
             {
-                uint64_t temp[5];
-                for (int x = 0; x < 5; x++)
-                {
-                    temp[x] = state[y * 5 + x];
-                }
-                for (int x = 0; x < 5; x++)
-                {
-                    state[y * 5 + x] = temp[x] ^ ((~temp[(x + 1) % 5]) & temp[(x + 2) % 5]);
-                }
+                printf("Parando o pool (aguardando gerações em andamento)...\n");
+                keypool_stop(&key_pool);
             }
-
-            // ι (Iota)
-            state[0] ^= keccak_round_constants[round];
+            break;
+        case 0:
+            break;
+        default:
+            printf("Opção inválida! Tente novamente.\n");
         }
-    }
+    } while (choice != 0);
+}
 
-    // Extração (squeeze)
-    for (int i = 0; i < SHA3_256_DIGEST_SIZE; i++)
+/**
+ * @brief Motivo de uma falha de verificação, para as mensagens dos menus e dos subcomandos.
+ */
+static const char *verify_reason(verify_status status)
+{
+    switch (status)
     {
-        output[i] = (state[i / 8] >> ((i % 8) * 8)) & 0xFF;
+    case VERIFY_OK:
+        return NULL;
+    case VERIFY_NO_SIGNATURE:
+        return "sem assinatura";
+    case VERIFY_KEY_MISMATCH:
+        return "tamanho de chave diferente";
+    case VERIFY_BAD_PADDING:
+        return "erro no unpadding";
+    case VERIFY_BAD_DIGEST:
+        break;
     }
-
-    free(padded);
+    return "hashes não correspondem";
 }
 
-// --- Funções de Base64 (Implementação auto-contida) ---
-
-static const char b64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
 /**
- * @brief Codifica dados em Base64.
- * @param src Ponteiro para os dados de origem.
- * @param src_len Comprimento dos dados de origem.
- * @param out_len Ponteiro para armazenar o comprimento da saída.
- * @return Ponteiro para a string Base64 alocada (deve ser liberada).
+ * @brief Lê e valida um manifesto assinado.
+ * @return 1 em sucesso, 0 em falha (a mensagem de erro já foi impressa em 'err').
  */
-char *base64_encode(const unsigned char *src, size_t src_len, size_t *out_len)
+static int load_manifest(const char *filename, merkle_manifest *m, FILE *err)
 {
-    *out_len = 4 * ((src_len + 2) / 3);
-    char *encoded_data = malloc(*out_len + 1);
-    if (encoded_data == NULL)
-        return NULL;
-
-    for (size_t i = 0, j = 0; i < src_len;)
+    unsigned char *text;
+    size_t len;
+    if (!read_file_content(filename, &text, &len))
     {
-        uint32_t octet_a = i < src_len ? (unsigned char)src[i++] : 0;
-        uint32_t octet_b = i < src_len ? (unsigned char)src[i++] : 0;
-        uint32_t octet_c = i < src_len ? (unsigned char)src[i++] : 0;
-        uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
-        encoded_data[j++] = b64_table[(triple >> 3 * 6) & 0x3F];
-        encoded_data[j++] = b64_table[(triple >> 2 * 6) & 0x3F];
-        encoded_data[j++] = b64_table[(triple >> 1 * 6) & 0x3F];
-        encoded_data[j++] = b64_table[(triple >> 0 * 6) & 0x3F];
+        fprintf(err, "Erro: Não foi possível ler o manifesto '%s'.\n", filename);
+        return 0;
     }
-
-    int mod_table[] = {0, 2, 1};
-    for (int i = 0; i < mod_table[src_len % 3]; i++)
+    int ok = merkle_manifest_parse((const char *)text, len, m);
+    free(text);
+    if (!ok)
     {
-        encoded_data[*out_len - 1 - i] = '=';
+        fprintf(err, "Erro: '%s' não é um manifesto válido (ou a raiz não confere com os arquivos listados).\n",
+                filename);
+        merkle_manifest_clear(m);
     }
-    encoded_data[*out_len] = '\0';
-    return encoded_data;
+    return ok;
 }
 
 /**
- * @brief Decodifica uma string Base64.
- * @param src Ponteiro para a string Base64.
- * @param src_len Comprimento da string Base64.
- * @param out_len Ponteiro para armazenar o comprimento dos dados decodificados.
- * @return Ponteiro para os dados decodificados (deve ser liberado).
+ * @brief Imprime um caminho com '\n' e '\r' escapados, para que cada entrada ocupe uma linha.
  */
-unsigned char *base64_decode(const char *src, size_t src_len, size_t *out_len)
+static void print_path(FILE *out, const char *path)
 {
-    unsigned char dtable[256];
-    memset(dtable, 0x80, 256);
-    for (int i = 0; i < 64; i++)
-        dtable[(unsigned char)b64_table[i]] = i;
-
-    if (src_len % 4 != 0)
-        return NULL;
-    *out_len = src_len / 4 * 3;
-    if (src[src_len - 1] == '=')
-        (*out_len)--;
-    if (src[src_len - 2] == '=')
-        (*out_len)--;
-
-    unsigned char *decoded_data = malloc(*out_len);
-    if (decoded_data == NULL)
-        return NULL;
-
-    for (size_t i = 0, j = 0; i < src_len;)
-    {
-        uint32_t sextet_a = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
-        uint32_t sextet_b = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
-        uint32_t sextet_c = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
-        uint32_t sextet_d = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
-        uint32_t triple = (sextet_a << 3 * 6) + (sextet_b << 2 * 6) + (sextet_c << 1 * 6) + (sextet_d << 0 * 6);
-        if (j < *out_len)
-            decoded_data[j++] = (triple >> 2 * 8) & 0xFF;
-        if (j < *out_len)
-            decoded_data[j++] = (triple >> 1 * 8) & 0xFF;
-        if (j < *out_len)
-            decoded_data[j++] = (triple >> 0 * 8) & 0xFF;
-    }
-    return decoded_data;
+    for (const char *p = path; *p; p++)
+    {
+        if (*p == '\n')
+            fputs("\\n", out);
+        else if (*p == '\r')
+            fputs("\\r", out);
+        else
+            fputc(*p, out);
+    }
 }
 
-// --- Funções Criptográficas ---
-
 /**
- * @brief Teste de primalidade Miller-Rabin.
- * @param n Número a ser testado.
- * @param k Número de iterações.
- * @param rand_state Estado do gerador de números aleatórios.
- * @return 1 se provavelmente primo, 0 se composto.
+ * @brief Motivo de uma entrada do diretório ter ficado fora do manifesto.
  */
-int miller_rabin_test(mpz_t n, int k, gmp_randstate_t rand_state)
+static const char *merkle_skip_message(merkle_skip_reason reason)
 {
-    if (mpz_cmp_ui(n, 2) == 0 || mpz_cmp_ui(n, 3) == 0)
-        return 1;
-    if (mpz_cmp_ui(n, 1) <= 0 || mpz_even_p(n))
-        return 0;
-
-    mpz_t n_minus_1, d, a, x;
-    mpz_inits(n_minus_1, d, a, x, NULL);
-
-    mpz_sub_ui(n_minus_1, n, 1);
-    mpz_set(d, n_minus_1);
-
-    int r = 0;
-    while (mpz_even_p(d))
+    switch (reason)
     {
-        mpz_divexact_ui(d, d, 2);
-        r++;
+    case MERKLE_SKIP_NAME:
+        return "nome com quebra de linha";
+    case MERKLE_SKIP_TOO_LONG:
+        return "caminho longo demais";
+    case MERKLE_SKIP_SPECIAL:
+        return "link simbólico ou arquivo especial";
+    case MERKLE_SKIP_UNREADABLE:
+        break;
     }
+    return "ilegível";
+}
 
-    for (int i = 0; i < k; i++)
+/**
+ * @brief Imprime uma linha de erro por entrada do diretório que ficou fora do manifesto.
+ * @return O número de entradas.
+ */
+static size_t manifest_report_skipped(const merkle_manifest *m, const char *dirname, FILE *err)
+{
+    for (size_t i = 0; i < m->skipped_count; i++)
     {
-        mpz_urandomm(a, rand_state, n_minus_1);
-        if (mpz_cmp_ui(a, 2) < 0)
-            mpz_set_ui(a, 2);
-
-        mpz_powm(x, a, d, n);
-
-        if (mpz_cmp_ui(x, 1) == 0 || mpz_cmp(x, n_minus_1) == 0)
-            continue;
-
-        int composite = 1;
-        for (int j = 0; j < r - 1; j++)
-        {
-            mpz_powm_ui(x, x, 2, n);
-            if (mpz_cmp(x, n_minus_1) == 0)
-            {
-                composite = 0;
-                break;
-            }
-        }
-
-        if (composite)
-        {
-            mpz_clears(n_minus_1, d, a, x, NULL);
-            return 0;
-        }
+        fprintf(err, "Erro: '%s/", dirname);
+        print_path(err, m->skipped[i].path);
+        fprintf(err, "' não pode entrar no manifesto (%s).\n", merkle_skip_message(m->skipped[i].reason));
     }
-
-    mpz_clears(n_minus_1, d, a, x, NULL);
-    return 1;
+    return m->skipped_count;
 }
 
 /**
- * @brief Gera um número primo com um número específico de bits usando Miller-Rabin.
- * @param prime Variável mpz_t para armazenar o primo.
- * @param bits O número de bits do primo.
- * @param rand_state Estado do gerador de números aleatórios do GMP.
+ * @brief Imprime uma diferença entre o manifesto e o diretório.
  */
-void generate_prime(mpz_t prime, int bits, gmp_randstate_t rand_state)
+static void manifest_print_diff(void *ctx, const char *path, merkle_diff_kind kind)
 {
-    do
-    {
-        mpz_urandomb(prime, rand_state, bits);
-        mpz_setbit(prime, bits - 1); // Garante que tenha o número de bits correto
-        mpz_setbit(prime, 0);        // Garante que seja ímpar
-    } while (!miller_rabin_test(prime, MILLER_RABIN_ITERATIONS, rand_state) ||
-             mpz_sizeinbase(prime, 2) != bits);
+    // Na ordem de merkle_diff_kind
+    static const char *const labels[] = {"AUSENTE", "NÃO LISTADO", "ALTERADO", "ILEGÍVEL"};
+    FILE *out = (FILE *)ctx;
+    print_path(out, path);
+    fprintf(out, ": %s\n", labels[kind]);
 }
 
 /**
- * @brief Gera um par de chaves RSA (pública e privada).
- * @param n Módulo RSA (saída).
- * @param e Expoente público (saída).
- * @param d Expoente privado (saída).
- * @param bits Número de bits para o módulo n.
+ * @brief Compara um manifesto (já verificado) com o conteúdo atual de um diretório.
+ *
+ * Imprime uma linha por arquivo alterado, ausente, não listado ou ilegível.
+ * @return O número de diferenças, ou -1 se o diretório não puder ser lido.
  */
-void generate_rsa_keys(mpz_t n, mpz_t e, mpz_t d, int bits)
+static long manifest_compare_dir(const merkle_manifest *m, const char *dirname, FILE *out)
 {
-    gmp_randstate_t rand_state;
-    gmp_randinit_default(rand_state);
-    gmp_randseed_ui(rand_state, time(NULL));
-
-    mpz_t p, q, phi, gcd_result;
-    mpz_inits(p, q, phi, gcd_result, NULL);
-
-    printf("Gerando primo p de %d bits... ", bits / 2);
-    fflush(stdout);
-    generate_prime(p, bits / 2, rand_state);
-    printf("OK\n");
-
-    printf("Gerando primo q de %d bits... ", bits / 2);
-    fflush(stdout);
-    do
+    merkle_manifest current;
+    const char *failed;
+    if (!merkle_manifest_build(&current, dirname, keygen_thread_count(), &failed))
     {
-        generate_prime(q, bits / 2, rand_state);
-    } while (mpz_cmp(p, q) == 0); // Garante que p != q
-    printf("OK\n");
+        if (failed)
+            manifest_print_diff(out, failed, MERKLE_DIFF_UNREADABLE);
+        merkle_manifest_clear(&current);
+        return -1;
+    }
 
-    mpz_mul(n, p, q); // n = p * q
+    long differences = merkle_manifest_diff(m, &current, manifest_print_diff, out);
+    merkle_manifest_clear(&current);
+    return differences;
+}
 
-    mpz_sub_ui(p, p, 1); // p = p - 1
-    mpz_sub_ui(q, q, 1); // q = q - 1
-    mpz_mul(phi, p, q);  // phi = (p-1) * (q-1)
+/**
+ * @brief Grava um texto em um arquivo.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int save_text_file(const char *filename, const char *text, size_t len)
+{
+    FILE *f = fopen(filename, "wb");
+    if (!f)
+        return 0;
+    int ok = fwrite(text, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
 
-    mpz_set_ui(e, 65537); // e = 65537
+/**
+ * @brief Assina um diretório inteiro: hash paralelo dos arquivos e uma única assinatura da raiz.
+ */
+static void manifest_sign_menu()
+{
+    char dir_name[256], key_file[256], output[256];
+    printf("Digite o diretório a assinar: ");
+    scanf("%255s", dir_name);
+    printf("Digite o nome do arquivo da chave privada (ex: private_key.txt): ");
+    scanf("%255s", key_file);
+    printf("Digite o nome do manifesto a criar (ex: release.manifest): ");
+    scanf("%255s", output);
 
-    // Verifica se mdc(e, phi) = 1
-    mpz_gcd(gcd_result, e, phi);
-    if (mpz_cmp_ui(gcd_result, 1) != 0)
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 1))
     {
-        printf("Erro: e e phi não são coprimos. Tentando novamente.\n");
-        mpz_clears(p, q, phi, gcd_result, NULL);
-        gmp_randclear(rand_state);
-        generate_rsa_keys(n, e, d, bits);
+        printf("Erro: Não foi possível carregar a chave privada de '%s'.\n", key_file);
+        rsa_key_clear(&key);
         return;
     }
 
-    if (mpz_invert(d, e, phi) == 0)
+    merkle_manifest m;
+    const char *failed;
+    double start = monotonic_seconds();
+    int built = merkle_manifest_build(&m, dir_name, keygen_thread_count(), &failed);
+    if (manifest_report_skipped(&m, dir_name, stdout) > 0)
+        built = 0;
+    else if (!built && failed)
+        printf("Erro: Não foi possível ler '%s/%s'.\n", dir_name, failed);
+    else if (!built)
+        printf("Erro: O diretório '%s' não pôde ser lido ou não contém arquivos.\n", dir_name);
+    if (!built)
     {
-        printf("Erro: Inverso modular não existe. Tentando novamente.\n");
-        mpz_clears(p, q, phi, gcd_result, NULL);
-        gmp_randclear(rand_state);
-        generate_rsa_keys(n, e, d, bits);
+        merkle_manifest_clear(&m);
+        rsa_key_clear(&key);
         return;
     }
+    double hash_time = monotonic_seconds() - start;
 
-    mpz_clears(p, q, phi, gcd_result, NULL);
-    gmp_randclear(rand_state);
+    size_t len;
+    char *text = merkle_manifest_sign(&m, &key, thread_rng()) ? merkle_manifest_format(&m, &len) : NULL;
+    if (!text || !save_text_file(output, text, len))
+        printf("Erro ao criar o manifesto '%s'.\n", output);
+    else
+    {
+        printf("Manifesto de %zu arquivos salvo em '%s' (uma assinatura).\n", m.count, output);
+        printf("Hash dos arquivos: %.3f s; total: %.3f s.\n", hash_time, monotonic_seconds() - start);
+    }
+    free(text);
+    merkle_manifest_clear(&m);
+    rsa_key_clear(&key);
 }
 
 /**
- * @brief Função de Geração de Máscara (MGF1) para OAEP.
- * @param seed Seed para gerar a máscara.
- * @param seed_len Comprimento da seed.
- * @param mask Buffer para a máscara gerada (saída).
- * @param mask_len Comprimento da máscara a ser gerada.
+ * @brief Extrai do manifesto a prova de inclusão de um arquivo.
  */
-void mgf1(const unsigned char *seed, size_t seed_len, unsigned char *mask, size_t mask_len)
+static void manifest_prove_menu()
 {
-    unsigned char *counter = (unsigned char *)malloc(4);
-    unsigned char *hash_input = (unsigned char *)malloc(seed_len + 4);
-    unsigned char digest[SHA3_256_DIGEST_SIZE];
-    size_t h_len = SHA3_256_DIGEST_SIZE;
-    size_t offset = 0;
+    char manifest_file[256], path[256], output[300];
+    printf("Digite o nome do manifesto: ");
+    scanf("%255s", manifest_file);
+    printf("Digite o caminho do arquivo, relativo ao diretório assinado: ");
+    scanf("%255s", path);
+
+    merkle_manifest m;
+    if (!load_manifest(manifest_file, &m, stdout))
+        return;
 
-    for (uint32_t i = 0; offset < mask_len; i++)
+    long index = merkle_manifest_find(&m, path);
+    merkle_proof proof;
+    size_t len;
+    char *text = NULL;
+    if (index < 0)
+        printf("Erro: '%s' não está no manifesto.\n", path);
+    else if (!merkle_proof_create(&m, (size_t)index, &proof) || !(text = merkle_proof_format(&proof, &len)))
+        printf("Erro ao montar a prova de '%s'.\n", path);
+    else
     {
-        counter[0] = (i >> 24) & 0xFF;
-        counter[1] = (i >> 16) & 0xFF;
-        counter[2] = (i >> 8) & 0xFF;
-        counter[3] = i & 0xFF;
-
-        memcpy(hash_input, seed, seed_len);
-        memcpy(hash_input + seed_len, counter, 4);
-
-        sha3_256(hash_input, seed_len + 4, digest);
-
-        size_t copy_len = (offset + h_len <= mask_len) ? h_len : mask_len - offset;
-        memcpy(mask + offset, digest, copy_len);
-        offset += h_len;
+        const char *base = strrchr(path, '/');
+        snprintf(output, sizeof(output), "%s.proof", base ? base + 1 : path);
+        if (save_text_file(output, text, len))
+            printf("Prova com %zu irmãos salva em '%s'.\n", proof.depth, output);
+        else
+            printf("Erro ao criar '%s'.\n", output);
     }
-    free(counter);
-    free(hash_input);
+    if (index >= 0)
+        merkle_proof_clear(&proof);
+    free(text);
+    merkle_manifest_clear(&m);
 }
 
 /**
- * @brief Implementa o padding RSA-OAEP.
- * @param message Mensagem a ser formatada.
- * @param message_len Comprimento da mensagem.
- * @param k Tamanho do módulo RSA em bytes.
- * @param padded_message Buffer para a mensagem formatada (saída).
- * @return 1 em sucesso, 0 em falha.
+ * @brief Verifica um único arquivo com a sua prova, sem ler os demais arquivos do diretório.
  */
-int rsa_oaep_pad(const unsigned char *message, size_t message_len, int k, unsigned char **padded_message)
+static void manifest_check_menu()
 {
-    unsigned int h_len = SHA3_256_DIGEST_SIZE;
+    char proof_file[256], file_name[256], key_file[256];
+    printf("Digite o nome do arquivo de prova: ");
+    scanf("%255s", proof_file);
+    printf("Digite o nome do arquivo a verificar: ");
+    scanf("%255s", file_name);
+    printf("Digite o nome do arquivo da chave pública (ex: public_key.txt): ");
+    scanf("%255s", key_file);
 
-    if (message_len > k - 2 * h_len - 2)
+    unsigned char *text;
+    size_t len;
+    merkle_proof proof;
+    if (!read_file_content(proof_file, &text, &len))
     {
-        printf("Erro: Mensagem muito longa para OAEP.\n");
-        return 0;
+        printf("Erro: Não foi possível ler a prova '%s'.\n", proof_file);
+        return;
     }
+    int parsed = merkle_proof_parse((const char *)text, len, &proof);
+    free(text);
 
-    *padded_message = (unsigned char *)malloc(k);
-    memset(*padded_message, 0, k);
-
-    unsigned char l_hash[SHA3_256_DIGEST_SIZE];
-    sha3_256((const unsigned char *)"", 0, l_hash); // Label vazia
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    FILE *f = parsed ? fopen(file_name, "rb") : NULL;
+    int hashed = f && sha3_256_stream(f, digest);
+    if (f)
+        fclose(f);
 
-    size_t ps_len = k - message_len - 2 * h_len - 2;
-    size_t db_len = h_len + ps_len + 1 + message_len;
-    unsigned char *db = (unsigned char *)malloc(db_len);
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!parsed)
+        printf("Erro: '%s' não é uma prova de inclusão válida.\n", proof_file);
+    else if (!hashed)
+        printf("Erro: Não foi possível ler o arquivo '%s'.\n", file_name);
+    else if (!load_rsa_key(key_file, &key, 0))
+        printf("Erro: Não foi possível carregar a chave pública de '%s'.\n", key_file);
+    else
+    {
+        const char *reason = verify_reason(merkle_proof_verify(&proof, &key, digest));
+        printf("\n=========================\n");
+        if (!reason)
+            printf("ARQUIVO VÁLIDO! ('%s', %zu de %zu no manifesto)\n", proof.path, proof.index + 1, proof.count);
+        else
+            printf("VERIFICAÇÃO FALHOU! (%s)\n", reason);
+        printf("=========================\n");
+    }
+    merkle_proof_clear(&proof);
+    rsa_key_clear(&key);
+}
 
-    memcpy(db, l_hash, h_len);
-    memset(db + h_len, 0, ps_len);
-    db[h_len + ps_len] = 0x01;
-    memcpy(db + h_len + ps_len + 1, message, message_len);
+/**
+ * @brief Menu de manifestos Merkle: assina um diretório com uma única operação privada.
+ */
+void manifest_menu()
+{
+    int choice;
 
-    unsigned char seed[h_len];
-    FILE *f = fopen("/dev/urandom", "rb");
-    if (!f)
+    do
     {
-        // Fallback para sistemas sem /dev/urandom
-        srand(time(NULL));
-        for (size_t i = 0; i < h_len; i++)
+        printf("\n--- Manifesto Merkle de diretório ---\n");
+        printf("1. Assinar diretório\n");
+        printf("2. Gerar prova de inclusão de um arquivo\n");
+        printf("3. Verificar arquivo com a prova\n");
+        printf("0. Voltar\n");
+        printf("Escolha uma opção: ");
+        if (scanf("%d", &choice) != 1)
         {
-            seed[i] = rand() & 0xFF;
+            while (getchar() != '\n')
+                ; // Limpa buffer de entrada
+            choice = -1;
         }
-    }
-    else
-    {
-        fread(seed, 1, h_len, f);
-        fclose(f);
-    }
 
-    unsigned char *db_mask = (unsigned char *)malloc(db_len);
-    mgf1(seed, h_len, db_mask, db_len);
+        switch (choice)
+        {
+        case 1:
+            manifest_sign_menu();
+            break;
+        case 2:
+            manifest_prove_menu();
+            break;
+        case 3:
+            manifest_check_menu();
+            break;
+        case 0:
+            break;
+        default:
+            printf("Opção inválida! Tente novamente.\n");
+        }
+    } while (choice != 0);
+}
+
+// --- Linha de comando (subcomandos) ---
+//
+// Com um subcomando em argv, o programa executa uma única operação sem menu:
+// os resultados vão para a saída padrão, as mensagens de erro para a saída de
+// erro, e o código de saída diz o que aconteceu. Um nome de arquivo "-" é a
+// entrada ou a saída padrão, para uso em pipelines e em 'xargs -P'.
 
-    unsigned char *masked_db = (unsigned char *)malloc(db_len);
-    for (size_t i = 0; i < db_len; i++)
-    {
-        masked_db[i] = db[i] ^ db_mask[i];
-    }
+#define CLI_OK 0              // Sucesso (todas as assinaturas válidas)
+#define CLI_VERIFY_FAILED 1   // Alguma assinatura inválida ou ausente
+#define CLI_USAGE 2           // Subcomando ou opção inválidos
+#define CLI_ERROR 3           // Erro de leitura/escrita, de chave ou de formato
+#define CLI_READ_CHUNK 65536 // Bloco de leitura da entrada padrão
+
+/**
+ * @brief Mostra o uso da linha de comando.
+ */
+static void print_usage(FILE *out, const char *program)
+{
+    fprintf(out, "Uso: %s [--stats[=arquivo.json]] [--trace] [comando [opções] [arquivo|-]...]\n", program);
+    fprintf(out, "Sem comando, abre o menu interativo.\n\n");
+    fprintf(out, "Comandos:\n");
+    fprintf(out, "  keygen  [-b bits] [--bpsw] [-t threads] [-o diretório]\n");
+    fprintf(out, "  sign    -k chave_privada [--chunked | -c bytes] [-t threads] [-o saída] [arquivo|-]...\n");
+    fprintf(out, "  verify  -k chave_pública|keyring [-t threads] [--range início:tamanho]\n");
+    fprintf(out, "          [--cache[=arquivo]] [--cache-by-content] [arquivo|-]...\n");
+    fprintf(out, "  extract [-o saída] [arquivo|-]\n");
+    fprintf(out, "  hash    [arquivo|-]...\n");
+    fprintf(out, "  manifest sign   -k chave_privada [-t threads] [-o saída] diretório\n");
+    fprintf(out, "  manifest prove  [-o saída] manifesto caminho\n");
+    fprintf(out, "  manifest check  -k chave_pública|keyring prova arquivo|-\n");
+    fprintf(out, "  manifest verify -k chave_pública|keyring manifesto [diretório]\n\n");
+    fprintf(out, "Sem arquivos (ou com '-'), lê a entrada padrão; '-o -' escreve na saída padrão.\n");
+    fprintf(out, "O cache padrão do verify é '%s', no diretório atual.\n", VERIFY_CACHE_DEFAULT_PATH);
+    fprintf(out, "Códigos de saída: %d sucesso, %d assinatura inválida, %d uso incorreto, %d erro de E/S ou de chave.\n",
+            CLI_OK, CLI_VERIFY_FAILED, CLI_USAGE, CLI_ERROR);
+}
 
-    unsigned char *seed_mask = (unsigned char *)malloc(h_len);
-    mgf1(masked_db, db_len, seed_mask, h_len);
+/**
+ * @brief Reconhece uma opção com valor: "-k valor", "--key valor" ou "--key=valor".
+ * @param i Índice do argumento atual; avança sobre o valor quando ele vem separado.
+ * @param value Recebe o valor, ou NULL se a opção vier sem ele.
+ * @return 1 se argv[*i] for a opção, 0 caso contrário.
+ */
+static int cli_option(int argc, char *argv[], int *i, const char *short_name, const char *long_name,
+                      const char **value)
+{
+    const char *arg = argv[*i];
+    size_t long_len = strlen(long_name);
 
-    unsigned char *masked_seed = (unsigned char *)malloc(h_len);
-    for (size_t i = 0; i < h_len; i++)
+    if (strncmp(arg, long_name, long_len) == 0 && arg[long_len] == '=')
     {
-        masked_seed[i] = seed[i] ^ seed_mask[i];
+        *value = arg[long_len + 1] ? arg + long_len + 1 : NULL;
+        return 1;
     }
+    if (strcmp(arg, short_name) != 0 && strcmp(arg, long_name) != 0)
+        return 0;
 
-    // Constrói a mensagem final formatada EM
-    (*padded_message)[0] = 0x00;
-    memcpy((*padded_message) + 1, masked_seed, h_len);
-    memcpy((*padded_message) + 1 + h_len, masked_db, db_len);
-
-    free(db);
-    free(db_mask);
-    free(masked_db);
-    free(seed_mask);
-    free(masked_seed);
+    *value = *i + 1 < argc ? argv[++*i] : NULL;
+    return 1;
+}
 
+/**
+ * @brief Separa as opções dos arquivos de um subcomando.
+ *
+ * Os arquivos são compactados no início de argv + first; opções com valor são
+ * tratadas pelo chamador através de cli_option antes desta verificação.
+ * @return 1 se argv[i] for um arquivo (ou "-"), 0 se for uma opção desconhecida.
+ */
+static int cli_operand(char *argv[], int i, int first, int *count)
+{
+    if (argv[i][0] == '-' && argv[i][1] != '\0')
+    {
+        fprintf(stderr, "Erro: Opção desconhecida '%s'.\n", argv[i]);
+        return 0;
+    }
+    argv[first + (*count)++] = argv[i];
     return 1;
 }
 
 /**
- * @brief Remove o padding RSA-OAEP.
- * @param padded_message Mensagem formatada.
- * @param k Tamanho do módulo RSA em bytes.
- * @param message Buffer para a mensagem original (saída).
- * @param message_len Ponteiro para o comprimento da mensagem (saída).
+ * @brief Lê um arquivo inteiro, ou a entrada padrão se o nome for "-".
  * @return 1 em sucesso, 0 em falha.
  */
-int rsa_oaep_unpad(const unsigned char *padded_message, int k, unsigned char **message, size_t *message_len)
+static int read_input(const char *name, unsigned char **buffer, size_t *len)
 {
-    unsigned int h_len = SHA3_256_DIGEST_SIZE;
+    if (strcmp(name, "-") != 0)
+        return read_file_content(name, buffer, len);
 
-    if (k < 2 * h_len + 2)
+    size_t capacity = CLI_READ_CHUNK, used = 0;
+    unsigned char *data = malloc(capacity);
+    size_t got;
+    while (data && (got = fread(data + used, 1, capacity - used, stdin)) > 0)
+    {
+        used += got;
+        if (used == capacity)
+        {
+            unsigned char *grown = realloc(data, capacity * 2);
+            if (!grown)
+            {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+    if (!data || ferror(stdin))
     {
+        free(data);
         return 0;
     }
+    *buffer = data;
+    *len = used;
+    return 1;
+}
 
-    const unsigned char *masked_seed = padded_message + 1;
-    const unsigned char *masked_db = padded_message + 1 + h_len;
-    size_t db_len = k - 1 - h_len;
+/**
+ * @brief Grava um buffer em um arquivo, ou na saída padrão se o nome for "-".
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int write_output(const char *name, const void *data, size_t len)
+{
+    if (strcmp(name, "-") == 0)
+        return fwrite(data, 1, len, stdout) == len && fflush(stdout) == 0;
 
-    unsigned char *seed_mask = (unsigned char *)malloc(h_len);
-    mgf1(masked_db, db_len, seed_mask, h_len);
+    FILE *f = fopen(name, "wb");
+    if (!f)
+        return 0;
+    int ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
 
-    unsigned char *seed = (unsigned char *)malloc(h_len);
-    for (size_t i = 0; i < h_len; i++)
-    {
-        seed[i] = masked_seed[i] ^ seed_mask[i];
-    }
+/**
+ * @brief Encerra o rastreamento de uma operação: uma linha por operação quando há
+ *        um único arquivo, ou o acúmulo no histograma em uma chamada em lote.
+ */
+static void cli_trace_finish(trace_record *rec, trace_histogram *hist, int batch, const char *name)
+{
+    trace_attach(NULL);
+    if (!trace_enabled)
+        return;
+    if (batch)
+        trace_histogram_add(hist, rec);
+    else
+        trace_record_print(stderr, rec, name);
+}
 
-    unsigned char *db_mask = (unsigned char *)malloc(db_len);
-    mgf1(seed, h_len, db_mask, db_len);
+/**
+ * @brief keygen: gera um par de chaves e grava os formatos hexadecimal e binário.
+ */
+static int cmd_keygen(int argc, char *argv[], int first)
+{
+    int bits = DEFAULT_KEY_BITS;
+    const char *dir = ".";
 
-    unsigned char *db = (unsigned char *)malloc(db_len);
-    for (size_t i = 0; i < db_len; i++)
+    for (int i = first; i < argc; i++)
     {
-        db[i] = masked_db[i] ^ db_mask[i];
+        const char *value;
+        if (cli_option(argc, argv, &i, "-b", "--bits", &value))
+        {
+            bits = value ? atoi(value) : 0;
+            if (!key_size_supported(bits))
+            {
+                fprintf(stderr, "Erro: Tamanho de chave não suportado: %s.\n", value ? value : "(vazio)");
+                return CLI_USAGE;
+            }
+        }
+        else if (cli_option(argc, argv, &i, "-t", "--threads", &value))
+        {
+            if (!value || (keygen_threads = atoi(value)) < 0)
+            {
+                fprintf(stderr, "Erro: Número de threads inválido.\n");
+                return CLI_USAGE;
+            }
+        }
+        else if (cli_option(argc, argv, &i, "-o", "--out-dir", &value))
+        {
+            if (!value)
+            {
+                fprintf(stderr, "Erro: Falta o diretório de '-o'.\n");
+                return CLI_USAGE;
+            }
+            dir = value;
+        }
+        else if (strcmp(argv[i], "--bpsw") == 0)
+            prime_test_mode = PRIMALITY_BPSW;
+        else
+        {
+            fprintf(stderr, "Erro: Opção desconhecida '%s'.\n", argv[i]);
+            return CLI_USAGE;
+        }
     }
 
-    unsigned char l_hash_prime[SHA3_256_DIGEST_SIZE];
-    sha3_256((const unsigned char *)"", 0, l_hash_prime);
-
-    if (memcmp(db, l_hash_prime, h_len) != 0)
+    // O diretório de saída é criado antes da geração, para não perder a chave gerada
+    struct stat st;
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST)
     {
-        printf("Erro de unpadding: lHash não corresponde.\n");
-        free(seed_mask);
-        free(seed);
-        free(db_mask);
-        free(db);
-        return 0;
+        fprintf(stderr, "Erro: Não foi possível criar o diretório '%s': %s.\n", dir, strerror(errno));
+        return CLI_ERROR;
     }
-
-    // Encontra o separador 0x01
-    size_t separator_idx = h_len;
-    while (separator_idx < db_len && db[separator_idx] == 0x00)
+    if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode))
     {
-        separator_idx++;
+        fprintf(stderr, "Erro: '%s' não é um diretório.\n", dir);
+        return CLI_ERROR;
     }
 
-    if (separator_idx == db_len || db[separator_idx] != 0x01)
+    rsa_key key;
+    rsa_key_init(&key);
+    keygen_stats_reset();
+    double start = monotonic_seconds();
+    int ok = rsa_key_generate(&key, bits, thread_rng(), keygen_thread_count());
+    double elapsed = monotonic_seconds() - start;
+    if (ok && keygen_stats_enabled)
     {
-        printf("Erro de unpadding: Separador 0x01 não encontrado.\n");
-        free(seed_mask);
-        free(seed);
-        free(db_mask);
-        free(db);
-        return 0;
+        keygen_stats_print(stdout, elapsed);
+        if (!keygen_stats_write_json(keygen_stats_path, bits, keygen_thread_count(), elapsed))
+            fprintf(stderr, "Erro: Não foi possível gravar as estatísticas em '%s'.\n", keygen_stats_path);
     }
 
-    *message_len = db_len - separator_idx - 1;
-    *message = (unsigned char *)malloc(*message_len);
-    memcpy(*message, db + separator_idx + 1, *message_len);
+    static const char *names[4] = {"public_key.txt", "private_key.txt", "public_key.bin", "private_key.bin"};
+    char paths[4][512];
+    for (int i = 0; ok && i < 4; i++)
+        ok = snprintf(paths[i], sizeof(paths[i]), "%s/%s", dir, names[i]) < (int)sizeof(paths[i]);
 
-    free(seed_mask);
-    free(seed);
-    free(db_mask);
-    free(db);
+    ok = ok && save_key_hex(paths[0], key.n, key.e) && save_key_hex(paths[1], key.n, key.d) &&
+         save_key_binary(paths[2], &key, 0) && save_key_binary(paths[3], &key, 1);
+    if (!ok)
+    {
+        fprintf(stderr, "Erro: Não foi possível gerar ou gravar as chaves em '%s'.\n", dir);
+        rsa_key_clear(&key);
+        return CLI_ERROR;
+    }
 
-    return 1;
-}
+    char fingerprint[2 * SHA3_256_DIGEST_SIZE + 1];
+    bytes_to_hex(key.fingerprint, SHA3_256_DIGEST_SIZE, fingerprint);
+    printf("%s %d bits, %.0f ms\n", fingerprint, bits, elapsed * 1e3);
+    for (int i = 0; i < 4; i++)
+        printf("%s\n", paths[i]);
 
-// --- Funções de Arquivo e UI ---
+    rsa_key_clear(&key);
+    return CLI_OK;
+}
 
 /**
- * @brief Lê o conteúdo completo de um arquivo.
- * @param filename Nome do arquivo.
- * @param buffer Ponteiro para o buffer que armazenará o conteúdo.
- * @param len Ponteiro para o tamanho do conteúdo lido.
- * @return 1 em sucesso, 0 em falha.
+ * @brief sign: assina cada arquivo; por padrão grava '<arquivo>.signed' (ou a saída padrão para "-").
  */
-int read_file_content(const char *filename, unsigned char **buffer, size_t *len)
+static int cmd_sign(int argc, char *argv[], int first)
 {
-    FILE *f = fopen(filename, "rb");
-    if (!f)
-        return 0;
-    fseek(f, 0, SEEK_END);
-    *len = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    *buffer = malloc(*len);
-    if (!*buffer)
+    const char *key_file = NULL, *output = NULL;
+    int count = 0, chunked = 0, threads = keygen_thread_count();
+    unsigned long long chunk_size = CHUNK_DEFAULT_SIZE;
+
+    for (int i = first; i < argc; i++)
     {
-        fclose(f);
-        return 0;
+        const char *value;
+        if (cli_option(argc, argv, &i, "-k", "--key", &value))
+            key_file = value;
+        else if (cli_option(argc, argv, &i, "-o", "--output", &value))
+            output = value;
+        else if (cli_option(argc, argv, &i, "-c", "--chunk-size", &value))
+        {
+            chunk_size = value ? strtoull(value, NULL, 10) : 0;
+            chunked = 1;
+        }
+        else if (strcmp(argv[i], "--chunked") == 0)
+            chunked = 1;
+        else if (cli_option(argc, argv, &i, "-t", "--threads", &value))
+            threads = value ? atoi(value) : 0;
+        else if (!cli_operand(argv, i, first, &count))
+            return CLI_USAGE;
     }
-    if (fread(*buffer, 1, *len, f) != *len)
+    if (!key_file || (output && count > 1))
     {
-        free(*buffer);
-        fclose(f);
-        return 0;
+        fprintf(stderr, "Erro: sign exige '-k chave_privada', e '-o' aceita um único arquivo.\n");
+        return CLI_USAGE;
     }
-    fclose(f);
-    return 1;
-}
-
-/**
- * @brief Salva chaves RSA em arquivos.
- * @param n Módulo n.
- * @param e Expoente público e.
- * @param d Expoente privado d.
- */
-void save_keys(mpz_t n, mpz_t e, mpz_t d)
-{
-    char *n_str = mpz_get_str(NULL, 16, n);
-    char *e_str = mpz_get_str(NULL, 16, e);
-    char *d_str = mpz_get_str(NULL, 16, d);
+    if (chunk_size == 0 || chunk_size % 3 != 0 || threads < 1)
+    {
+        fprintf(stderr, "Erro: O tamanho do bloco deve ser um múltiplo positivo de 3, e '-t' ao menos 1.\n");
+        return CLI_USAGE;
+    }
+    if (count == 0)
+        argv[first + count++] = "-";
 
-    FILE *pub_file = fopen("public_key.txt", "w");
-    fprintf(pub_file, "%s\n%s", n_str, e_str);
-    fclose(pub_file);
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 1))
+    {
+        fprintf(stderr, "Erro: Não foi possível carregar a chave privada de '%s'.\n", key_file);
+        rsa_key_clear(&key);
+        return CLI_ERROR;
+    }
 
-    FILE *priv_file = fopen("private_key.txt", "w");
-    fprintf(priv_file, "%s\n%s", n_str, d_str);
-    fclose(priv_file);
+    int result = CLI_OK;
+    trace_histogram hist;
+    trace_histogram_init(&hist);
+    for (int i = first; i < first + count; i++)
+    {
+        const char *name = argv[i];
+        trace_record trace;
+        memset(&trace, 0, sizeof(trace));
+        trace_attach(trace_enabled ? &trace : NULL);
+
+        char default_name[4096];
+        const char *target = output;
+        if (!target && strcmp(name, "-") == 0)
+            target = "-";
+        else if (!target)
+        {
+            if (snprintf(default_name, sizeof(default_name), "%s.signed", name) >= (int)sizeof(default_name))
+            {
+                fprintf(stderr, "Erro: Nome longo demais para a saída de '%s'; use '-o'.\n", name);
+                trace_attach(NULL);
+                result = CLI_ERROR;
+                continue;
+            }
+            target = default_name;
+        }
 
-    printf("Chaves salvas em 'public_key.txt' e 'private_key.txt'.\n");
+        // Por blocos, de arquivo para arquivo: lido em blocos, sem carregar a mensagem inteira
+        char *signed_text = NULL;
+        int ok;
+        if (chunked && strcmp(name, "-") != 0 && strcmp(target, "-") != 0)
+            ok = sign_file_chunked(name, target, &key, chunk_size, threads, thread_rng());
+        else
+        {
+            unsigned char *content;
+            size_t content_len, signed_len;
+            double t = trace_start();
+            if (!read_input(name, &content, &content_len))
+            {
+                fprintf(stderr, "Erro: Não foi possível ler '%s'.\n", name);
+                trace_attach(NULL);
+                result = CLI_ERROR;
+                continue;
+            }
+            trace_stop(TRACE_READ, t);
+
+            if (chunked)
+                signed_text = rsa_sign_message_chunked(&key, content, content_len, chunk_size, threads, thread_rng(),
+                                                       &signed_len);
+            else
+                signed_text = rsa_sign_message(&key, content, content_len, thread_rng(), &signed_len);
+            free(content);
+
+            t = trace_start();
+            ok = signed_text && write_output(target, signed_text, signed_len);
+            trace_stop(TRACE_WRITE, t);
+        }
+        if (!ok)
+        {
+            trace_attach(NULL);
+            fprintf(stderr, "Erro: Não foi possível assinar '%s' em '%s'.\n", name, target);
+            result = CLI_ERROR;
+        }
+        else
+            cli_trace_finish(&trace, &hist, count > 1, name);
+        free(signed_text);
+    }
 
-    free(n_str);
-    free(e_str);
-    free(d_str);
+    if (trace_enabled && count > 1)
+        trace_histogram_print(stderr, &hist, "sign");
+    rsa_key_clear(&key);
+    return result;
 }
 
 /**
- * @brief Carrega uma chave RSA (pública ou privada) de um arquivo.
- * @param filename Nome do arquivo da chave.
- * @param n Módulo n (saída).
- * @param exp Expoente e ou d (saída).
- * @return 1 em sucesso, 0 em falha.
+ * @brief Carrega a chave de verificação: uma chave pública ou, se 'key_file' for
+ *        um diretório, o keyring inteiro.
+ * @param use_keyring Recebe 1 se o keyring foi carregado em 'kr'.
+ * @return 1 em sucesso, 0 em falha (a mensagem de erro já foi impressa).
  */
-int load_key(const char *filename, mpz_t n, mpz_t exp)
+static int cli_load_verify_keys(const char *key_file, rsa_key *key, keyring *kr, int *use_keyring)
 {
-    FILE *f = fopen(filename, "r");
-    if (!f)
-        return 0;
-
-    if (mpz_inp_str(n, f, 16) == 0)
-    {
-        fclose(f);
-        return 0;
-    }
-    if (mpz_inp_str(exp, f, 16) == 0)
+    struct stat st;
+    rsa_key_init(key);
+    *use_keyring = 0;
+    if (stat(key_file, &st) == 0 && S_ISDIR(st.st_mode))
     {
-        fclose(f);
-        return 0;
+        *use_keyring = keyring_load(kr, key_file);
+        if (*use_keyring)
+            return 1;
+        fprintf(stderr, "Erro: Não foi possível ler o keyring '%s'.\n", key_file);
     }
-
-    fclose(f);
-    return 1;
+    else if (load_rsa_key(key_file, key, 0))
+        return 1;
+    else
+        fprintf(stderr, "Erro: Não foi possível carregar a chave pública de '%s'.\n", key_file);
+    rsa_key_clear(key);
+    return 0;
 }
 
 /**
- * @brief Menu para gerar um par de chaves RSA.
+ * @brief Escolhe a chave de verificação: a chave única, ou a do keyring com a impressão digital dada.
+ * @return A chave, ou NULL se nenhuma chave do keyring corresponder.
  */
-void generate_keys_menu()
+static const rsa_key *cli_pick_key(const rsa_key *key, const keyring *kr, const unsigned char *fingerprint,
+                                   int has_fingerprint)
 {
-    mpz_t n, e, d;
-    mpz_inits(n, e, d, NULL);
-
-    printf("\nGerando par de chaves RSA de %d bits...\n", KEY_BITS);
-    printf("Testando primalidade com Miller-Rabin (%d iterações)...\n", MILLER_RABIN_ITERATIONS);
-    generate_rsa_keys(n, e, d, KEY_BITS);
-    save_keys(n, e, d);
-
-    mpz_clears(n, e, d, NULL);
+    if (!kr)
+        return key;
+    return has_fingerprint ? keyring_find(kr, fingerprint) : NULL;
 }
 
 /**
- * @brief Função wrapper para calcular SHA3-256.
- * @param input Dados de entrada.
- * @param input_len Comprimento dos dados.
- * @param output Ponteiro para o buffer do hash (será alocado).
- * @param output_len Ponteiro para o comprimento do hash.
+ * @brief Opções de verificação comuns a todos os arquivos de uma chamada de verify.
  */
-void sha3_hash(const unsigned char *input, size_t input_len, unsigned char **output, unsigned int *output_len)
+typedef struct
 {
-    *output = malloc(SHA3_256_DIGEST_SIZE);
-    sha3_256(input, input_len, *output);
-    *output_len = SHA3_256_DIGEST_SIZE;
-}
+    const rsa_key *key;   // Chave única (se kr == NULL)
+    const keyring *kr;    // Keyring, ou NULL
+    unsigned long long range_start, range_len; // range_len == 0: mensagem inteira
+    int threads;
+    verify_cache *cache;  // NULL sem --cache
+    int cache_by_content; // Chave do cache pelo conteúdo em vez da identidade do arquivo
+} cli_verify_options;
 
 /**
- * @brief Menu para assinar um arquivo.
+ * @brief Verifica um arquivo assinado por blocos direto do disco: a assinatura do
+ *        índice e, em paralelo, os blocos que cobrem o intervalo pedido.
+ * @param detail Recebe a descrição do bloco corrompido, se houver.
+ * @return O resultado da verificação.
  */
-void sign_file_menu()
+static verify_status cli_verify_chunked(const char *name, const rsa_key *vkey, const signed_message *msg,
+                                        const cli_verify_options *opt, char *detail, size_t detail_size)
 {
-    char file_to_sign[256], key_file[256];
-    unsigned char *file_content, *file_hash;
-    unsigned int hash_len;
-    size_t file_len;
-
-    printf("Digite o nome do arquivo a ser assinado: ");
-    scanf("%255s", file_to_sign);
-    printf("Digite o nome do arquivo da chave privada (ex: private_key.txt): ");
-    scanf("%255s", key_file);
-
-    if (!read_file_content(file_to_sign, &file_content, &file_len))
-    {
-        printf("Erro: Não foi possível ler o arquivo '%s'.\n", file_to_sign);
-        return;
-    }
-
-    mpz_t n, d;
-    mpz_inits(n, d, NULL);
-    if (!load_key(key_file, n, d))
-    {
-        printf("Erro: Não foi possível carregar a chave privada de '%s'.\n", key_file);
-        free(file_content);
-        mpz_clears(n, d, NULL);
-        return;
-    }
-
-    // 1. Calcular o hash do arquivo
-    sha3_hash(file_content, file_len, &file_hash, &hash_len);
+    verify_status status = rsa_verify_chunk_index(vkey, msg);
+    if (status != VERIFY_OK)
+        return status;
 
-    // 2. Aplicar padding OAEP ao hash
-    int k = mpz_sizeinbase(n, 256);
-    unsigned char *padded_hash;
-    if (!rsa_oaep_pad(file_hash, hash_len, k, &padded_hash))
+    const chunk_index *idx = &msg->chunks;
+    uint64_t first = 0, last = idx->count;
+    if (opt->range_len > 0)
     {
-        printf("Erro ao aplicar padding OAEP.\n");
-        free(file_content);
-        free(file_hash);
-        mpz_clears(n, d, NULL);
-        return;
+        if (opt->range_start >= idx->content_len || opt->range_len > idx->content_len - opt->range_start)
+        {
+            snprintf(detail, detail_size, "intervalo fora da mensagem");
+            return VERIFY_BAD_DIGEST;
+        }
+        first = opt->range_start / idx->chunk_size;
+        last = (opt->range_start + opt->range_len + idx->chunk_size - 1) / idx->chunk_size;
     }
 
-    // 3. "Cifrar" o hash com padding usando a chave privada (operação de assinatura)
-    mpz_t padded_hash_mpz, signature_mpz;
-    mpz_inits(padded_hash_mpz, signature_mpz, NULL);
-    mpz_import(padded_hash_mpz, k, 1, sizeof(unsigned char), 0, 0, padded_hash);
-    mpz_powm(signature_mpz, padded_hash_mpz, d, n);
-
-    size_t signature_len;
-    unsigned char *signature = (unsigned char *)mpz_export(NULL, &signature_len, 1, sizeof(unsigned char), 0, 0, signature_mpz);
-
-    // 4. Formatar a saída
-    size_t content_b64_len, sig_b64_len;
-    char *content_b64 = base64_encode(file_content, file_len, &content_b64_len);
-    char *sig_b64 = base64_encode(signature, signature_len, &sig_b64_len);
-
-    char signed_filename[300];
-    snprintf(signed_filename, sizeof(signed_filename), "%s.signed", file_to_sign);
-
-    FILE *out_file = fopen(signed_filename, "w");
-    if (!out_file)
-    {
-        printf("Erro ao criar arquivo de saída '%s'.\n", signed_filename);
-    }
-    else
+    uint64_t bad;
+    status = verify_chunked_file(name, msg, first, last, opt->threads, &bad);
+    if (status != VERIFY_OK)
     {
-        fprintf(out_file, "-----BEGIN SIGNED MESSAGE-----\n");
-        fprintf(out_file, "%s\n", content_b64);
-        fprintf(out_file, "-----BEGIN SIGNATURE-----\n");
-        fprintf(out_file, "%s\n", sig_b64);
-        fprintf(out_file, "-----END SIGNATURE-----\n");
-        fclose(out_file);
-        printf("Arquivo assinado com sucesso e salvo como '%s'.\n", signed_filename);
+        uint64_t end = (bad + 1) * idx->chunk_size < idx->content_len ? (bad + 1) * idx->chunk_size : idx->content_len;
+        snprintf(detail, detail_size, "bloco %llu de %llu corrompido, bytes %llu-%llu", (unsigned long long)bad,
+                 (unsigned long long)idx->count, (unsigned long long)(bad * idx->chunk_size),
+                 (unsigned long long)end - 1);
     }
-
-    // Limpeza
-    free(file_content);
-    free(file_hash);
-    free(padded_hash);
-    free(signature);
-    free(content_b64);
-    free(sig_b64);
-    mpz_clears(n, d, padded_hash_mpz, signature_mpz, NULL);
+    return status;
 }
 
 /**
- * @brief Menu para verificar a assinatura de um arquivo.
+ * @brief Impressão digital da chave que verificará o arquivo, para a chave do cache:
+ *        a da chave única, ou a do cabeçalho do arquivo se ela estiver no keyring.
+ * @param text Arquivo já lido, ou NULL para ler só o início de 'name'.
+ * @return 1 se houver chave para o arquivo, 0 caso contrário.
  */
-void verify_file_menu()
+static int cli_cache_anchor(const char *name, const unsigned char *text, size_t text_len,
+                            const cli_verify_options *opt, unsigned char *fingerprint)
 {
-    char signed_file_name[256], key_file[256];
-
-    printf("Digite o nome do arquivo assinado (ex: arquivo.txt.signed): ");
-    scanf("%255s", signed_file_name);
-    printf("Digite o nome do arquivo da chave pública (ex: public_key.txt): ");
-    scanf("%255s", key_file);
-
-    mpz_t n, e;
-    mpz_inits(n, e, NULL);
-    if (!load_key(key_file, n, e))
+    if (!opt->kr)
     {
-        printf("Erro: Não foi possível carregar a chave pública de '%s'.\n", key_file);
-        mpz_clears(n, e, NULL);
-        return;
+        memcpy(fingerprint, opt->key->fingerprint, SHA3_256_DIGEST_SIZE);
+        return 1;
     }
 
-    // 1. Ler e parsear o arquivo assinado
-    FILE *f = fopen(signed_file_name, "r");
-    if (!f)
+    char head[512]; // O cabeçalho Key-Fingerprint é a primeira linha
+    if (!text)
     {
-        printf("Erro ao abrir o arquivo assinado '%s'.\n", signed_file_name);
-        mpz_clears(n, e, NULL);
-        return;
+        FILE *f = fopen(name, "rb");
+        text_len = f ? fread(head, 1, sizeof(head), f) : 0;
+        if (f)
+            fclose(f);
+        text = (const unsigned char *)head;
     }
+    return signed_file_fingerprint((const char *)text, text_len, fingerprint) &&
+           keyring_find(opt->kr, fingerprint) != NULL;
+}
 
-    char line[1024];
-    char *content_b64 = NULL;
-    char *sig_b64 = NULL;
-    size_t content_alloc = 0, sig_alloc = 0;
-    size_t content_len = 0, sig_len = 0;
-    int reading_content = 0, reading_sig = 0;
+/**
+ * @brief Verifica um arquivo (ou a entrada padrão), consultando e alimentando o cache.
+ *
+ * Só resultados da mensagem inteira entram no cache. Pela identidade do arquivo,
+ * a entrada só é gravada se a identidade for a mesma antes e depois da
+ * verificação; pelo conteúdo, a verificação usa os mesmos bytes do digest.
+ * @param reason Recebe NULL se a assinatura for válida, ou o motivo da falha.
+ * @param chunked Recebe 1 se o arquivo foi verificado por blocos direto do disco.
+ * @return CLI_OK, ou CLI_ERROR se o arquivo não puder ser lido (mensagem já impressa).
+ */
+static int cli_verify_one(const char *name, const cli_verify_options *opt, const char **reason, char *detail,
+                          size_t detail_size, int *chunked)
+{
+    unsigned char *text = NULL;
+    size_t text_len = 0;
+    unsigned char anchor[SHA3_256_DIGEST_SIZE], cache_key[SHA3_256_DIGEST_SIZE];
+    int cacheable = 0;
+    *chunked = 0;
 
-    while (fgets(line, sizeof(line), f))
+    if (opt->cache && opt->range_len == 0)
     {
-        if (strncmp(line, "-----BEGIN SIGNED MESSAGE-----", 29) == 0)
+        verify_status status;
+        if (opt->cache_by_content)
         {
-            reading_content = 1;
-            reading_sig = 0;
-            continue;
-        }
-        else if (strncmp(line, "-----BEGIN SIGNATURE-----", 24) == 0)
-        {
-            reading_content = 0;
-            reading_sig = 1;
-            continue;
+            double t = trace_start();
+            if (!read_input(name, &text, &text_len))
+            {
+                fprintf(stderr, "Erro: Não foi possível ler '%s'.\n", name);
+                return CLI_ERROR;
+            }
+            trace_stop(TRACE_READ, t);
+            cacheable = cli_cache_anchor(name, text, text_len, opt, anchor);
+            if (cacheable)
+                verify_cache_content_key(text, text_len, anchor, cache_key);
         }
-        else if (strncmp(line, "-----END SIGNATURE-----", 22) == 0)
+        else if (strcmp(name, "-") != 0)
+            cacheable = cli_cache_anchor(name, NULL, 0, opt, anchor) && verify_cache_stat_key(name, anchor, cache_key);
+
+        if (cacheable && verify_cache_lookup(opt->cache, cache_key, &status))
         {
-            reading_sig = 0;
-            break;
+            *reason = verify_reason(status);
+            free(text);
+            return CLI_OK;
         }
+    }
 
-        if (reading_content)
+    // Por blocos: só o cabeçalho e o índice são lidos aqui
+    signed_message msg;
+    memset(&msg, 0, sizeof(msg));
+    *chunked = !text && strcmp(name, "-") != 0 && read_signed_file_index(name, &msg);
+    if (!*chunked)
+    {
+        signed_message_clear(&msg);
+        if (!text)
         {
-            size_t line_len = strlen(line);
-            if (line[line_len - 1] == '\n')
-                line_len--;
-            if (content_len + line_len + 1 > content_alloc)
+            double t = trace_start();
+            if (!read_input(name, &text, &text_len))
             {
-                content_alloc = (content_alloc == 0) ? line_len + 1 : content_alloc * 2;
-                content_b64 = realloc(content_b64, content_alloc);
+                fprintf(stderr, "Erro: Não foi possível ler '%s'.\n", name);
+                return CLI_ERROR;
             }
-            memcpy(content_b64 + content_len, line, line_len);
-            content_len += line_len;
+            trace_stop(TRACE_READ, t);
         }
-        else if (reading_sig)
+        int parsed = signed_file_parse((const char *)text, text_len, &msg);
+        free(text);
+        if (!parsed)
         {
-            size_t line_len = strlen(line);
-            if (line[line_len - 1] == '\n')
-                line_len--;
-            if (sig_len + line_len + 1 > sig_alloc)
-            {
-                sig_alloc = (sig_alloc == 0) ? line_len + 1 : sig_alloc * 2;
-                sig_b64 = realloc(sig_b64, sig_alloc);
-            }
-            memcpy(sig_b64 + sig_len, line, line_len);
-            sig_len += line_len;
+            fprintf(stderr, "Erro: Formato de arquivo assinado inválido em '%s'.\n", name);
+            signed_message_clear(&msg);
+            return CLI_ERROR;
         }
     }
-    fclose(f);
-    if (content_b64)
-        content_b64[content_len] = '\0';
-    if (sig_b64)
-        sig_b64[sig_len] = '\0';
 
-    if (!content_b64 || !sig_b64)
+    const rsa_key *vkey = cli_pick_key(opt->key, opt->kr, msg.fingerprint, msg.has_fingerprint);
+    *reason = "nenhuma chave do keyring corresponde";
+    detail[0] = '\0';
+    if (vkey)
     {
-        printf("Erro: Formato de arquivo assinado inválido.\n");
-        free(content_b64);
-        free(sig_b64);
-        mpz_clears(n, e, NULL);
-        return;
+        verify_status status = *chunked ? cli_verify_chunked(name, vkey, &msg, opt, detail, detail_size)
+                                        : rsa_verify_message(vkey, &msg);
+        *reason = detail[0] ? detail : verify_reason(status);
+
+        unsigned char after[SHA3_256_DIGEST_SIZE];
+        if (cacheable && memcmp(vkey->fingerprint, anchor, SHA3_256_DIGEST_SIZE) == 0 &&
+            (opt->cache_by_content ||
+             (verify_cache_stat_key(name, anchor, after) && memcmp(after, cache_key, SHA3_256_DIGEST_SIZE) == 0)))
+            verify_cache_store(opt->cache, cache_key, status);
     }
+    signed_message_clear(&msg);
+    return CLI_OK;
+}
 
-    // 2. Decodificar Base64
-    size_t original_content_len, signature_len;
-    unsigned char *original_content = base64_decode(content_b64, content_len, &original_content_len);
-    unsigned char *signature = base64_decode(sig_b64, sig_len, &signature_len);
-
-    // 3. "Decifrar" a assinatura com a chave pública
-    mpz_t signature_mpz, decrypted_padded_hash_mpz;
-    mpz_inits(signature_mpz, decrypted_padded_hash_mpz, NULL);
-    mpz_import(signature_mpz, signature_len, 1, sizeof(unsigned char), 0, 0, signature);
-    mpz_powm(decrypted_padded_hash_mpz, signature_mpz, e, n);
-
-    int k = mpz_sizeinbase(n, 256);
-    size_t decrypted_padded_hash_len;
-    unsigned char *decrypted_padded_hash = (unsigned char *)mpz_export(NULL, &decrypted_padded_hash_len, 1, sizeof(unsigned char), 0, 0, decrypted_padded_hash_mpz);
-
-    // Garantir que a saída tenha o tamanho K (preencher com zeros à esquerda se necessário)
-    unsigned char *final_padded_hash = calloc(k, 1);
-    memcpy(final_padded_hash + (k - decrypted_padded_hash_len), decrypted_padded_hash, decrypted_padded_hash_len);
+/**
+ * @brief verify: verifica cada arquivo assinado e imprime '<arquivo>: OK' ou o motivo da falha.
+ *
+ * Arquivos assinados por blocos são verificados direto do disco, em paralelo; com
+ * '--range', apenas os blocos do intervalo são lidos. Com '--cache', resultados
+ * de verificações anteriores do mesmo arquivo com a mesma chave são reaproveitados;
+ * um arquivo de cache que exista e não seja um cache interrompe o comando, sem ser alterado.
+ */
+static int cmd_verify(int argc, char *argv[], int first)
+{
+    const char *key_file = NULL, *cache_path = NULL;
+    int count = 0;
+    cli_verify_options opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.threads = keygen_thread_count();
 
-    // 4. Remover o padding OAEP para obter o hash original
-    unsigned char *original_hash;
-    size_t original_hash_len;
-    if (!rsa_oaep_unpad(final_padded_hash, k, &original_hash, &original_hash_len))
+    for (int i = first; i < argc; i++)
     {
-        printf("\n=========================\n");
-        printf("VERIFICAÇÃO FALHOU! (Erro no unpadding)\n");
-        printf("=========================\n");
+        const char *value;
+        if (strcmp(argv[i], "--cache") == 0)
+            cache_path = VERIFY_CACHE_DEFAULT_PATH;
+        else if (strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8])
+            cache_path = argv[i] + 8;
+        else if (strcmp(argv[i], "--cache-by-content") == 0)
+            opt.cache_by_content = 1;
+        else if (cli_option(argc, argv, &i, "-k", "--key", &value))
+            key_file = value;
+        else if (cli_option(argc, argv, &i, "-t", "--threads", &value))
+            opt.threads = value ? atoi(value) : 0;
+        else if (cli_option(argc, argv, &i, "-r", "--range", &value))
+        {
+            if (!value || sscanf(value, "%llu:%llu", &opt.range_start, &opt.range_len) != 2 || opt.range_len == 0)
+            {
+                fprintf(stderr, "Erro: '--range' espera 'início:tamanho' em bytes.\n");
+                return CLI_USAGE;
+            }
+        }
+        else if (!cli_operand(argv, i, first, &count))
+            return CLI_USAGE;
     }
-    else
+    if (!key_file || opt.threads < 1)
     {
-        // 5. Calcular o hash do conteúdo original e comparar
-        unsigned char *calculated_hash;
-        unsigned int calculated_hash_len;
-        sha3_hash(original_content, original_content_len, &calculated_hash, &calculated_hash_len);
-
-        if (original_hash_len == calculated_hash_len && memcmp(original_hash, calculated_hash, original_hash_len) == 0)
+        fprintf(stderr, "Erro: verify exige '-k chave_pública' ou '-k diretório_do_keyring'.\n");
+        return CLI_USAGE;
+    }
+    if (opt.cache_by_content && !cache_path)
+        cache_path = VERIFY_CACHE_DEFAULT_PATH;
+    if (count == 0)
+        argv[first + count++] = "-";
+
+    // Chave única ou keyring, carregados uma vez para todos os arquivos
+    rsa_key key;
+    keyring kr;
+    int use_keyring;
+    if (!cli_load_verify_keys(key_file, &key, &kr, &use_keyring))
+        return CLI_ERROR;
+    opt.key = &key;
+    opt.kr = use_keyring ? &kr : NULL;
+
+    // Sem o cache, a verificação continua normalmente; um arquivo que não é um cache não é tocado
+    verify_cache cache;
+    if (cache_path && verify_cache_open(&cache, cache_path, VERIFY_CACHE_DEFAULT_SLOTS))
+        opt.cache = &cache;
+    else if (cache_path && errno == EINVAL)
+    {
+        fprintf(stderr, "Erro: '%s' não é um cache de verificação (magic, versão ou tamanho inválidos).\n",
+                cache_path);
+        if (use_keyring)
+            keyring_clear(&kr);
+        rsa_key_clear(&key);
+        return CLI_ERROR;
+    }
+    else if (cache_path)
+        fprintf(stderr, "Aviso: Não foi possível abrir o cache '%s' (%s); verificando sem cache.\n", cache_path,
+                strerror(errno));
+
+    int result = CLI_OK;
+    trace_histogram hist;
+    trace_histogram_init(&hist);
+    for (int i = first; i < first + count; i++)
+    {
+        const char *name = argv[i];
+        trace_record trace;
+        memset(&trace, 0, sizeof(trace));
+        trace_attach(trace_enabled ? &trace : NULL);
+
+        const char *reason;
+        char detail[128];
+        int chunked;
+        if (cli_verify_one(name, &opt, &reason, detail, sizeof(detail), &chunked) != CLI_OK)
         {
-            printf("\n=========================\n");
-            printf("ASSINATURA VÁLIDA!\n");
-            printf("=========================\n");
+            trace_attach(NULL);
+            result = CLI_ERROR;
+            continue;
         }
-        else
+        cli_trace_finish(&trace, &hist, count > 1, name);
+
+        if (reason)
         {
-            printf("\n=========================\n");
-            printf("VERIFICAÇÃO FALHOU! (Hashes não correspondem)\n");
-            printf("=========================\n");
+            printf("%s: FALHOU (%s)\n", name, reason);
+            if (result == CLI_OK)
+                result = CLI_VERIFY_FAILED;
         }
-        free(original_hash);
-        free(calculated_hash);
+        else if (chunked && opt.range_len > 0)
+            printf("%s: OK (bytes %llu-%llu)\n", name, opt.range_start, opt.range_start + opt.range_len - 1);
+        else
+            printf("%s: OK\n", name);
     }
 
-    // Limpeza
-    free(content_b64);
-    free(sig_b64);
-    free(original_content);
-    free(signature);
-    free(decrypted_padded_hash);
-    free(final_padded_hash);
-    mpz_clears(n, e, signature_mpz, decrypted_padded_hash_mpz, NULL);
+    if (trace_enabled && count > 1)
+        trace_histogram_print(stderr, &hist, "verify");
+    if (trace_enabled && opt.cache)
+        fprintf(stderr, "cache: %lu acertos, %lu faltas, %lu gravações\n", cache.hits, cache.misses, cache.stores);
+    if (opt.cache)
+        verify_cache_close(&cache);
+    if (use_keyring)
+        keyring_clear(&kr);
+    rsa_key_clear(&key);
+    return result;
 }
 
 /**
- * @brief Menu para extrair a mensagem original de um arquivo assinado.
+ * @brief extract: grava a mensagem original de um arquivo assinado (saída padrão por padrão).
  */
-void extract_message_menu()
+static int cmd_extract(int argc, char *argv[], int first)
 {
-    char signed_file_name[256], output_file[256];
+    const char *output = "-";
+    int count = 0;
 
-    printf("Digite o nome do arquivo assinado (ex: arquivo.txt.signed): ");
-    scanf("%255s", signed_file_name);
+    for (int i = first; i < argc; i++)
+    {
+        const char *value;
+        if (cli_option(argc, argv, &i, "-o", "--output", &value))
+            output = value;
+        else if (!cli_operand(argv, i, first, &count))
+            return CLI_USAGE;
+    }
+    if (!output || count > 1)
+    {
+        fprintf(stderr, "Erro: extract aceita um único arquivo assinado e um único '-o'.\n");
+        return CLI_USAGE;
+    }
+    const char *name = count ? argv[first] : "-";
 
-    // 1. Ler e parsear o arquivo assinado
-    FILE *f = fopen(signed_file_name, "r");
-    if (!f)
+    unsigned char *text;
+    size_t text_len;
+    if (!read_input(name, &text, &text_len))
     {
-        printf("Erro ao abrir o arquivo assinado '%s'.\n", signed_file_name);
-        return;
+        fprintf(stderr, "Erro: Não foi possível ler '%s'.\n", name);
+        return CLI_ERROR;
+    }
+    signed_message msg;
+    int ok = signed_file_parse((const char *)text, text_len, &msg);
+    free(text);
+    if (!ok)
+    {
+        fprintf(stderr, "Erro: Não foi possível encontrar a mensagem em '%s'.\n", name);
+        signed_message_clear(&msg);
+        return CLI_ERROR;
     }
 
-    char line[1024];
-    char *content_b64 = NULL;
-    size_t content_alloc = 0;
-    size_t content_len = 0;
-    int reading_content = 0;
+    ok = write_output(output, msg.content, msg.content_len);
+    if (!ok)
+        fprintf(stderr, "Erro: Não foi possível gravar a mensagem em '%s'.\n", output);
+    signed_message_clear(&msg);
+    return ok ? CLI_OK : CLI_ERROR;
+}
+
+/**
+ * @brief hash: imprime '<sha3-256>  <arquivo>' de cada arquivo, lendo em blocos.
+ */
+static int cmd_hash(int argc, char *argv[], int first)
+{
+    int count = 0;
+    for (int i = first; i < argc; i++)
+    {
+        if (!cli_operand(argv, i, first, &count))
+            return CLI_USAGE;
+    }
+    if (count == 0)
+        argv[first + count++] = "-";
 
-    while (fgets(line, sizeof(line), f))
+    int result = CLI_OK;
+    for (int i = first; i < first + count; i++)
     {
-        if (strncmp(line, "-----BEGIN SIGNED MESSAGE-----", 29) == 0)
+        const char *name = argv[i];
+        FILE *f = strcmp(name, "-") == 0 ? stdin : fopen(name, "rb");
+        unsigned char digest[SHA3_256_DIGEST_SIZE];
+        int ok = f && sha3_256_stream(f, digest);
+        if (f && f != stdin)
+            fclose(f);
+        if (!ok)
         {
-            reading_content = 1;
+            fprintf(stderr, "Erro: Não foi possível ler '%s'.\n", name);
+            result = CLI_ERROR;
             continue;
         }
-        else if (strncmp(line, "-----BEGIN SIGNATURE-----", 24) == 0)
+
+        char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+        bytes_to_hex(digest, SHA3_256_DIGEST_SIZE, hex);
+        printf("%s  %s\n", hex, name);
+    }
+    return result;
+}
+
+/**
+ * @brief manifest sign: assina todos os arquivos de um diretório com uma única operação privada.
+ */
+static int manifest_cmd_sign(const char *key_file, const char *output, int threads, const char *dirname)
+{
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!load_rsa_key(key_file, &key, 1))
+    {
+        fprintf(stderr, "Erro: Não foi possível carregar a chave privada de '%s'.\n", key_file);
+        rsa_key_clear(&key);
+        return CLI_ERROR;
+    }
+
+    merkle_manifest m;
+    const char *failed;
+    int result = CLI_OK;
+    int built = merkle_manifest_build(&m, dirname, threads, &failed);
+    if (manifest_report_skipped(&m, dirname, stderr) > 0)
+        result = CLI_ERROR;
+    else if (!built)
+    {
+        if (failed)
+            fprintf(stderr, "Erro: Não foi possível ler '%s/%s'.\n", dirname, failed);
+        else
+            fprintf(stderr, "Erro: O diretório '%s' não pôde ser lido ou não contém arquivos.\n", dirname);
+        result = CLI_ERROR;
+    }
+    else
+    {
+        char default_name[4096];
+        int named = 1;
+        if (!output)
         {
-            reading_content = 0;
-            break;
+            size_t dir_len = strlen(dirname);
+            while (dir_len > 1 && dirname[dir_len - 1] == '/')
+                dir_len--;
+            named = snprintf(default_name, sizeof(default_name), "%.*s.manifest", (int)dir_len, dirname) <
+                    (int)sizeof(default_name);
+            output = default_name;
         }
 
-        if (reading_content)
+        size_t len;
+        char *text = named && merkle_manifest_sign(&m, &key, thread_rng()) ? merkle_manifest_format(&m, &len) : NULL;
+        if (!named)
         {
-            size_t line_len = strlen(line);
-            if (line[line_len - 1] == '\n')
-                line_len--;
-            if (content_len + line_len + 1 > content_alloc)
-            {
-                content_alloc = (content_alloc == 0) ? line_len + 1 : content_alloc * 2;
-                content_b64 = realloc(content_b64, content_alloc);
-            }
-            memcpy(content_b64 + content_len, line, line_len);
-            content_len += line_len;
+            fprintf(stderr, "Erro: Nome longo demais para o manifesto de '%s'; use '-o'.\n", dirname);
+            result = CLI_ERROR;
+        }
+        else if (!text || !write_output(output, text, len))
+        {
+            fprintf(stderr, "Erro: Não foi possível criar o manifesto '%s'.\n", output);
+            result = CLI_ERROR;
         }
+        free(text);
     }
-    fclose(f);
+    merkle_manifest_clear(&m);
+    rsa_key_clear(&key);
+    return result;
+}
 
-    if (content_b64)
-        content_b64[content_len] = '\0';
+/**
+ * @brief manifest prove: extrai a prova de inclusão de um arquivo do manifesto.
+ */
+static int manifest_cmd_prove(const char *output, const char *manifest_file, const char *path)
+{
+    merkle_manifest m;
+    if (!load_manifest(manifest_file, &m, stderr))
+        return CLI_ERROR;
+
+    long index = merkle_manifest_find(&m, path);
+    merkle_proof proof;
+    size_t len;
+    char *text = NULL;
+    int result = CLI_ERROR;
+    if (index < 0)
+        fprintf(stderr, "Erro: '%s' não está no manifesto '%s'.\n", path, manifest_file);
+    else if (!merkle_proof_create(&m, (size_t)index, &proof) || !(text = merkle_proof_format(&proof, &len)) ||
+             !write_output(output ? output : "-", text, len))
+        fprintf(stderr, "Erro: Não foi possível gravar a prova de '%s'.\n", path);
+    else
+        result = CLI_OK;
 
-    if (!content_b64)
+    if (index >= 0)
+        merkle_proof_clear(&proof);
+    free(text);
+    merkle_manifest_clear(&m);
+    return result;
+}
+
+/**
+ * @brief manifest check: verifica um único arquivo com a sua prova, sem ler o resto do diretório.
+ */
+static int manifest_cmd_check(const char *key_file, const char *proof_file, const char *name)
+{
+    unsigned char *text;
+    size_t len;
+    merkle_proof proof;
+    if (!read_input(proof_file, &text, &len))
     {
-        printf("Erro: Não foi possível encontrar a mensagem no arquivo assinado.\n");
-        return;
+        fprintf(stderr, "Erro: Não foi possível ler a prova '%s'.\n", proof_file);
+        return CLI_ERROR;
+    }
+    int parsed = merkle_proof_parse((const char *)text, len, &proof);
+    free(text);
+    if (!parsed)
+    {
+        fprintf(stderr, "Erro: '%s' não é uma prova de inclusão válida.\n", proof_file);
+        merkle_proof_clear(&proof);
+        return CLI_ERROR;
     }
 
-    // 2. Decodificar Base64
-    size_t original_content_len;
-    unsigned char *original_content = base64_decode(content_b64, content_len, &original_content_len);
-
-    if (!original_content)
+    FILE *f = strcmp(name, "-") == 0 ? stdin : fopen(name, "rb");
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    int hashed = f && sha3_256_stream(f, digest);
+    if (f && f != stdin)
+        fclose(f);
+    if (!hashed)
     {
-        printf("Erro: Não foi possível decodificar a mensagem Base64.\n");
-        free(content_b64);
-        return;
+        fprintf(stderr, "Erro: Não foi possível ler '%s'.\n", name);
+        merkle_proof_clear(&proof);
+        return CLI_ERROR;
     }
 
-    printf("\nConteúdo da mensagem: ");
-    for (size_t i = 0; i < original_content_len; i++)
+    rsa_key key;
+    keyring kr;
+    int use_keyring;
+    if (!cli_load_verify_keys(key_file, &key, &kr, &use_keyring))
     {
-        printf("%c", original_content[i]);
+        merkle_proof_clear(&proof);
+        return CLI_ERROR;
     }
-    printf("\n\n");
 
-    printf("Deseja salvar a mensagem original em um arquivo? (s/n): ");
-    char save_choice;
-    scanf(" %c", &save_choice);
-    if (save_choice == 's' || save_choice == 'S')
+    const rsa_key *vkey = cli_pick_key(&key, use_keyring ? &kr : NULL, proof.fingerprint, proof.has_fingerprint);
+    const char *reason = "nenhuma chave do keyring corresponde";
+    if (vkey)
+        reason = verify_reason(merkle_proof_verify(&proof, vkey, digest));
+    if (reason)
+        printf("%s: FALHOU (%s)\n", name, reason);
+    else
+        printf("%s: OK (%s)\n", name, proof.path);
+
+    if (use_keyring)
+        keyring_clear(&kr);
+    rsa_key_clear(&key);
+    merkle_proof_clear(&proof);
+    return reason ? CLI_VERIFY_FAILED : CLI_OK;
+}
+
+/**
+ * @brief manifest verify: verifica a assinatura do manifesto e, com um diretório,
+ *        lista os arquivos alterados, ausentes ou não listados.
+ */
+static int manifest_cmd_verify(const char *key_file, const char *manifest_file, const char *dirname)
+{
+    merkle_manifest m;
+    if (!load_manifest(manifest_file, &m, stderr))
+        return CLI_ERROR;
+
+    rsa_key key;
+    keyring kr;
+    int use_keyring;
+    if (!cli_load_verify_keys(key_file, &key, &kr, &use_keyring))
     {
-        printf("Digite o nome do arquivo de saída (ex: mensagem.txt): ");
-        scanf("%255s", output_file);
+        merkle_manifest_clear(&m);
+        return CLI_ERROR;
+    }
 
-        FILE *out_file = fopen(output_file, "wb");
-        if (!out_file)
+    const rsa_key *vkey = cli_pick_key(&key, use_keyring ? &kr : NULL, m.fingerprint, m.has_fingerprint);
+    const char *reason = "nenhuma chave do keyring corresponde";
+    if (vkey)
+        reason = verify_reason(merkle_manifest_verify(&m, vkey));
+
+    int result = CLI_OK;
+    if (reason)
+    {
+        printf("%s: FALHOU (%s)\n", manifest_file, reason);
+        result = CLI_VERIFY_FAILED;
+    }
+    else if (dirname)
+    {
+        long differences = manifest_compare_dir(&m, dirname, stdout);
+        if (differences < 0)
         {
-            printf("Erro ao criar o arquivo de saída '%s'.\n", output_file);
+            fprintf(stderr, "Erro: Não foi possível ler o diretório '%s'.\n", dirname);
+            result = CLI_ERROR;
         }
-        else
+        else if (differences > 0)
         {
-            fwrite(original_content, 1, original_content_len, out_file);
-            fclose(out_file);
-            printf("Mensagem original salva em '%s'.\n", output_file);
+            printf("%s: FALHOU (%ld diferenças em '%s')\n", manifest_file, differences, dirname);
+            result = CLI_VERIFY_FAILED;
         }
+        else
+            printf("%s: OK (%zu arquivos em '%s')\n", manifest_file, m.count, dirname);
     }
     else
+        printf("%s: OK (%zu arquivos)\n", manifest_file, m.count);
+
+    if (use_keyring)
+        keyring_clear(&kr);
+    rsa_key_clear(&key);
+    merkle_manifest_clear(&m);
+    return result;
+}
+
+/**
+ * @brief manifest: assinatura de diretórios por árvore de Merkle (sign, prove, check, verify).
+ */
+static int cmd_manifest(int argc, char *argv[], int first)
+{
+    const char *action = first < argc ? argv[first++] : "";
+    const char *key_file = NULL, *output = NULL;
+    int threads = keygen_thread_count(), count = 0;
+
+    for (int i = first; i < argc; i++)
     {
-        printf("Mensagem original não salva.\n");
+        const char *value;
+        if (cli_option(argc, argv, &i, "-k", "--key", &value))
+            key_file = value;
+        else if (cli_option(argc, argv, &i, "-o", "--output", &value))
+            output = value;
+        else if (cli_option(argc, argv, &i, "-t", "--threads", &value))
+            threads = value ? atoi(value) : 0;
+        else if (!cli_operand(argv, i, first, &count))
+            return CLI_USAGE;
     }
-    // Limpeza
-    free(content_b64);
-    free(original_content);
+
+    const char *a = count > 0 ? argv[first] : NULL, *b = count > 1 ? argv[first + 1] : NULL;
+    if (strcmp(action, "sign") == 0 && key_file && count == 1 && threads > 0)
+        return manifest_cmd_sign(key_file, output, threads, a);
+    if (strcmp(action, "prove") == 0 && count == 2)
+        return manifest_cmd_prove(output, a, b);
+    if (strcmp(action, "check") == 0 && key_file && count == 2)
+        return manifest_cmd_check(key_file, a, b);
+    if (strcmp(action, "verify") == 0 && key_file && (count == 1 || count == 2))
+        return manifest_cmd_verify(key_file, a, b);
+
+    fprintf(stderr, "Erro: Uso de manifest:\n");
+    fprintf(stderr, "  manifest sign   -k chave_privada [-t threads] [-o saída] diretório\n");
+    fprintf(stderr, "  manifest prove  [-o saída] manifesto caminho\n");
+    fprintf(stderr, "  manifest check  -k chave_pública|keyring prova arquivo|-\n");
+    fprintf(stderr, "  manifest verify -k chave_pública|keyring manifesto [diretório]\n");
+    return CLI_USAGE;
+}
+
+/**
+ * @brief Executa o subcomando argv[index] com os argumentos seguintes.
+ * @return O código de saída do processo.
+ */
+static int run_command(int argc, char *argv[], int index)
+{
+    const char *command = argv[index];
+    int first = index + 1;
+
+    if (strcmp(command, "keygen") == 0)
+        return cmd_keygen(argc, argv, first);
+    if (strcmp(command, "sign") == 0)
+        return cmd_sign(argc, argv, first);
+    if (strcmp(command, "verify") == 0)
+        return cmd_verify(argc, argv, first);
+    if (strcmp(command, "extract") == 0)
+        return cmd_extract(argc, argv, first);
+    if (strcmp(command, "hash") == 0)
+        return cmd_hash(argc, argv, first);
+    if (strcmp(command, "manifest") == 0)
+        return cmd_manifest(argc, argv, first);
+
+    fprintf(stderr, "Erro: Comando desconhecido '%s'.\n", command);
+    print_usage(stderr, argv[0]);
+    return CLI_USAGE;
+}
+
+/**
+ * @brief Trata as opções globais, que vêm antes do subcomando.
+ * @return Índice do subcomando (argc se não houver), ou -1 se houver uma opção desconhecida.
+ */
+static int parse_options(int argc, char *argv[])
+{
+    int i;
+    for (i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if (strcmp(argv[i], "--stats") == 0)
+            keygen_stats_enabled = 1;
+        else if (strncmp(argv[i], "--stats=", 8) == 0 && argv[i][8])
+        {
+            keygen_stats_enabled = 1;
+            keygen_stats_path = argv[i] + 8;
+        }
+        else if (strcmp(argv[i], "--trace") == 0)
+            trace_enabled = 1;
+        else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
+        {
+            print_usage(stdout, argv[0]);
+            exit(CLI_OK);
+        }
+        else
+        {
+            fprintf(stderr, "Erro: Opção desconhecida '%s'.\n", argv[i]);
+            print_usage(stderr, argv[0]);
+            return -1;
+        }
+    }
+    return i;
 }
 
 /**
- * @brief Função principal com o menu de interação (versão atualizada).
+ * @brief Função principal: executa um subcomando ou abre o menu de interação.
  */
-int main()
+int main(int argc, char *argv[])
 {
     int choice;
 
+    int command = parse_options(argc, argv);
+    if (command < 0)
+        return CLI_USAGE;
+    arena_install_gmp();
+    if (!thread_rng()) // Semeia o gerador da thread principal
+    {
+        fprintf(stderr, "Erro: Não foi possível obter entropia do sistema para o gerador.\n");
+        return CLI_ERROR;
+    }
+    if (command < argc)
+        return run_command(argc, argv, command);
+
     do
     {
         printf("\n\n===== ASSINATURA DIGITAL RSA - MENU PRINCIPAL =====\n");
@@ -1063,6 +2809,15 @@ int main()
         printf("2. Assinar arquivo\n");
         printf("3. Verificar assinatura\n");
         printf("4. Extrair mensagem original (arquivo .txt)\n");
+        printf("5. Benchmark de verificação (e = 65537)\n");
+        printf("6. Converter chave (hexadecimal <-> binário)\n");
+        printf("7. Assinar arquivos em lote\n");
+        printf("8. Benchmark de assinatura em lote (GMP vs. AVX-512 IFMA)\n");
+        printf("9. Benchmark de geração de primos\n");
+        printf("10. Pool de chaves pré-geradas\n");
+        printf("11. Benchmark por tamanho de chave\n");
+        printf("12. Assinatura remota por digest\n");
+        printf("13. Manifesto Merkle de diretório\n");
         printf("0. Sair\n");
         printf("Escolha uma opção: ");
 
@@ -1093,6 +2848,33 @@ int main()
         case 4:
             extract_message_menu();
             break;
+        case 5:
+            benchmark_verify_menu();
+            break;
+        case 6:
+            convert_key_menu();
+            break;
+        case 7:
+            batch_sign_menu();
+            break;
+        case 8:
+            benchmark_batch_sign_menu();
+            break;
+        case 9:
+            benchmark_prime_menu();
+            break;
+        case 10:
+            keypool_menu();
+            break;
+        case 11:
+            benchmark_key_sizes_menu();
+            break;
+        case 12:
+            remote_sign_menu();
+            break;
+        case 13:
+            manifest_menu();
+            break;
         case 0:
             printf("Saindo do programa...\n");
             break;
@@ -1104,5 +2886,6 @@ int main()
         }
     } while (choice != 0);
 
+    keypool_stop(&key_pool);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,6114 @@
+/**
+ * @file rsa_sign.c
+ * @brief Núcleo criptográfico da librsa_sign: SHA3-256/SHAKE256, Base64, DRBG,
+ *        geração de chaves, RSA-OAEP, assinatura, verificação e formatos de arquivo.
+ *
+ * O código utiliza a biblioteca GMP para aritmética de múltiplos precisão e implementa
+ * SHA3-256 e SHAKE256 do zero. As primitivas criptográficas de geração de chaves
+ * e cifração/decifração RSA-OAEP foram implementadas do zero.
+ *
+ * A API está declarada em rsa_sign.h; compile como biblioteca estática ou
+ * compartilhada (ver README.md).
+ *
+ * Autor: Yan Tavares e Eduardo Marques
+ * Disciplina: CIC0201 - Segurança Computacional
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <gmp.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/random.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#include "rsa_sign.h"
+
+// --- Constantes ---
+const int key_sizes[KEY_SIZE_COUNT] = {2048, 3072, 4096, 8192};
+
+// Formato binário de chaves (todos os inteiros em big-endian)
+#define KEY_BIN_MAGIC "RSAK"
+#define KEY_BIN_VERSION 2
+#define KEY_BIN_HEADER_SIZE 72
+#define KEY_BIN_TYPE_PUBLIC 1
+#define KEY_BIN_TYPE_PRIVATE 2
+#define KEY_BIN_FLAG_CRT 0x0001
+#define KEY_BIN_MAX_LIMBS 256
+
+// Teste de primalidade usado na geração de primos
+primality_mode prime_test_mode = PRIMALITY_MILLER_RABIN;
+int prime_test_rounds = 0; // Rodadas de Miller-Rabin; 0 = tabela do FIPS 186-5
+int keygen_threads = 0;    // Threads na geração de primos; 0 = processadores online
+
+// --- Implementação Keccak do zero (SHA3-256 e SHAKE256) ---
+
+#define SHA3_DOMAIN 0x06  // Sufixo de domínio "01" do SHA3 seguido do primeiro bit do padding
+#define SHAKE_DOMAIN 0x1F // Sufixo de domínio "1111" do SHAKE seguido do primeiro bit do padding
+
+static const uint64_t keccak_round_constants[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+    0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+    0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+    0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+    0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+    0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+    0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+
+// Passos ρ e π combinados: a t-ésima lane visitada (a partir de A[1]) e a sua rotação
+static const int keccak_pi_lanes[24] = {10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
+                                        15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+static const int keccak_rho_offsets[24] = {1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
+                                           27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+
+/**
+ * @brief Rotaciona bits à esquerda (0 <= n < 64).
+ */
+static uint64_t rotl64(uint64_t x, int n)
+{
+    return (x << n) | (x >> ((64 - n) & 63));
+}
+
+/**
+ * @brief Permutação Keccak-f[1600] (24 rodadas) sobre o estado de 25 lanes.
+ *
+ * O estado é copiado para variáveis locais e os laços de 5 têm índices fixos,
+ * para que o compilador mantenha as lanes em registradores; ρ e π escrevem em
+ * B e χ lê de B, sem a cadeia serial de trocas do passo ρπ in-place.
+ */
+void keccak_f1600(uint64_t state[25])
+{
+    uint64_t A[25], B[25], C[5], D[5];
+    memcpy(A, state, sizeof(A));
+
+    for (int round = 0; round < 24; round++)
+    {
+        // θ (Theta)
+        for (int x = 0; x < 5; x++)
+        {
+            C[x] = A[x] ^ A[x + 5] ^ A[x + 10] ^ A[x + 15] ^ A[x + 20];
+        }
+        D[0] = C[4] ^ rotl64(C[1], 1);
+        D[1] = C[0] ^ rotl64(C[2], 1);
+        D[2] = C[1] ^ rotl64(C[3], 1);
+        D[3] = C[2] ^ rotl64(C[4], 1);
+        D[4] = C[3] ^ rotl64(C[0], 1);
+
+        // ρ (Rho) e π (Pi): a lane 0 não roda; as demais seguem a ordem de keccak_pi_lanes
+        B[0] = A[0] ^ D[0];
+        int source = 1;
+#pragma GCC unroll 24
+        for (int t = 0; t < 24; t++)
+        {
+            int lane = keccak_pi_lanes[t];
+            B[lane] = rotl64(A[source] ^ D[source % 5], keccak_rho_offsets[t]);
+            source = lane;
+        }
+
+        // χ (Chi)
+#pragma GCC unroll 5
+        for (int y = 0; y < 25; y += 5)
+        {
+            A[y + 0] = B[y + 0] ^ (~B[y + 1] & B[y + 2]);
+            A[y + 1] = B[y + 1] ^ (~B[y + 2] & B[y + 3]);
+            A[y + 2] = B[y + 2] ^ (~B[y + 3] & B[y + 4]);
+            A[y + 3] = B[y + 3] ^ (~B[y + 4] & B[y + 0]);
+            A[y + 4] = B[y + 4] ^ (~B[y + 0] & B[y + 1]);
+        }
+
+        // ι (Iota)
+        A[0] ^= keccak_round_constants[round];
+    }
+
+    memcpy(state, A, sizeof(A));
+}
+
+/**
+ * @brief Inicializa uma esponja vazia.
+ * @param sponge Esponja.
+ * @param rate Taxa em bytes (múltiplo de 8, menor que 200).
+ * @param domain SHA3_DOMAIN ou SHAKE_DOMAIN.
+ */
+void keccak_init(keccak_sponge *sponge, size_t rate, unsigned char domain)
+{
+    memset(sponge->state, 0, sizeof(sponge->state));
+    sponge->rate = rate;
+    sponge->pos = 0;
+    sponge->domain = domain;
+}
+
+/**
+ * @brief Absorve dados na esponja (lanes inteiras quando alinhado, byte a byte nas bordas).
+ */
+void keccak_absorb(keccak_sponge *sponge, const unsigned char *data, size_t len)
+{
+    while (len > 0)
+    {
+        if (sponge->pos % 8 == 0 && len >= 8)
+        {
+            uint64_t word = 0;
+            for (int k = 0; k < 8; k++)
+            {
+                word |= (uint64_t)data[k] << (8 * k);
+            }
+            sponge->state[sponge->pos / 8] ^= word;
+            sponge->pos += 8;
+            data += 8;
+            len -= 8;
+        }
+        else
+        {
+            sponge->state[sponge->pos / 8] ^= (uint64_t)*data << (8 * (sponge->pos % 8));
+            sponge->pos++;
+            data++;
+            len--;
+        }
+
+        if (sponge->pos == sponge->rate)
+        {
+            keccak_f1600(sponge->state);
+            sponge->pos = 0;
+        }
+    }
+}
+
+/**
+ * @brief Aplica o sufixo de domínio e o padding 10*1 e passa para a fase de extração.
+ *
+ * O padding vai direto no estado, então não há buffer extra nem caso especial
+ * quando sobra exatamente um byte no bloco (0x06 e 0x80 caem no mesmo byte).
+ */
+void keccak_finalize(keccak_sponge *sponge)
+{
+    sponge->state[sponge->pos / 8] ^= (uint64_t)sponge->domain << (8 * (sponge->pos % 8));
+    sponge->state[(sponge->rate - 1) / 8] ^= 0x80ULL << (8 * ((sponge->rate - 1) % 8));
+    keccak_f1600(sponge->state);
+    sponge->pos = 0;
+}
+
+/**
+ * @brief Extrai bytes de uma esponja finalizada; chamadas seguidas continuam o mesmo fluxo.
+ */
+void keccak_squeeze(keccak_sponge *sponge, unsigned char *out, size_t len)
+{
+    while (len > 0)
+    {
+        if (sponge->pos == sponge->rate)
+        {
+            keccak_f1600(sponge->state);
+            sponge->pos = 0;
+        }
+
+        if (sponge->pos % 8 == 0 && len >= 8)
+        {
+            uint64_t word = sponge->state[sponge->pos / 8];
+            for (int k = 0; k < 8; k++)
+            {
+                out[k] = (word >> (8 * k)) & 0xFF;
+            }
+            sponge->pos += 8;
+            out += 8;
+            len -= 8;
+        }
+        else
+        {
+            *out = (sponge->state[sponge->pos / 8] >> (8 * (sponge->pos % 8))) & 0xFF;
+            sponge->pos++;
+            out++;
+            len--;
+        }
+    }
+}
+
+/**
+ * @brief Implementação da função SHA3-256 (FIPS 202).
+ * @param input Dados de entrada.
+ * @param input_len Comprimento dos dados.
+ * @param output Buffer para o hash (32 bytes).
+ */
+void sha3_256(const unsigned char *input, size_t input_len, unsigned char *output)
+{
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHA3_DOMAIN);
+    keccak_absorb(&sponge, input, input_len);
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, output, SHA3_256_DIGEST_SIZE);
+}
+
+/**
+ * @brief SHA3-256 de um fluxo lido até o fim (arquivo ou entrada padrão), em blocos.
+ * @param f Fluxo aberto para leitura.
+ * @param output Buffer para o hash (32 bytes).
+ * @return 1 em sucesso, 0 em erro de leitura.
+ */
+int sha3_256_stream(FILE *f, unsigned char *output)
+{
+    unsigned char chunk[64 * SHA3_256_RATE];
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHA3_DOMAIN);
+
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        keccak_absorb(&sponge, chunk, got);
+    if (ferror(f))
+        return 0;
+
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, output, SHA3_256_DIGEST_SIZE);
+    return 1;
+}
+
+/**
+ * @brief Implementação da função de saída extensível SHAKE256 (FIPS 202).
+ * @param input Dados de entrada.
+ * @param input_len Comprimento dos dados.
+ * @param output Buffer de saída.
+ * @param output_len Quantidade de bytes a extrair.
+ */
+void shake256(const unsigned char *input, size_t input_len, unsigned char *output, size_t output_len)
+{
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHAKE_DOMAIN);
+    keccak_absorb(&sponge, input, input_len);
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, output, output_len);
+}
+
+// --- Gerador determinístico (DRBG) com SHAKE256 ---
+//
+// Todo o aleatório da geração de chaves (pontos de partida dos primos, bases do
+// Miller-Rabin, sementes das threads) e as sementes do OAEP saem de um DRBG:
+// SHAKE256 absorve um rótulo e a semente, e a saída é extraída em fluxo. Em
+// produção a semente vem do getrandom; nos benchmarks, de um valor fixo, de modo
+// que estratégias diferentes percorrem exatamente os mesmos candidatos.
+
+#define DRBG_SEED_BYTES 48                     // Entropia lida do sistema (384 bits)
+#define DRBG_LABEL "segcomp-rsa-drbg-shake256" // Separação de domínio da semente
+#define DRBG_RESEED_BYTES (1UL << 20)          // Produção: nova entropia do sistema a cada 1 MiB
+
+static _Thread_local drbg thread_rng_state; // Gerador de produção da thread
+static _Thread_local int thread_rng_ready;
+
+/**
+ * @brief Semeia o gerador com uma sequência de bytes.
+ */
+void drbg_seed(drbg *rng, const unsigned char *seed, size_t seed_len)
+{
+    keccak_init(&rng->sponge, SHA3_256_RATE, SHAKE_DOMAIN);
+    keccak_absorb(&rng->sponge, (const unsigned char *)DRBG_LABEL, sizeof(DRBG_LABEL) - 1);
+    keccak_absorb(&rng->sponge, seed, seed_len);
+    keccak_finalize(&rng->sponge);
+    memset(rng->buffer, 0, sizeof(rng->buffer));
+    rng->available = 0;
+    rng->reseed_left = 0;
+}
+
+/**
+ * @brief Semeia o gerador com um inteiro (modo benchmark: fluxo reprodutível).
+ */
+void drbg_seed_ui(drbg *rng, unsigned long seed)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (seed >> (8 * i)) & 0xFF;
+    drbg_seed(rng, bytes, sizeof(bytes));
+}
+
+/**
+ * @brief Lê bytes do gerador de entropia do sistema (getrandom no Linux, /dev/urandom nos demais).
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int system_entropy(unsigned char *out, size_t len)
+{
+#ifdef __linux__
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t got = getrandom(out + done, len - done, 0);
+        if (got < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        done += got;
+    }
+    if (done == len)
+        return 1;
+#endif
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (!f)
+        return 0;
+    size_t got = fread(out, 1, len, f);
+    fclose(f);
+    return got == len;
+}
+
+/**
+ * @brief Semeia o gerador com entropia do sistema (modo de produção, com reseed periódico).
+ * @return 1 em sucesso, 0 se não houver fonte de entropia.
+ */
+int drbg_seed_system(drbg *rng)
+{
+    unsigned char seed[DRBG_SEED_BYTES];
+    if (!system_entropy(seed, sizeof(seed)))
+        return 0;
+    drbg_seed(rng, seed, sizeof(seed));
+    rng->reseed_left = DRBG_RESEED_BYTES;
+    memset(seed, 0, sizeof(seed));
+    return 1;
+}
+
+/**
+ * @brief Reabastece o buffer com blocos novos do SHAKE256.
+ *
+ * No modo de produção, quando o limite de bytes acaba, o estado atual é
+ * resumido em 64 bytes e reabsorvido junto com entropia nova do sistema. Se o
+ * sistema falhar, o gerador segue com o estado atual e tenta no próximo bloco.
+ */
+static void drbg_refill(drbg *rng)
+{
+    if (rng->reseed_left && rng->reseed_left <= DRBG_BUFFER_BYTES)
+    {
+        unsigned char material[64 + DRBG_SEED_BYTES];
+        keccak_squeeze(&rng->sponge, material, 64);
+        if (system_entropy(material + 64, DRBG_SEED_BYTES))
+        {
+            drbg_seed(rng, material, sizeof(material));
+            rng->reseed_left = DRBG_RESEED_BYTES;
+        }
+        else
+        {
+            drbg_seed(rng, material, 64);
+            rng->reseed_left = DRBG_BUFFER_BYTES + 1; // Tenta de novo no próximo reabastecimento
+        }
+        memset(material, 0, sizeof(material));
+    }
+    else if (rng->reseed_left)
+    {
+        rng->reseed_left -= DRBG_BUFFER_BYTES;
+    }
+
+    keccak_squeeze(&rng->sponge, rng->buffer, DRBG_BUFFER_BYTES);
+    rng->available = DRBG_BUFFER_BYTES;
+}
+
+/**
+ * @brief Extrai len bytes do gerador (memcpy do buffer, que é reabastecido quando esvazia).
+ */
+void drbg_bytes(drbg *rng, unsigned char *out, size_t len)
+{
+    while (len > 0)
+    {
+        if (rng->available == 0)
+            drbg_refill(rng);
+        size_t n = len < rng->available ? len : rng->available;
+        unsigned char *src = rng->buffer + DRBG_BUFFER_BYTES - rng->available;
+        memcpy(out, src, n);
+        memset(src, 0, n); // Saída entregue não fica para trás no buffer
+        rng->available -= n;
+        out += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Semeia child com bytes extraídos de parent (fluxos independentes por thread).
+ */
+void drbg_fork(drbg *child, drbg *parent)
+{
+    unsigned char seed[DRBG_SEED_BYTES];
+    drbg_bytes(parent, seed, sizeof(seed));
+    drbg_seed(child, seed, sizeof(seed));
+    memset(seed, 0, sizeof(seed));
+}
+
+/**
+ * @brief Gerador de produção da thread atual, semeado com getrandom no primeiro uso.
+ *
+ * Cada thread tem o seu, então OAEP e geração de chaves nunca disputam um lock.
+ *
+ * @return Ponteiro para o gerador, ou NULL se não houver fonte de entropia.
+ */
+drbg *thread_rng()
+{
+    if (!thread_rng_ready)
+    {
+        if (!drbg_seed_system(&thread_rng_state))
+            return NULL;
+        thread_rng_ready = 1;
+    }
+    return &thread_rng_state;
+}
+
+/**
+ * @brief Apaga o gerador de produção da thread atual (chamar antes de a thread terminar).
+ */
+void thread_rng_release()
+{
+    memset(&thread_rng_state, 0, sizeof(thread_rng_state));
+    thread_rng_ready = 0;
+}
+
+/**
+ * @brief Sorteia r uniforme em [0, 2^bits), como mpz_urandomb.
+ *
+ * Os limbs são preenchidos direto do fluxo (little-endian), sem temporários.
+ */
+void drbg_urandomb(mpz_t r, drbg *rng, mp_bitcnt_t bits)
+{
+    mp_size_t nl = (bits + GMP_NUMB_BITS - 1) / GMP_NUMB_BITS;
+    if (nl == 0)
+    {
+        mpz_set_ui(r, 0);
+        return;
+    }
+
+    mp_limb_t *limbs = mpz_limbs_write(r, nl);
+    unsigned char bytes[sizeof(mp_limb_t)];
+    for (mp_size_t i = 0; i < nl; i++)
+    {
+        drbg_bytes(rng, bytes, sizeof(bytes));
+        mp_limb_t limb = 0;
+        for (size_t k = 0; k < sizeof(bytes); k++)
+            limb |= (mp_limb_t)bytes[k] << (8 * k);
+        limbs[i] = limb;
+    }
+    if (bits % GMP_NUMB_BITS)
+        limbs[nl - 1] &= ((mp_limb_t)1 << (bits % GMP_NUMB_BITS)) - 1;
+    mpz_limbs_finish(r, nl);
+}
+
+/**
+ * @brief Sorteia r uniforme em [0, n), como mpz_urandomm (rejeição; r não pode ser n).
+ */
+void drbg_urandomm(mpz_t r, drbg *rng, const mpz_t n)
+{
+    mp_bitcnt_t bits = mpz_sizeinbase(n, 2);
+    do
+    {
+        drbg_urandomb(r, rng, bits);
+    } while (mpz_cmp(r, n) >= 0);
+}
+
+// --- Funções de Base64 (Implementação auto-contida) ---
+
+static const char b64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * @brief Codifica dados em Base64.
+ * @param src Ponteiro para os dados de origem.
+ * @param src_len Comprimento dos dados de origem.
+ * @param out_len Ponteiro para armazenar o comprimento da saída.
+ * @return Ponteiro para a string Base64 alocada (deve ser liberada).
+ */
+char *base64_encode(const unsigned char *src, size_t src_len, size_t *out_len)
+{
+    *out_len = 4 * ((src_len + 2) / 3);
+    char *encoded_data = malloc(*out_len + 1);
+    if (encoded_data == NULL)
+        return NULL;
+
+    for (size_t i = 0, j = 0; i < src_len;)
+    {
+        uint32_t octet_a = i < src_len ? (unsigned char)src[i++] : 0;
+        uint32_t octet_b = i < src_len ? (unsigned char)src[i++] : 0;
+        uint32_t octet_c = i < src_len ? (unsigned char)src[i++] : 0;
+        uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
+        encoded_data[j++] = b64_table[(triple >> 3 * 6) & 0x3F];
+        encoded_data[j++] = b64_table[(triple >> 2 * 6) & 0x3F];
+        encoded_data[j++] = b64_table[(triple >> 1 * 6) & 0x3F];
+        encoded_data[j++] = b64_table[(triple >> 0 * 6) & 0x3F];
+    }
+
+    int mod_table[] = {0, 2, 1};
+    for (int i = 0; i < mod_table[src_len % 3]; i++)
+    {
+        encoded_data[*out_len - 1 - i] = '=';
+    }
+    encoded_data[*out_len] = '\0';
+    return encoded_data;
+}
+
+/**
+ * @brief Decodifica uma string Base64.
+ * @param src Ponteiro para a string Base64.
+ * @param src_len Comprimento da string Base64.
+ * @param out_len Ponteiro para armazenar o comprimento dos dados decodificados.
+ * @return Ponteiro para os dados decodificados (deve ser liberado).
+ */
+unsigned char *base64_decode(const char *src, size_t src_len, size_t *out_len)
+{
+    unsigned char dtable[256];
+    memset(dtable, 0x80, 256);
+    for (int i = 0; i < 64; i++)
+        dtable[(unsigned char)b64_table[i]] = i;
+
+    if (src_len % 4 != 0)
+        return NULL;
+    *out_len = src_len / 4 * 3;
+    if (src[src_len - 1] == '=')
+        (*out_len)--;
+    if (src[src_len - 2] == '=')
+        (*out_len)--;
+
+    unsigned char *decoded_data = malloc(*out_len);
+    if (decoded_data == NULL)
+        return NULL;
+
+    for (size_t i = 0, j = 0; i < src_len;)
+    {
+        uint32_t sextet_a = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
+        uint32_t sextet_b = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
+        uint32_t sextet_c = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
+        uint32_t sextet_d = src[i] == '=' ? 0 & i++ : dtable[(unsigned char)src[i++]];
+        uint32_t triple = (sextet_a << 3 * 6) + (sextet_b << 2 * 6) + (sextet_c << 1 * 6) + (sextet_d << 0 * 6);
+        if (j < *out_len)
+            decoded_data[j++] = (triple >> 2 * 8) & 0xFF;
+        if (j < *out_len)
+            decoded_data[j++] = (triple >> 1 * 8) & 0xFF;
+        if (j < *out_len)
+            decoded_data[j++] = (triple >> 0 * 8) & 0xFF;
+    }
+    return decoded_data;
+}
+
+// --- Alocador em arena (GMP e buffers temporários) ---
+
+#define ARENA_BLOCK_SIZE (256 * 1024)   // Tamanho mínimo de um bloco da arena
+#define ARENA_MAX_ALLOC (4 * 1024 * 1024) // Alocações maiores vão direto para o malloc
+#define ARENA_ALIGN 16
+
+typedef struct arena_block
+{
+    struct arena_block *next; // Bloco anterior (lista encadeada)
+    size_t size;              // Capacidade de data
+    size_t used;              // Bytes já entregues
+    size_t last;              // Deslocamento da última alocação (para realloc/free no topo)
+    _Alignas(ARENA_ALIGN) unsigned char data[];
+} arena_block;
+
+/**
+ * @brief Arena por thread: lista de blocos e profundidade de escopos ativos.
+ */
+typedef struct
+{
+    arena_block *head; // Bloco atual (os anteriores seguem por next)
+    int depth;         // Número de arena_begin sem arena_end correspondente
+} arena;
+
+static _Thread_local arena thread_arena;
+
+/**
+ * @brief Verifica se p pertence a algum bloco da arena da thread.
+ */
+static arena_block *arena_owner(const void *p)
+{
+    for (arena_block *b = thread_arena.head; b; b = b->next)
+    {
+        if ((const unsigned char *)p >= b->data && (const unsigned char *)p < b->data + b->size)
+            return b;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Inicia um escopo de operação: as alocações passam a vir da arena.
+ *
+ * Os escopos podem ser aninhados; a arena só é reiniciada quando o mais externo
+ * termina. Nenhum ponteiro obtido dentro do escopo (inclusive limbs de mpz_t
+ * inicializados ou alocados pela primeira vez dentro dele) pode sobreviver a ele.
+ */
+void arena_begin()
+{
+    thread_arena.depth++;
+}
+
+/**
+ * @brief Termina um escopo de operação, reiniciando a arena no mais externo.
+ *
+ * Se a operação precisou de mais de um bloco, os blocos são substituídos por um
+ * único bloco com a capacidade somada, para que a próxima operação não aloque.
+ */
+void arena_end()
+{
+    if (--thread_arena.depth > 0)
+        return;
+
+    arena_block *head = thread_arena.head;
+    if (head && head->next)
+    {
+        size_t total = 0;
+        while (head)
+        {
+            arena_block *next = head->next;
+            total += head->size;
+            free(head);
+            head = next;
+        }
+        head = malloc(sizeof(arena_block) + total);
+        if (head)
+        {
+            head->next = NULL;
+            head->size = total;
+        }
+        thread_arena.head = head;
+    }
+    if (head)
+    {
+        head->used = 0;
+        head->last = 0;
+    }
+}
+
+/**
+ * @brief Aloca size bytes da arena da thread (ou do malloc fora de um escopo).
+ */
+void *arena_alloc(size_t size)
+{
+    if (thread_arena.depth == 0 || size > ARENA_MAX_ALLOC)
+        return malloc(size);
+
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    arena_block *b = thread_arena.head;
+    if (!b || b->size - b->used < aligned)
+    {
+        size_t block_size = aligned > ARENA_BLOCK_SIZE ? aligned : ARENA_BLOCK_SIZE;
+        arena_block *nb = malloc(sizeof(arena_block) + block_size);
+        if (!nb)
+            return NULL;
+        nb->next = b;
+        nb->size = block_size;
+        nb->used = 0;
+        nb->last = 0;
+        thread_arena.head = b = nb;
+    }
+
+    void *p = b->data + b->used;
+    b->last = b->used;
+    b->used += aligned;
+    return p;
+}
+
+/**
+ * @brief Libera p. Na arena, só a última alocação do bloco atual é devolvida;
+ * as demais são recuperadas em bloco no fim do escopo.
+ */
+void arena_free(void *p, size_t size)
+{
+    (void)size;
+    if (!p)
+        return;
+
+    arena_block *b = arena_owner(p);
+    if (!b)
+    {
+        free(p);
+        return;
+    }
+    if (b == thread_arena.head && (unsigned char *)p == b->data + b->last)
+        b->used = b->last;
+}
+
+/**
+ * @brief Redimensiona p, crescendo no lugar quando p é a última alocação da arena.
+ */
+void *arena_realloc(void *p, size_t old_size, size_t new_size)
+{
+    if (!p)
+        return arena_alloc(new_size);
+
+    arena_block *b = arena_owner(p);
+    if (!b)
+        return realloc(p, new_size); // Ponteiros de fora da arena continuam fora dela
+
+    size_t aligned = (new_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (b == thread_arena.head && (unsigned char *)p == b->data + b->last && b->last + aligned <= b->size)
+    {
+        b->used = b->last + aligned;
+        return p;
+    }
+
+    void *np = arena_alloc(new_size);
+    if (np)
+        memcpy(np, p, old_size < new_size ? old_size : new_size);
+    return np;
+}
+
+/**
+ * @brief Instala a arena como alocador do GMP.
+ */
+void arena_install_gmp()
+{
+    mp_set_memory_functions(arena_alloc, arena_realloc, arena_free);
+}
+
+// --- Aritmética de Montgomery (nível mpn) ---
+
+/**
+ * @brief Aloca os buffers de limbs de um contexto de Montgomery.
+ * @param ctx Contexto a ser alocado.
+ * @param nl Número de limbs do módulo.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int mont_ctx_alloc(mont_ctx *ctx, mp_size_t nl)
+{
+    mp_limb_t *limbs = calloc(2 * nl, sizeof(mp_limb_t));
+    if (!limbs)
+        return 0;
+
+    ctx->nlimbs = nl;
+    ctx->n = limbs;
+    ctx->r2 = limbs + nl;
+    return 1;
+}
+
+/**
+ * @brief Calcula -n0^(-1) mod 2^GMP_NUMB_BITS para o limb menos significativo (ímpar) de n.
+ */
+static mp_limb_t mont_n0inv(mp_limb_t n0)
+{
+    // Inversa por Newton: cada passo dobra os bits corretos
+    mp_limb_t inv = n0; // Correta em 3 bits, pois n0 é ímpar
+    for (int i = 0; i < 5; i++)
+        inv *= 2 - n0 * inv;
+    return -inv;
+}
+
+/**
+ * @brief Inicializa um contexto de Montgomery para o módulo n (ímpar).
+ * @param ctx Contexto a ser inicializado.
+ * @param n Módulo.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int mont_ctx_init(mont_ctx *ctx, const mpz_t n)
+{
+    if (mpz_sgn(n) <= 0 || mpz_even_p(n))
+        return 0;
+
+    mp_size_t nl = mpz_size(n);
+    if (!mont_ctx_alloc(ctx, nl))
+        return 0;
+
+    for (mp_size_t i = 0; i < nl; i++)
+        ctx->n[i] = mpz_getlimbn(n, i);
+    ctx->n0inv = mont_n0inv(ctx->n[0]);
+
+    // R^2 mod n é calculado uma única vez, aqui
+    mpz_t r2;
+    mpz_init(r2);
+    mpz_setbit(r2, 2 * GMP_NUMB_BITS * nl);
+    mpz_mod(r2, r2, n);
+    for (mp_size_t i = 0; i < nl; i++)
+        ctx->r2[i] = mpz_getlimbn(r2, i);
+    mpz_clear(r2);
+
+    return 1;
+}
+
+/**
+ * @brief Libera os buffers de um contexto de Montgomery.
+ */
+void mont_ctx_clear(mont_ctx *ctx)
+{
+    free(ctx->n);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+/**
+ * @brief Redução de Montgomery: r = t * R^(-1) mod n.
+ *
+ * Destrói t (2 * nlimbs limbs). Para t < n * R o resultado fica em [0, n).
+ */
+static void mont_redc(const mont_ctx *ctx, mp_limb_t *r, mp_limb_t *t)
+{
+    mp_size_t nl = ctx->nlimbs;
+
+    // Cada passo zera t[i]; o carry da linha é guardado no próprio t[i]
+    for (mp_size_t i = 0; i < nl; i++)
+    {
+        mp_limb_t q = t[i] * ctx->n0inv;
+        t[i] = mpn_addmul_1(t + i, ctx->n, nl, q);
+    }
+
+    mp_limb_t cy = mpn_add_n(r, t + nl, t, nl);
+    if (cy || mpn_cmp(r, ctx->n, nl) >= 0)
+        mpn_sub_n(r, r, ctx->n, nl);
+}
+
+/**
+ * @brief Multiplicação de Montgomery: r = a * b * R^(-1) mod n.
+ *
+ * t é o rascunho do produto, com 2 * nlimbs limbs.
+ */
+static void mont_mul(const mont_ctx *ctx, mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b, mp_limb_t *t)
+{
+    if (a == b)
+        mpn_sqr(t, a, ctx->nlimbs);
+    else
+        mpn_mul_n(t, a, b, ctx->nlimbs);
+    mont_redc(ctx, r, t);
+}
+
+/**
+ * @brief Verificação RSA com o expoente fixo e = 65537 (s^e mod n).
+ *
+ * Como 65537 = 2^16 + 1, a exponenciação é feita com 16 quadrados e uma
+ * multiplicação no domínio de Montgomery. A última multiplicação usa a base
+ * fora do domínio, o que já devolve o resultado convertido de volta. O contexto
+ * só é lido; os rascunhos vêm da arena da thread, de modo que uma mesma chave
+ * pode ser verificada por várias threads ao mesmo tempo.
+ *
+ * @param ctx Contexto de Montgomery da chave pública.
+ * @param sig Assinatura (big-endian).
+ * @param sig_len Comprimento da assinatura.
+ * @param out Buffer de saída com k bytes (big-endian, zeros à esquerda).
+ * @param k Tamanho do módulo em bytes.
+ * @return 1 em sucesso, 0 se a assinatura não for menor que n (ou em falha de alocação).
+ */
+int rsa_verify_e65537(const mont_ctx *ctx, const unsigned char *sig, size_t sig_len, unsigned char *out, size_t k)
+{
+    mp_size_t nl = ctx->nlimbs;
+    size_t limb_bytes = sizeof(mp_limb_t);
+
+    if (sig_len > nl * limb_bytes || k > nl * limb_bytes)
+        return 0;
+
+    // Rascunhos da chamada: operando, acumulador e produto (2 * nl)
+    size_t scratch_size = 4 * nl * limb_bytes;
+    mp_limb_t *x = arena_alloc(scratch_size);
+    if (!x)
+        return 0;
+    mp_limb_t *acc = x + nl;
+    mp_limb_t *t = x + 2 * nl;
+
+    // Importa os bytes big-endian para limbs little-endian
+    memset(x, 0, nl * limb_bytes);
+    for (size_t i = 0; i < sig_len; i++)
+    {
+        size_t pos = sig_len - 1 - i;
+        x[i / limb_bytes] |= (mp_limb_t)sig[pos] << (8 * (i % limb_bytes));
+    }
+    int ok = mpn_cmp(x, ctx->n, nl) < 0;
+    if (ok)
+    {
+        mont_mul(ctx, acc, x, ctx->r2, t); // acc = s * R
+        for (int i = 0; i < 16; i++)
+            mont_mul(ctx, acc, acc, acc, t); // acc = s^(2^16) * R
+        mont_mul(ctx, acc, acc, x, t);       // acc = s^(2^16 + 1)
+
+        // Exporta em exatamente k bytes big-endian
+        for (size_t i = 0; i < k; i++)
+        {
+            out[k - 1 - i] = (acc[i / limb_bytes] >> (8 * (i % limb_bytes))) & 0xFF;
+        }
+    }
+    arena_free(x, scratch_size);
+    return ok;
+}
+
+// --- Exponenciação multi-buffer com AVX-512 IFMA ---
+//
+// Para assinar em lote com uma mesma chave, oito exponenciações CRT
+// independentes (mesmo módulo e mesmo expoente) são executadas nas oito
+// lanes de 64 bits de um registrador AVX-512, com limbs de 52 bits e as
+// multiplicações vpmadd52luq/vpmadd52huq. Quando o processador não
+// suporta IFMA, o lote é assinado pelo caminho do GMP.
+
+#define MB_LIMB_BITS 52
+#define MB_LIMB_MASK ((1ULL << MB_LIMB_BITS) - 1)
+#define MB_MAX_LIMBS 80 // Suficiente para metades CRT de chaves de até 8192 bits
+#define MB_WINDOW 5     // Janela fixa da exponenciação
+
+/**
+ * @brief Módulo preparado para a exponenciação multi-buffer (limbs de 52 bits).
+ */
+typedef struct
+{
+    int nlimbs;                 // L, com 52 * L >= bits(m) + 2, o que garante 4m < R
+    uint64_t k0;                // -m^(-1) mod 2^52
+    uint64_t m[MB_MAX_LIMBS];   // Módulo
+    uint64_t r2[MB_MAX_LIMBS];  // R^2 mod m, com R = 2^(52 * L)
+    uint64_t one[MB_MAX_LIMBS]; // R mod m (1 no domínio de Montgomery)
+} mb_modulus;
+
+/**
+ * @brief Converte z (0 <= z < 2^(52 * L)) para L limbs de 52 bits.
+ */
+static void mb_from_mpz(uint64_t *out, const mpz_t z, int L)
+{
+    for (int j = 0; j < L; j++)
+    {
+        size_t bit = (size_t)j * MB_LIMB_BITS;
+        size_t w = bit / GMP_NUMB_BITS;
+        int shift = bit % GMP_NUMB_BITS;
+        uint64_t v = mpz_getlimbn(z, w) >> shift;
+        if (shift > GMP_NUMB_BITS - MB_LIMB_BITS)
+            v |= (uint64_t)mpz_getlimbn(z, w + 1) << (GMP_NUMB_BITS - shift);
+        out[j] = v & MB_LIMB_MASK;
+    }
+}
+
+/**
+ * @brief Converte L limbs de 52 bits (lidos com passo stride) para z.
+ */
+static void mb_to_mpz(mpz_t z, const uint64_t *in, int L, int stride)
+{
+    mpz_set_ui(z, 0);
+    for (int j = L - 1; j >= 0; j--)
+    {
+        mpz_mul_2exp(z, z, MB_LIMB_BITS);
+        mpz_add_ui(z, z, in[j * stride]);
+    }
+}
+
+/**
+ * @brief Prepara um módulo ímpar para a exponenciação multi-buffer.
+ * @return 1 em sucesso, 0 se o módulo for grande demais.
+ */
+static int mb_modulus_init(mb_modulus *mod, const mpz_t m)
+{
+    int L = (mpz_sizeinbase(m, 2) + 2 + MB_LIMB_BITS - 1) / MB_LIMB_BITS;
+    if (L > MB_MAX_LIMBS || mpz_even_p(m))
+        return 0;
+
+    mod->nlimbs = L;
+    mod->k0 = mont_n0inv(mpz_getlimbn(m, 0)) & MB_LIMB_MASK;
+    mb_from_mpz(mod->m, m, L);
+
+    mpz_t t;
+    mpz_init(t);
+    mpz_setbit(t, 2 * MB_LIMB_BITS * L);
+    mpz_mod(t, t, m);
+    mb_from_mpz(mod->r2, t, L);
+    mpz_set_ui(t, 0);
+    mpz_setbit(t, MB_LIMB_BITS * L);
+    mpz_mod(t, t, m);
+    mb_from_mpz(mod->one, t, L);
+    mpz_clear(t);
+    return 1;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define MB_IFMA_BUILD 1
+
+/**
+ * @brief Multiplicação de Montgomery "quase" reduzida em 8 lanes: r = a * b / R.
+ *
+ * Com a, b < 2m e 4m < R, o resultado também fica abaixo de 2m, de modo que a
+ * subtração final é dispensada entre as multiplicações. Os produtos são
+ * acumulados sem normalizar em t (2L vetores): cada posição recebe no máximo
+ * 4L parcelas de 52 bits, o que cabe em 64 bits para L <= MB_MAX_LIMBS.
+ */
+__attribute__((target("avx512f,avx512ifma"))) static void mb_amm(__m512i *r, const __m512i *a, const __m512i *b,
+                                                                 const __m512i *m, __m512i k0, int L, __m512i *t)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i mask = _mm512_set1_epi64(MB_LIMB_MASK);
+
+    for (int j = 0; j < 2 * L; j++)
+        t[j] = zero;
+
+    for (int i = 0; i < L; i++)
+    {
+        __m512i *ti = t + i; // Deslocar a janela substitui a divisão por 2^52
+        __m512i ai = a[i];
+        for (int j = 0; j < L; j++)
+        {
+            ti[j] = _mm512_madd52lo_epu64(ti[j], ai, b[j]);
+            ti[j + 1] = _mm512_madd52hi_epu64(ti[j + 1], ai, b[j]);
+        }
+
+        __m512i q = _mm512_madd52lo_epu64(zero, ti[0], k0);
+        for (int j = 0; j < L; j++)
+        {
+            ti[j] = _mm512_madd52lo_epu64(ti[j], q, m[j]);
+            ti[j + 1] = _mm512_madd52hi_epu64(ti[j + 1], q, m[j]);
+        }
+        ti[1] = _mm512_add_epi64(ti[1], _mm512_srli_epi64(ti[0], MB_LIMB_BITS));
+    }
+
+    __m512i carry = zero;
+    for (int j = 0; j < L; j++)
+    {
+        __m512i v = _mm512_add_epi64(t[L + j], carry);
+        r[j] = _mm512_and_si512(v, mask);
+        carry = _mm512_srli_epi64(v, MB_LIMB_BITS);
+    }
+}
+
+/**
+ * @brief Exponenciação de 8 bases com o mesmo módulo e o mesmo expoente.
+ *
+ * Janela fixa de MB_WINDOW bits; a multiplicação pela tabela é sempre feita
+ * (inclusive por 1), de modo que a sequência de operações não depende dos bits
+ * do expoente além do seu tamanho.
+ *
+ * @param out Resultados (L vetores, valores em [0, m]).
+ * @param base Bases (L vetores, valores < m).
+ * @param exp Expoente compartilhado (> 0).
+ * @param mod Módulo preparado.
+ * @param work Área de trabalho com (2^MB_WINDOW + 6) * L vetores.
+ */
+__attribute__((target("avx512f,avx512ifma"))) static void mb_modexp(__m512i *out, const __m512i *base, const mpz_t exp,
+                                                                    const mb_modulus *mod, __m512i *work)
+{
+    int L = mod->nlimbs;
+    __m512i *m = work;
+    __m512i *r2 = m + L;
+    __m512i *acc = r2 + L;
+    __m512i *t = acc + L;        // 2L vetores
+    __m512i *table = t + 2 * L;  // 2^MB_WINDOW entradas
+    __m512i k0 = _mm512_set1_epi64(mod->k0);
+
+    for (int j = 0; j < L; j++)
+    {
+        m[j] = _mm512_set1_epi64(mod->m[j]);
+        r2[j] = _mm512_set1_epi64(mod->r2[j]);
+        table[j] = _mm512_set1_epi64(mod->one[j]);
+    }
+
+    // table[i] = base^i * R
+    mb_amm(table + L, base, r2, m, k0, L, t);
+    for (int i = 2; i < (1 << MB_WINDOW); i++)
+        mb_amm(table + i * L, table + (i - 1) * L, table + L, m, k0, L, t);
+
+    int bits = mpz_sizeinbase(exp, 2);
+    int pos = ((bits + MB_WINDOW - 1) / MB_WINDOW) * MB_WINDOW;
+    int first = 1;
+    while (pos > 0)
+    {
+        pos -= MB_WINDOW;
+        int w = 0;
+        for (int b = MB_WINDOW - 1; b >= 0; b--)
+            w = (w << 1) | mpz_tstbit(exp, pos + b);
+
+        if (first)
+        {
+            memcpy(acc, table + w * L, L * sizeof(__m512i));
+            first = 0;
+            continue;
+        }
+        for (int s = 0; s < MB_WINDOW; s++)
+            mb_amm(acc, acc, acc, m, k0, L, t);
+        mb_amm(acc, acc, table + w * L, m, k0, L, t);
+    }
+
+    // Sai do domínio de Montgomery multiplicando por 1
+    for (int j = 0; j < L; j++)
+        r2[j] = _mm512_setzero_si512();
+    r2[0] = _mm512_set1_epi64(1);
+    mb_amm(out, acc, r2, m, k0, L, t);
+}
+
+/**
+ * @brief Multiplicação de Montgomery "quase" reduzida de um único operando: r = a * b / R.
+ *
+ * Os limbs de 52 bits de cada operando ocupam as lanes de V vetores, e o laço
+ * percorre os limbs de b. A cada passo o acumulador recebe a * b[i] e q * m e
+ * desce um limb com valignq. Para tirar os vetores do caminho crítico:
+ *   - o limb 0 é mantido inteiro num escalar (produtos completos de 104 bits),
+ *     de onde sai q; a lane 0 do vetor é descartada;
+ *   - o limb 1 é lido antes das multiplicações por q, cujas parcelas nele
+ *     também são somadas no escalar;
+ *   - as metades altas usam cópias de a e m deslocadas uma lane para cima, de
+ *     modo que as quatro parcelas são somadas antes do deslocamento e os
+ *     produtos por b[i] não dependem do acumulador.
+ *
+ * @param r Resultado (8V limbs, normalizado em 52 bits, < 2m, zeros após o limb L - 1).
+ * @param a Operando (< 2m, 8V limbs com zeros após o limb L - 1).
+ * @param b Operando (< 2m).
+ * @param m Módulo (4m < 2^(52 * L), 8V limbs com zeros após o limb L - 1).
+ * @param k0 -m^(-1) mod 2^52.
+ * @param L Número de limbs de 52 bits (até MB_MAX_LIMBS); V = floor(L / 8) + 1.
+ */
+__attribute__((target("avx512f,avx512ifma"))) static void amm52_x1(uint64_t *r, const uint64_t *a, const uint64_t *b,
+                                                                   const uint64_t *m, uint64_t k0, int L)
+{
+    enum
+    {
+        MAX_VECTORS = MB_MAX_LIMBS / MB_LANES + 1
+    };
+    const __m512i zero = _mm512_setzero_si512();
+    int V = L / MB_LANES + 1; // Uma lane a mais para o limb L, que recebe a metade alta de a[L - 1] * b[i]
+    __m512i A[MAX_VECTORS], M[MAX_VECTORS], A_up[MAX_VECTORS], M_up[MAX_VECTORS], acc[MAX_VECTORS];
+
+    for (int v = 0; v < V; v++)
+    {
+        A[v] = _mm512_loadu_si512(a + v * MB_LANES);
+        M[v] = _mm512_loadu_si512(m + v * MB_LANES);
+        A_up[v] = _mm512_alignr_epi64(A[v], v ? A[v - 1] : zero, MB_LANES - 1);
+        M_up[v] = _mm512_alignr_epi64(M[v], v ? M[v - 1] : zero, MB_LANES - 1);
+        acc[v] = zero;
+    }
+
+    uint64_t low = 0; // Limb 0 do acumulador
+    for (int i = 0; i < L; i++)
+    {
+        uint64_t bi = b[i];
+        uint64_t next = _mm_extract_epi64(_mm512_castsi512_si128(acc[0]), 1);
+
+        unsigned __int128 t = low + (unsigned __int128)a[0] * bi;
+        uint64_t q = ((uint64_t)t * k0) & MB_LIMB_MASK;
+        t += (unsigned __int128)m[0] * q;
+        low = (uint64_t)(t >> MB_LIMB_BITS) + next + ((a[1] * bi) & MB_LIMB_MASK) + ((m[1] * q) & MB_LIMB_MASK);
+
+        __m512i bv = _mm512_set1_epi64(bi);
+        __m512i qv = _mm512_set1_epi64(q);
+        for (int v = 0; v < V; v++)
+        {
+            __m512i pa = _mm512_madd52lo_epu64(_mm512_madd52hi_epu64(zero, A_up[v], bv), A[v], bv);
+            __m512i pm = _mm512_madd52hi_epu64(_mm512_madd52lo_epu64(zero, M[v], qv), M_up[v], qv);
+            acc[v] = _mm512_add_epi64(acc[v], _mm512_add_epi64(pa, pm));
+        }
+
+        // O limb 0 já foi consumido pelo escalar: desce um limb
+        for (int v = 0; v < V - 1; v++)
+            acc[v] = _mm512_alignr_epi64(acc[v + 1], acc[v], 1);
+        acc[V - 1] = _mm512_alignr_epi64(zero, acc[V - 1], 1);
+    }
+
+    for (int v = 0; v < V; v++)
+        _mm512_storeu_si512(r + v * MB_LANES, acc[v]);
+    r[0] = low;
+    uint64_t carry = 0;
+    for (int j = 0; j < L; j++)
+    {
+        uint64_t v = r[j] + carry;
+        r[j] = v & MB_LIMB_MASK;
+        carry = v >> MB_LIMB_BITS;
+    }
+    memset(r + L, 0, (V * MB_LANES - L) * sizeof(uint64_t)); // Resultado < 2^(52 * L): nada sobra acima
+}
+
+/**
+ * @brief Verifica em tempo de execução se o processador suporta AVX-512 IFMA.
+ */
+int mb_ifma_available()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+}
+
+/**
+ * @brief Calcula base^exp mod m para até 8 bases com IFMA.
+ * @return 1 em sucesso, 0 se o módulo não for suportado.
+ */
+static int mb_powm_lanes(mpz_t *out, mpz_t *base, int count, const mpz_t exp, const mpz_t m)
+{
+    mb_modulus mod;
+    if (!mb_modulus_init(&mod, m))
+        return 0;
+
+    int L = mod.nlimbs;
+    size_t vectors = (size_t)L * 2 + ((1 << MB_WINDOW) + 6) * (size_t)L;
+    __m512i *buffer = aligned_alloc(64, vectors * sizeof(__m512i));
+    if (!buffer)
+        return 0;
+    __m512i *in = buffer;
+    __m512i *res = in + L;
+    uint64_t *in_lanes = (uint64_t *)in;
+    uint64_t limbs[MB_MAX_LIMBS];
+
+    memset(in, 0, L * sizeof(__m512i));
+    mpz_t r;
+    mpz_init(r);
+    for (int k = 0; k < count; k++)
+    {
+        mpz_mod(r, base[k], m);
+        mb_from_mpz(limbs, r, L);
+        for (int j = 0; j < L; j++)
+            in_lanes[j * MB_LANES + k] = limbs[j];
+    }
+
+    mb_modexp(res, in, exp, &mod, res + L);
+
+    for (int k = 0; k < count; k++)
+    {
+        mb_to_mpz(out[k], (uint64_t *)res + k, L, MB_LANES);
+        if (mpz_cmp(out[k], m) >= 0)
+            mpz_sub(out[k], out[k], m);
+    }
+    mpz_clear(r);
+    free(buffer);
+    return 1;
+}
+
+#else
+
+int mb_ifma_available()
+{
+    return 0;
+}
+
+#endif
+
+// --- Estatísticas da geração de chaves ---
+//
+// Cada thread conta em variáveis locais (sem atomics no laço quente) e, ao fim
+// de cada busca de primo, soma os contadores aos totais do processo sob um
+// mutex. A coleta só é consolidada com --stats.
+
+#define STATS_ROUND_BUCKETS 8                // Compostos por rodada: 0, 1, ..., >= 7
+
+typedef struct
+{
+    unsigned long starts;                                   // Pontos de partida (ou ímpares) sorteados
+    unsigned long candidates;                               // Candidatos examinados
+    unsigned long sieved;                                   // Eliminados pelo crivo (divisão por primos pequenos)
+    unsigned long tested;                                   // Enviados ao teste de primalidade
+    unsigned long mr_rounds;                                // Rodadas de Miller-Rabin (incluindo as de base 2)
+    unsigned long composites_by_round[STATS_ROUND_BUCKETS]; // Rodada que detectou o composto (BPSW: 0 = base 2, 1 = Lucas)
+    unsigned long lucas_tests;                              // Testes de Lucas fortes (Baillie-PSW)
+    unsigned long primes;                                   // Buscas que acharam um primo
+    unsigned long canceled;                                 // Buscas canceladas (par já completo)
+    double prime_seconds;                                   // Tempo somado das buscas que acharam primo
+    double prime_min, prime_max;                            // Menor e maior tempo por primo
+    double canceled_seconds;                                // Tempo somado das buscas canceladas
+} keygen_stats;
+
+int keygen_stats_enabled = 0;
+const char *keygen_stats_path = STATS_DEFAULT_PATH;
+static keygen_stats keygen_totals;
+static pthread_mutex_t keygen_totals_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local keygen_stats thread_stats; // Contadores da busca em andamento na thread
+
+/**
+ * @brief Retorna o tempo do relógio monotônico em segundos.
+ */
+double monotonic_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Registra um composto detectado na rodada 'round' (0 = primeira) do teste.
+ */
+static void stats_count_composite(int round)
+{
+    thread_stats.composites_by_round[round < STATS_ROUND_BUCKETS - 1 ? round : STATS_ROUND_BUCKETS - 1]++;
+}
+
+/**
+ * @brief Zera os totais do processo.
+ */
+void keygen_stats_reset()
+{
+    pthread_mutex_lock(&keygen_totals_lock);
+    memset(&keygen_totals, 0, sizeof(keygen_totals));
+    pthread_mutex_unlock(&keygen_totals_lock);
+}
+
+/**
+ * @brief Soma os contadores da busca que terminou na thread aos totais e os zera.
+ * @param found 1 se a busca achou um primo, 0 se foi cancelada.
+ * @param seconds Duração da busca.
+ */
+void keygen_stats_merge(int found, double seconds)
+{
+    keygen_stats *t = &thread_stats;
+    if (keygen_stats_enabled)
+    {
+        pthread_mutex_lock(&keygen_totals_lock);
+        keygen_stats *g = &keygen_totals;
+        g->starts += t->starts;
+        g->candidates += t->candidates;
+        g->sieved += t->sieved;
+        g->tested += t->tested;
+        g->mr_rounds += t->mr_rounds;
+        for (int i = 0; i < STATS_ROUND_BUCKETS; i++)
+            g->composites_by_round[i] += t->composites_by_round[i];
+        g->lucas_tests += t->lucas_tests;
+        if (found)
+        {
+            g->prime_min = g->primes == 0 || seconds < g->prime_min ? seconds : g->prime_min;
+            g->prime_max = seconds > g->prime_max ? seconds : g->prime_max;
+            g->primes++;
+            g->prime_seconds += seconds;
+        }
+        else
+        {
+            g->canceled++;
+            g->canceled_seconds += seconds;
+        }
+        pthread_mutex_unlock(&keygen_totals_lock);
+    }
+    memset(t, 0, sizeof(*t));
+}
+
+/**
+ * @brief Imprime os totais em forma de tabela.
+ * @param keygen_seconds Tempo de parede da geração inteira.
+ */
+void keygen_stats_print(FILE *out, double keygen_seconds)
+{
+    pthread_mutex_lock(&keygen_totals_lock);
+    keygen_stats g = keygen_totals;
+    pthread_mutex_unlock(&keygen_totals_lock);
+
+    unsigned long composites = 0;
+    for (int i = 0; i < STATS_ROUND_BUCKETS; i++)
+        composites += g.composites_by_round[i];
+
+    fprintf(out, "\nEstatísticas da geração (%.1f ms no total)\n", keygen_seconds * 1e3);
+    fprintf(out, "Pontos de partida sorteados:   %lu\n", g.starts);
+    fprintf(out, "Candidatos examinados:         %lu\n", g.candidates);
+    fprintf(out, "Eliminados pelo crivo:         %lu (%.1f%%)\n", g.sieved,
+            g.candidates ? 100.0 * g.sieved / g.candidates : 0.0);
+    fprintf(out, "Testes de primalidade:         %lu (%lu compostos)\n", g.tested, composites);
+    fprintf(out, "Rodadas de Miller-Rabin:       %lu\n", g.mr_rounds);
+    fprintf(out, "Testes de Lucas:               %lu\n", g.lucas_tests);
+    fprintf(out, "Compostos por rodada:         ");
+    for (int i = 0; i < STATS_ROUND_BUCKETS; i++)
+        fprintf(out, " %s%d:%lu", i == STATS_ROUND_BUCKETS - 1 ? ">=" : "", i, g.composites_by_round[i]);
+    fprintf(out, "\n");
+    if (g.primes)
+        fprintf(out, "Tempo por primo:               média %.2f ms, mín. %.2f ms, máx. %.2f ms (%lu primos)\n",
+                g.prime_seconds * 1e3 / g.primes, g.prime_min * 1e3, g.prime_max * 1e3, g.primes);
+    fprintf(out, "Buscas canceladas:             %lu (%.2f ms somados)\n", g.canceled, g.canceled_seconds * 1e3);
+}
+
+/**
+ * @brief Grava os totais em JSON.
+ * @param path Arquivo de saída.
+ * @param bits Tamanho da chave gerada.
+ * @param threads Threads usadas na busca de primos.
+ * @param keygen_seconds Tempo de parede da geração inteira.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int keygen_stats_write_json(const char *path, int bits, int threads, double keygen_seconds)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return 0;
+
+    pthread_mutex_lock(&keygen_totals_lock);
+    keygen_stats g = keygen_totals;
+    pthread_mutex_unlock(&keygen_totals_lock);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"key_bits\": %d,\n", bits);
+    fprintf(f, "  \"threads\": %d,\n", threads);
+    fprintf(f, "  \"primality_test\": \"%s\",\n", prime_test_mode == PRIMALITY_BPSW ? "bpsw" : "miller-rabin");
+    fprintf(f, "  \"keygen_seconds\": %.6f,\n", keygen_seconds);
+    fprintf(f, "  \"starts\": %lu,\n", g.starts);
+    fprintf(f, "  \"candidates\": %lu,\n", g.candidates);
+    fprintf(f, "  \"sieved\": %lu,\n", g.sieved);
+    fprintf(f, "  \"tested\": %lu,\n", g.tested);
+    fprintf(f, "  \"mr_rounds\": %lu,\n", g.mr_rounds);
+    fprintf(f, "  \"composites_by_round\": [");
+    for (int i = 0; i < STATS_ROUND_BUCKETS; i++)
+        fprintf(f, "%s%lu", i ? ", " : "", g.composites_by_round[i]);
+    fprintf(f, "],\n");
+    fprintf(f, "  \"lucas_tests\": %lu,\n", g.lucas_tests);
+    fprintf(f, "  \"primes\": %lu,\n", g.primes);
+    fprintf(f, "  \"prime_seconds\": {\"total\": %.6f, \"mean\": %.6f, \"min\": %.6f, \"max\": %.6f},\n",
+            g.prime_seconds, g.primes ? g.prime_seconds / g.primes : 0.0, g.prime_min, g.prime_max);
+    fprintf(f, "  \"canceled\": %lu,\n", g.canceled);
+    fprintf(f, "  \"canceled_seconds\": %.6f\n", g.canceled_seconds);
+    fprintf(f, "}\n");
+    return fclose(f) == 0;
+}
+
+// --- Rastreamento de latência por etapa ---
+//
+// Com um trace_record associado à thread (trace_attach), a assinatura e a
+// verificação somam nele o tempo de cada etapa; sem registro associado,
+// trace_start e trace_stop custam apenas um teste de ponteiro.
+
+static const char *const trace_stage_names[TRACE_STAGE_COUNT] = {"leitura", "hash",   "OAEP",
+                                                                 "modexp",  "base64", "escrita"};
+static _Thread_local trace_record *thread_trace; // Registro da operação em andamento na thread
+
+/**
+ * @brief Associa o registro às próximas etapas executadas pela thread (NULL desliga).
+ *
+ * O registro não é zerado; o chamador o zera no início de cada operação.
+ */
+void trace_attach(trace_record *rec)
+{
+    thread_trace = rec;
+}
+
+/**
+ * @brief Marca o início de uma etapa.
+ * @return Instante de início, ou 0 se não houver registro associado.
+ */
+double trace_start()
+{
+    return thread_trace ? monotonic_seconds() : 0.0;
+}
+
+/**
+ * @brief Soma ao registro associado o tempo da etapa iniciada em 'start'.
+ */
+void trace_stop(trace_stage stage, double start)
+{
+    if (thread_trace)
+        trace_record_add(thread_trace, stage, monotonic_seconds() - start);
+}
+
+/**
+ * @brief Soma um tempo já medido a uma etapa do registro (ex.: a parte de cada
+ *        assinatura em uma operação feita em lote).
+ */
+void trace_record_add(trace_record *rec, trace_stage stage, double seconds)
+{
+    rec->seconds[stage] += seconds;
+    rec->used |= 1u << stage;
+}
+
+/**
+ * @brief Retorna o nome de uma etapa.
+ */
+const char *trace_stage_name(trace_stage stage)
+{
+    return stage < TRACE_STAGE_COUNT ? trace_stage_names[stage] : "total";
+}
+
+/**
+ * @brief Imprime uma linha com o tempo de cada etapa usada e o total, em microssegundos.
+ */
+void trace_record_print(FILE *out, const trace_record *rec, const char *label)
+{
+    double total = 0.0;
+    fprintf(out, "[trace] %s:", label);
+    for (int s = 0; s < TRACE_STAGE_COUNT; s++)
+    {
+        if (!(rec->used & (1u << s)))
+            continue;
+        fprintf(out, " %s %.1f µs |", trace_stage_names[s], rec->seconds[s] * 1e6);
+        total += rec->seconds[s];
+    }
+    fprintf(out, " total %.1f µs\n", total * 1e6);
+}
+
+/**
+ * @brief Zera um histograma.
+ */
+void trace_histogram_init(trace_histogram *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+}
+
+/**
+ * @brief Acumula as etapas usadas de uma operação e o seu total.
+ *
+ * O balde b conta durações em [2^(b-1), 2^b) µs (o balde 0, abaixo de 1 µs; o
+ * último, tudo o que passar do penúltimo).
+ */
+void trace_histogram_add(trace_histogram *hist, const trace_record *rec)
+{
+    double total = 0.0;
+    for (int s = 0; s <= TRACE_STAGE_COUNT; s++)
+    {
+        double seconds;
+        if (s < TRACE_STAGE_COUNT)
+        {
+            if (!(rec->used & (1u << s)))
+                continue;
+            seconds = rec->seconds[s];
+            total += seconds;
+        }
+        else
+            seconds = total;
+
+        double us = seconds * 1e6;
+        int bucket = 0;
+        while (bucket < TRACE_BUCKETS - 1 && us >= (double)(1UL << bucket))
+            bucket++;
+
+        if (hist->count[s] == 0 || seconds < hist->min[s])
+            hist->min[s] = seconds;
+        if (seconds > hist->max[s])
+            hist->max[s] = seconds;
+        hist->sum[s] += seconds;
+        hist->count[s]++;
+        hist->buckets[s][bucket]++;
+    }
+}
+
+/**
+ * @brief Limite superior (em µs) do balde que contém o quantil q, limitado ao máximo.
+ */
+static double trace_histogram_quantile(const trace_histogram *hist, int s, double q)
+{
+    unsigned long target = (unsigned long)(q * hist->count[s] + 0.5), seen = 0;
+    if (target == 0)
+        target = 1;
+    for (int b = 0; b < TRACE_BUCKETS; b++)
+    {
+        seen += hist->buckets[s][b];
+        if (seen >= target)
+        {
+            double bound = b == TRACE_BUCKETS - 1 ? hist->max[s] * 1e6 : (double)(1UL << b);
+            return bound < hist->max[s] * 1e6 ? bound : hist->max[s] * 1e6;
+        }
+    }
+    return hist->max[s] * 1e6;
+}
+
+/**
+ * @brief Imprime, por etapa, contagem, média, mínimo, p50, p99 e máximo, e a
+ *        distribuição dos totais por balde.
+ */
+void trace_histogram_print(FILE *out, const trace_histogram *hist, const char *title)
+{
+    fprintf(out, "\n[trace] %s (µs; p50/p99 pelo limite do balde de potência de 2)\n", title);
+    fprintf(out, "%-8s | %8s | %10s | %10s | %10s | %10s | %10s\n", "Etapa", "N", "Média", "Mín.", "p50", "p99",
+            "Máx.");
+    for (int s = 0; s <= TRACE_STAGE_COUNT; s++)
+    {
+        if (hist->count[s] == 0)
+            continue;
+        fprintf(out, "%-8s | %8lu | %10.1f | %10.1f | %10.1f | %10.1f | %10.1f\n", trace_stage_name(s),
+                hist->count[s], hist->sum[s] * 1e6 / hist->count[s], hist->min[s] * 1e6,
+                trace_histogram_quantile(hist, s, 0.50), trace_histogram_quantile(hist, s, 0.99),
+                hist->max[s] * 1e6);
+    }
+
+    const unsigned long *totals = hist->buckets[TRACE_STAGE_COUNT];
+    fprintf(out, "Total por balde:");
+    for (int b = 0; b < TRACE_BUCKETS; b++)
+    {
+        if (totals[b])
+            fprintf(out, " <%lu µs: %lu", 1UL << b, totals[b]);
+    }
+    fprintf(out, "\n");
+}
+
+// --- Miller-Rabin no domínio de Montgomery ---
+
+#define MR_WINDOW 5                           // Janela deslizante da exponenciação a^d
+#define MR_TABLE_SIZE (1 << (MR_WINDOW - 1)) // Potências ímpares a^1, a^3, ..., a^(2^MR_WINDOW - 1)
+
+/**
+ * @brief Motor de Miller-Rabin com buffers pré-alocados.
+ *
+ * Cada candidato é convertido uma vez (inversa modular, R mod n, R^2 mod n, d
+ * e r), e todas as rodadas e quadrados seguintes ficam no domínio de
+ * Montgomery, comparando diretamente com R mod n (1) e n - R mod n (-1). Com
+ * AVX-512 IFMA os elementos usam limbs de 52 bits e amm52_x1; sem IFMA, limbs
+ * do GMP e mont_mul. Os buffers são dimensionados para 'capacity' limbs do GMP
+ * e reutilizados entre candidatos.
+ */
+typedef struct
+{
+    mont_ctx mont;         // Caminho escalar: n, n0inv e R^2
+    mp_size_t capacity;    // Limbs do GMP suportados
+    mp_size_t slot;        // Limbs alocados por elemento
+    mp_size_t width;       // Limbs por elemento no candidato atual
+    int ifma_ok;           // O processador suporta AVX-512 IFMA
+    int ifma;              // O candidato atual usa limbs de 52 bits
+    int ifma_limbs;        // L, com 52 * L >= bits(n) + 2
+    mp_limb_t k0;          // -n^(-1) mod 2^52
+    mp_limb_t *m52;        // n em limbs de 52 bits
+    mp_limb_t *r2;         // R^2 mod n na representação atual
+    mp_limb_t *one;        // R mod n
+    mp_limb_t *minus_one;  // n - (R mod n)
+    mp_limb_t *acc;        // Acumulador da exponenciação
+    mp_limb_t *x;          // Base e rascunho
+    mp_limb_t *table;      // MR_TABLE_SIZE potências ímpares da base
+    mp_limb_t *wide;       // Dividendos de R e R^2; depois, rascunho de mont_mul (2 * capacity + 1 limbs)
+    mp_limb_t *quotient;   // Quociente descartado (capacity + 2 limbs)
+    mpz_t d, n_minus_3, a; // Parte ímpar de n - 1, limite das bases e base atual
+    int r;                 // n - 1 = d * 2^r
+} mr_engine;
+
+static _Thread_local mr_engine thread_mr_engine; // Motor da thread, criado no primeiro uso
+
+/**
+ * @brief Aloca um motor para candidatos de até 'capacity' limbs.
+ *
+ * Os mpz_t são pré-dimensionados; não deve ser chamado dentro de um escopo de arena.
+ *
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int mr_engine_init(mr_engine *eng, mp_size_t capacity)
+{
+    memset(eng, 0, sizeof(*eng));
+    if (!mont_ctx_alloc(&eng->mont, capacity))
+        return 0;
+
+    // Um elemento precisa de 'capacity' limbs do GMP ou de 8 * (floor(L / 8) + 1) limbs de 52 bits
+    mp_size_t l52 = (capacity * GMP_NUMB_BITS + 2 + MB_LIMB_BITS - 1) / MB_LIMB_BITS;
+    mp_size_t slot = (l52 / MB_LANES + 1) * MB_LANES;
+    if (slot < capacity)
+        slot = capacity;
+
+    mp_limb_t *limbs = calloc((6 + MR_TABLE_SIZE) * slot + (2 * capacity + 1) + (capacity + 2), sizeof(mp_limb_t));
+    if (!limbs)
+    {
+        mont_ctx_clear(&eng->mont);
+        return 0;
+    }
+    eng->capacity = capacity;
+    eng->slot = slot;
+    eng->ifma_ok = mb_ifma_available() && l52 <= MB_MAX_LIMBS;
+    eng->m52 = limbs;
+    eng->r2 = limbs + slot;
+    eng->one = limbs + 2 * slot;
+    eng->minus_one = limbs + 3 * slot;
+    eng->acc = limbs + 4 * slot;
+    eng->x = limbs + 5 * slot;
+    eng->table = limbs + 6 * slot;
+    eng->wide = eng->table + MR_TABLE_SIZE * slot;
+    eng->quotient = eng->wide + 2 * capacity + 1;
+
+    mp_bitcnt_t bits = capacity * GMP_NUMB_BITS;
+    mpz_init2(eng->d, bits);
+    mpz_init2(eng->n_minus_3, bits);
+    mpz_init2(eng->a, bits);
+    return 1;
+}
+
+/**
+ * @brief Libera os buffers de um motor.
+ */
+static void mr_engine_clear(mr_engine *eng)
+{
+    if (!eng->capacity)
+        return;
+    free(eng->m52);
+    mont_ctx_clear(&eng->mont);
+    mpz_clears(eng->d, eng->n_minus_3, eng->a, NULL);
+    memset(eng, 0, sizeof(*eng));
+}
+
+/**
+ * @brief Converte nl limbs do GMP em 'width' limbs de 52 bits (L significativos, o resto zerado).
+ */
+static void limbs_to_52(mp_limb_t *out, const mp_limb_t *in, mp_size_t nl, int L, mp_size_t width)
+{
+    for (int j = 0; j < L; j++)
+    {
+        size_t bit = (size_t)j * MB_LIMB_BITS;
+        mp_size_t w = bit / GMP_NUMB_BITS;
+        int shift = bit % GMP_NUMB_BITS;
+        mp_limb_t v = w < nl ? in[w] >> shift : 0;
+        if (shift > GMP_NUMB_BITS - MB_LIMB_BITS && w + 1 < nl)
+            v |= in[w + 1] << (GMP_NUMB_BITS - shift);
+        out[j] = v & MB_LIMB_MASK;
+    }
+    memset(out + L, 0, (width - L) * sizeof(mp_limb_t));
+}
+
+/**
+ * @brief r = a - b em L limbs de 52 bits (a >= b).
+ */
+static void sub_52(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b, int L)
+{
+    mp_limb_t borrow = 0;
+    for (int j = 0; j < L; j++)
+    {
+        mp_limb_t t = a[j] - b[j] - borrow;
+        r[j] = t & MB_LIMB_MASK;
+        borrow = t >> (GMP_NUMB_BITS - 1);
+    }
+}
+
+/**
+ * @brief Compara a e b em L limbs de 52 bits.
+ * @return Negativo, zero ou positivo, como mpn_cmp.
+ */
+static int cmp_52(const mp_limb_t *a, const mp_limb_t *b, int L)
+{
+    for (int j = L - 1; j >= 0; j--)
+        if (a[j] != b[j])
+            return a[j] < b[j] ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief Prepara o motor para o candidato n (ímpar, maior que 3, até 'capacity' limbs).
+ *
+ * É a única conversão por candidato: duas divisões (R mod n e R^2 mod n), a
+ * mudança para limbs de 52 bits quando há IFMA e a decomposição
+ * n - 1 = d * 2^r, sem alocação.
+ */
+static void mr_engine_set(mr_engine *eng, const mpz_t n)
+{
+    mp_size_t nl = mpz_size(n);
+    const mp_limb_t *np = mpz_limbs_read(n);
+    mont_ctx *ctx = &eng->mont;
+
+    ctx->nlimbs = nl;
+    memcpy(ctx->n, np, nl * sizeof(mp_limb_t));
+    ctx->n0inv = mont_n0inv(ctx->n[0]);
+    eng->ifma = eng->ifma_ok;
+
+    if (eng->ifma)
+    {
+        // R = 2^(52 * L); R mod n e R^2 mod n saem em limbs do GMP e são convertidos
+        int L = (mpz_sizeinbase(n, 2) + 2 + MB_LIMB_BITS - 1) / MB_LIMB_BITS;
+        size_t rbit = (size_t)L * MB_LIMB_BITS;
+        mp_size_t rl = rbit / GMP_NUMB_BITS + 1;
+        eng->ifma_limbs = L;
+        eng->width = (L / MB_LANES + 1) * MB_LANES;
+        eng->k0 = ctx->n0inv & MB_LIMB_MASK;
+        limbs_to_52(eng->m52, np, nl, L, eng->width);
+
+        memset(eng->wide, 0, rl * sizeof(mp_limb_t));
+        eng->wide[rl - 1] = (mp_limb_t)1 << (rbit % GMP_NUMB_BITS);
+        mpn_tdiv_qr(eng->quotient, eng->x, 0, eng->wide, rl, ctx->n, nl);
+        mpn_sqr(eng->wide, eng->x, nl);
+        mpn_tdiv_qr(eng->quotient, eng->acc, 0, eng->wide, 2 * nl, ctx->n, nl);
+        limbs_to_52(eng->one, eng->x, nl, L, eng->width);
+        limbs_to_52(eng->r2, eng->acc, nl, L, eng->width);
+        memset(eng->minus_one, 0, eng->width * sizeof(mp_limb_t));
+        sub_52(eng->minus_one, eng->m52, eng->one, L);
+    }
+    else
+    {
+        // R = 2^(GMP_NUMB_BITS * nl)
+        eng->width = nl;
+        memset(eng->wide, 0, (2 * nl + 1) * sizeof(mp_limb_t));
+        eng->wide[nl] = 1;
+        mpn_tdiv_qr(eng->quotient, eng->one, 0, eng->wide, nl + 1, ctx->n, nl);
+        eng->wide[nl] = 0;
+        eng->wide[2 * nl] = 1;
+        mpn_tdiv_qr(eng->quotient, eng->r2, 0, eng->wide, 2 * nl + 1, ctx->n, nl);
+        mpn_sub_n(eng->minus_one, ctx->n, eng->one, nl);
+    }
+
+    mpz_sub_ui(eng->d, n, 1);
+    eng->r = mpz_scan1(eng->d, 0);
+    mpz_tdiv_q_2exp(eng->d, eng->d, eng->r);
+    mpz_sub_ui(eng->n_minus_3, n, 3);
+}
+
+/**
+ * @brief Multiplicação de Montgomery na representação do candidato atual.
+ *
+ * No caminho IFMA o resultado fica apenas abaixo de 2n; mr_engine_equal e
+ * mr_engine_double o reduzem quando necessário.
+ */
+static void mr_engine_mul(mr_engine *eng, mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b)
+{
+#ifdef MB_IFMA_BUILD
+    if (eng->ifma)
+    {
+        amm52_x1(r, a, b, eng->m52, eng->k0, eng->ifma_limbs);
+        return;
+    }
+#endif
+    mont_mul(&eng->mont, r, a, b, eng->wide);
+}
+
+/**
+ * @brief Leva x de [0, 2n) para [0, n) no caminho IFMA (no escalar já está reduzido).
+ */
+static void mr_engine_reduce(mr_engine *eng, mp_limb_t *x)
+{
+    if (eng->ifma && cmp_52(x, eng->m52, eng->ifma_limbs) >= 0)
+        sub_52(x, x, eng->m52, eng->ifma_limbs);
+}
+
+/**
+ * @brief Compara x com uma constante já reduzida (1 ou -1), reduzindo x antes.
+ * @return 1 se iguais, 0 caso contrário.
+ */
+static int mr_engine_equal(mr_engine *eng, mp_limb_t *x, const mp_limb_t *c)
+{
+    mr_engine_reduce(eng, x);
+    return mpn_cmp(x, c, eng->width) == 0;
+}
+
+/**
+ * @brief x = 2x mod n: um deslocamento de um bit seguido de uma subtração condicional.
+ */
+static void mr_engine_double(mr_engine *eng, mp_limb_t *x)
+{
+    if (eng->ifma)
+    {
+        int L = eng->ifma_limbs;
+        mr_engine_reduce(eng, x);
+        mp_limb_t carry = 0;
+        for (int j = 0; j < L; j++)
+        {
+            mp_limb_t t = (x[j] << 1) | carry;
+            x[j] = t & MB_LIMB_MASK;
+            carry = t >> MB_LIMB_BITS;
+        }
+        // 2x < 2n < 2^(52 * L): não sobra carry
+        mr_engine_reduce(eng, x);
+        return;
+    }
+
+    mont_ctx *ctx = &eng->mont;
+    mp_limb_t cy = mpn_lshift(x, x, ctx->nlimbs, 1);
+    if (cy || mpn_cmp(x, ctx->n, ctx->nlimbs) >= 0)
+        mpn_sub_n(x, x, ctx->n, ctx->nlimbs);
+}
+
+/**
+ * @brief Conclui uma rodada a partir de acc = a^d (domínio de Montgomery).
+ *
+ * Verifica a^d ≡ ±1 e depois os quadrados a^(d * 2^j), j < r, comparando com
+ * as constantes 1 e -1 já convertidas.
+ *
+ * @return 1 se n é pseudoprimo forte na base, 0 se é composto.
+ */
+static int mr_engine_finish(mr_engine *eng)
+{
+    mp_limb_t *acc = eng->acc;
+
+    if (mr_engine_equal(eng, acc, eng->one) || mr_engine_equal(eng, acc, eng->minus_one))
+        return 1;
+
+    for (int j = 0; j < eng->r - 1; j++)
+    {
+        mr_engine_mul(eng, acc, acc, acc);
+        if (mr_engine_equal(eng, acc, eng->minus_one))
+            return 1;
+        if (mr_engine_equal(eng, acc, eng->one))
+            return 0; // Raiz quadrada não trivial de 1
+    }
+    return 0;
+}
+
+/**
+ * @brief Rodada de Miller-Rabin na base 2.
+ *
+ * Multiplicar por 2 no domínio de Montgomery é um deslocamento de um bit seguido
+ * de uma subtração condicional, então a^d sai apenas com os quadrados, sem tabela
+ * nem multiplicações de janela.
+ *
+ * @return 1 se n é pseudoprimo forte na base 2, 0 se é composto.
+ */
+static int mr_engine_round_base2(mr_engine *eng)
+{
+    mp_limb_t *acc = eng->acc;
+    const mp_limb_t *d = mpz_limbs_read(eng->d);
+
+    memcpy(acc, eng->one, eng->width * sizeof(mp_limb_t));
+    for (long bit = (long)mpz_sizeinbase(eng->d, 2) - 1; bit >= 0; bit--)
+    {
+        mr_engine_mul(eng, acc, acc, acc);
+        if ((d[bit / GMP_NUMB_BITS] >> (bit % GMP_NUMB_BITS)) & 1)
+            mr_engine_double(eng, acc);
+    }
+    return mr_engine_finish(eng);
+}
+
+/**
+ * @brief Uma rodada de Miller-Rabin com a base eng->a (em [2, n - 2]).
+ * @return 1 se n é pseudoprimo forte na base, 0 se é composto.
+ */
+static int mr_engine_round(mr_engine *eng)
+{
+    if (mpz_cmp_ui(eng->a, 2) == 0)
+        return mr_engine_round_base2(eng);
+
+    mp_size_t width = eng->width;
+    mp_limb_t *acc = eng->acc;
+    mp_limb_t *x = eng->x;
+
+    // Base no domínio de Montgomery: a * R^2 * R^(-1) = a * R
+    mp_size_t al = mpz_size(eng->a);
+    if (eng->ifma)
+        limbs_to_52(x, mpz_limbs_read(eng->a), al, eng->ifma_limbs, width);
+    else
+    {
+        memcpy(x, mpz_limbs_read(eng->a), al * sizeof(mp_limb_t));
+        memset(x + al, 0, (width - al) * sizeof(mp_limb_t));
+    }
+    mp_limb_t *table = eng->table;
+    mr_engine_mul(eng, table, x, eng->r2);
+
+    // Potências ímpares: table[i] = a^(2i + 1); x guarda a^2
+    mr_engine_mul(eng, x, table, table);
+    for (int i = 1; i < MR_TABLE_SIZE; i++)
+        mr_engine_mul(eng, table + i * width, table + (i - 1) * width, x);
+
+    // a^d por janela deslizante, do bit mais alto para o mais baixo
+    const mp_limb_t *d = mpz_limbs_read(eng->d);
+    long bit = (long)mpz_sizeinbase(eng->d, 2) - 1;
+    int started = 0;
+    while (bit >= 0)
+    {
+        if (!((d[bit / GMP_NUMB_BITS] >> (bit % GMP_NUMB_BITS)) & 1))
+        {
+            mr_engine_mul(eng, acc, acc, acc);
+            bit--;
+            continue;
+        }
+
+        // Maior janela [low, bit] com até MR_WINDOW bits que termina em bit 1
+        long low = bit - MR_WINDOW + 1 < 0 ? 0 : bit - MR_WINDOW + 1;
+        while (!((d[low / GMP_NUMB_BITS] >> (low % GMP_NUMB_BITS)) & 1))
+            low++;
+        unsigned int window = 0;
+        for (long j = bit; j >= low; j--)
+            window = (window << 1) | ((d[j / GMP_NUMB_BITS] >> (j % GMP_NUMB_BITS)) & 1);
+
+        if (started)
+        {
+            for (long j = bit; j >= low; j--)
+                mr_engine_mul(eng, acc, acc, acc);
+            mr_engine_mul(eng, acc, acc, table + (window >> 1) * width);
+        }
+        else
+        {
+            memcpy(acc, table + (window >> 1) * width, width * sizeof(mp_limb_t));
+            started = 1;
+        }
+        bit = low - 1;
+    }
+    return mr_engine_finish(eng);
+}
+
+/**
+ * @brief Retorna o motor da thread, com capacidade para n.
+ * @return Ponteiro para o motor, ou NULL em falha de alocação.
+ */
+static mr_engine *mr_thread_engine(const mpz_t n)
+{
+    mr_engine *eng = &thread_mr_engine;
+    mp_size_t nl = mpz_size(n);
+    if (eng->capacity < nl)
+    {
+        mr_engine_clear(eng);
+        if (!mr_engine_init(eng, nl))
+            return NULL;
+    }
+    return eng;
+}
+
+/**
+ * @brief Libera o motor de Miller-Rabin da thread atual (chamar antes de a thread terminar).
+ */
+void mr_thread_engine_release()
+{
+    mr_engine_clear(&thread_mr_engine);
+}
+
+/**
+ * @brief Teste de Miller-Rabin com k bases aleatórias no domínio de Montgomery.
+ *
+ * Mesmo contrato de miller_rabin_test, usando o motor da thread. Antes das k
+ * rodadas aleatórias, uma rodada na base 2 (a mais barata) descarta quase todos
+ * os compostos; ela não conta como uma das k rodadas.
+ *
+ * @param n Número a ser testado.
+ * @param k Número de iterações.
+ * @param rng Gerador de números aleatórios (DRBG).
+ * @return 1 se provavelmente primo, 0 se composto.
+ */
+int miller_rabin_test_mont(const mpz_t n, int k, drbg *rng)
+{
+    if (mpz_cmp_ui(n, 2) == 0 || mpz_cmp_ui(n, 3) == 0)
+        return 1;
+    if (mpz_cmp_ui(n, 1) <= 0 || mpz_even_p(n))
+        return 0;
+
+    mr_engine *eng = mr_thread_engine(n);
+    if (!eng)
+        return 0;
+    mr_engine_set(eng, n);
+
+    mpz_set_ui(eng->a, 2);
+    thread_stats.mr_rounds++;
+    if (!mr_engine_round(eng))
+    {
+        stats_count_composite(0);
+        return 0;
+    }
+
+    for (int i = 0; i < k; i++)
+    {
+        drbg_urandomm(eng->a, rng, eng->n_minus_3);
+        mpz_add_ui(eng->a, eng->a, 2); // Base em [2, n - 2]
+        thread_stats.mr_rounds++;
+        if (!mr_engine_round(eng))
+        {
+            stats_count_composite(i + 1);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Teste de pseudoprimo forte na base 2 no domínio de Montgomery.
+ * @return 1 se n (ímpar, maior que 3) é pseudoprimo forte na base 2, 0 caso contrário.
+ */
+int strong_probable_prime_base2(const mpz_t n)
+{
+    mr_engine *eng = mr_thread_engine(n);
+    if (!eng)
+        return 0;
+    mr_engine_set(eng, n);
+    mpz_set_ui(eng->a, 2);
+    thread_stats.mr_rounds++;
+    if (mr_engine_round(eng))
+        return 1;
+    stats_count_composite(0);
+    return 0;
+}
+
+// --- Funções Criptográficas ---
+
+/**
+ * @brief Uma rodada do Miller-Rabin (teste de pseudoprimo forte) com a base a.
+ * @param n Número ímpar a ser testado.
+ * @param n_minus_1 n - 1.
+ * @param d Parte ímpar de n - 1.
+ * @param r Expoente de 2 em n - 1 = d * 2^r.
+ * @param a Base.
+ * @param x Temporário.
+ * @return 1 se n é pseudoprimo forte na base a, 0 se é composto.
+ */
+static int miller_rabin_round(mpz_t n, mpz_t n_minus_1, mpz_t d, int r, mpz_t a, mpz_t x)
+{
+    mpz_powm(x, a, d, n);
+
+    if (mpz_cmp_ui(x, 1) == 0 || mpz_cmp(x, n_minus_1) == 0)
+        return 1;
+
+    for (int j = 0; j < r - 1; j++)
+    {
+        mpz_powm_ui(x, x, 2, n);
+        if (mpz_cmp(x, n_minus_1) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Teste de primalidade Miller-Rabin.
+ * @param n Número a ser testado.
+ * @param k Número de iterações.
+ * @param rng Gerador de números aleatórios (DRBG).
+ * @return 1 se provavelmente primo, 0 se composto.
+ */
+int miller_rabin_test(mpz_t n, int k, drbg *rng)
+{
+    if (mpz_cmp_ui(n, 2) == 0 || mpz_cmp_ui(n, 3) == 0)
+        return 1;
+    if (mpz_cmp_ui(n, 1) <= 0 || mpz_even_p(n))
+        return 0;
+
+    mpz_t n_minus_1, d, a, x;
+    mpz_inits(n_minus_1, d, a, x, NULL);
+
+    mpz_sub_ui(n_minus_1, n, 1);
+    int r = mpz_scan1(n_minus_1, 0);
+    mpz_tdiv_q_2exp(d, n_minus_1, r);
+
+    int probable_prime = 1;
+    for (int i = 0; i < k && probable_prime; i++)
+    {
+        drbg_urandomm(a, rng, n_minus_1);
+        if (mpz_cmp_ui(a, 2) < 0)
+            mpz_set_ui(a, 2);
+
+        thread_stats.mr_rounds++;
+        probable_prime = miller_rabin_round(n, n_minus_1, d, r, a, x);
+        if (!probable_prime)
+            stats_count_composite(i);
+    }
+
+    mpz_clears(n_minus_1, d, a, x, NULL);
+    return probable_prime;
+}
+
+/**
+ * @brief Número de rodadas de Miller-Rabin para primos aleatórios de RSA.
+ *
+ * Valores da Tabela B.1 do FIPS 186-5 (apenas testes M-R), que garantem
+ * probabilidade de erro compatível com a força de segurança de cada tamanho
+ * de módulo. Para primos maiores que os da tabela, usa-se a última linha.
+ *
+ * @param bits Número de bits do primo.
+ */
+int fips_miller_rabin_rounds(int bits)
+{
+    if (bits <= 512)
+        return 7;
+    if (bits <= 1024)
+        return 5;
+    return 4;
+}
+
+/**
+ * @brief Teste de Lucas forte com os parâmetros de Selfridge (método A).
+ *
+ * Escolhe D na sequência 5, -7, 9, -11, ... com símbolo de Jacobi (D/n) = -1,
+ * P = 1 e Q = (1 - D) / 4, e verifica se U_d ≡ 0 ou V_(d*2^r) ≡ 0 (mod n) para
+ * algum 0 <= r < s, com n + 1 = d * 2^s.
+ *
+ * @param n Número ímpar, maior que 2, que não seja quadrado perfeito.
+ * @return 1 se n é pseudoprimo de Lucas forte, 0 se é composto.
+ */
+int strong_lucas_test(mpz_t n)
+{
+    mpz_t d_mpz, u, v, qk, t, dd;
+    mpz_inits(d_mpz, u, v, qk, t, dd, NULL);
+
+    // Seleção de D
+    long D = 5;
+    for (;;)
+    {
+        mpz_set_si(dd, D);
+        int j = mpz_jacobi(dd, n);
+        if (j == -1)
+            break;
+        if (j == 0 && mpz_cmpabs_ui(n, labs(D)) != 0)
+        {
+            mpz_clears(d_mpz, u, v, qk, t, dd, NULL);
+            return 0; // |D| tem fator comum com n
+        }
+        D = D > 0 ? -(D + 2) : -(D - 2);
+    }
+    long Q = (1 - D) / 4;
+
+    // n + 1 = d * 2^s
+    mpz_add_ui(d_mpz, n, 1);
+    unsigned long s = mpz_scan1(d_mpz, 0);
+    mpz_tdiv_q_2exp(d_mpz, d_mpz, s);
+
+    // Escada binária sobre d, começando no bit mais alto: U_1 = 1, V_1 = P = 1
+    mpz_set_ui(u, 1);
+    mpz_set_ui(v, 1);
+    mpz_set_si(qk, Q);
+    mpz_mod(qk, qk, n);
+    for (long bit = (long)mpz_sizeinbase(d_mpz, 2) - 2; bit >= 0; bit--)
+    {
+        // Duplicação: U_2k = U_k V_k, V_2k = V_k^2 - 2 Q^k
+        mpz_mul(u, u, v);
+        mpz_mod(u, u, n);
+        mpz_mul(v, v, v);
+        mpz_submul_ui(v, qk, 2);
+        mpz_mod(v, v, n);
+        mpz_mul(qk, qk, qk);
+        mpz_mod(qk, qk, n);
+
+        if (mpz_tstbit(d_mpz, bit))
+        {
+            // Incremento (P = 1): U_(k+1) = (U + V) / 2, V_(k+1) = (D U + V) / 2
+            mpz_add(t, u, v);
+            mpz_mul_si(u, u, D);
+            mpz_add(v, v, u);
+            mpz_mod(u, t, n);
+            if (mpz_odd_p(u))
+                mpz_add(u, u, n);
+            mpz_fdiv_q_2exp(u, u, 1);
+            mpz_mod(v, v, n);
+            if (mpz_odd_p(v))
+                mpz_add(v, v, n);
+            mpz_fdiv_q_2exp(v, v, 1);
+
+            mpz_mul_si(qk, qk, Q);
+            mpz_mod(qk, qk, n);
+        }
+    }
+
+    int probable_prime = mpz_sgn(u) == 0 || mpz_sgn(v) == 0;
+    for (unsigned long r = 1; r < s && !probable_prime; r++)
+    {
+        mpz_mul(v, v, v);
+        mpz_submul_ui(v, qk, 2);
+        mpz_mod(v, v, n);
+        mpz_mul(qk, qk, qk);
+        mpz_mod(qk, qk, n);
+        probable_prime = mpz_sgn(v) == 0;
+    }
+
+    mpz_clears(d_mpz, u, v, qk, t, dd, NULL);
+    return probable_prime;
+}
+
+/**
+ * @brief Teste de primalidade Baillie-PSW.
+ *
+ * Um teste de pseudoprimo forte na base 2 seguido de um teste de Lucas forte.
+ * Não há contraexemplo conhecido.
+ *
+ * @param n Número a ser testado.
+ * @return 1 se provavelmente primo, 0 se composto.
+ */
+int bpsw_test(mpz_t n)
+{
+    if (mpz_cmp_ui(n, 2) == 0 || mpz_cmp_ui(n, 3) == 0)
+        return 1;
+    if (mpz_cmp_ui(n, 1) <= 0 || mpz_even_p(n))
+        return 0;
+
+    if (!strong_probable_prime_base2(n))
+        return 0;
+    // Rodada 1 do Baillie-PSW nas estatísticas: quadrado perfeito ou teste de Lucas
+    if (mpz_perfect_square_p(n))
+    {
+        stats_count_composite(1);
+        return 0;
+    }
+    thread_stats.lucas_tests++;
+    if (strong_lucas_test(n))
+        return 1;
+    stats_count_composite(1);
+    return 0;
+}
+
+/**
+ * @brief Testa a primalidade de um candidato com o teste selecionado em prime_test_mode.
+ *
+ * O Miller-Rabin escolhe o motor pelo tamanho do candidato: abaixo de
+ * MR_MONT_MIN_BITS a conversão para o domínio de Montgomery não se paga e o
+ * mpz_powm do GMP é mais rápido (cerca de 0,8x em 512 bits e 1,05x em 768 bits
+ * para primos, medido com a opção 9 do menu).
+ *
+ * @param n Candidato.
+ * @param bits Número de bits do candidato (define as rodadas do Miller-Rabin, se
+ *             prime_test_rounds for 0).
+ * @param rng Gerador das bases do Miller-Rabin.
+ * @return 1 se provavelmente primo, 0 se composto.
+ */
+int is_probable_prime(mpz_t n, int bits, drbg *rng)
+{
+    if (prime_test_mode == PRIMALITY_BPSW)
+        return bpsw_test(n);
+    int rounds = prime_test_rounds > 0 ? prime_test_rounds : fips_miller_rabin_rounds(bits);
+    if (bits < MR_MONT_MIN_BITS)
+        return miller_rabin_test(n, rounds, rng);
+    return miller_rabin_test_mont(n, rounds, rng);
+}
+
+#define SIEVE_PRIMES 2048  // Primos pequenos (ímpares) usados no crivo
+#define SIEVE_WINDOW 8192  // Candidatos ímpares por janela do crivo
+#define SIEVE_MIN_BITS 64  // Abaixo disso, usa a busca por sorteio simples
+#define SIEVE_LIMIT 20000  // Cobre o 2049º primo (17881)
+
+/**
+ * @brief Retorna a tabela dos SIEVE_PRIMES primeiros primos ímpares (3, 5, 7, ...).
+ *
+ * A tabela é montada uma única vez com o crivo de Eratóstenes.
+ */
+static const unsigned int *sieve_small_primes()
+{
+    static unsigned int primes[SIEVE_PRIMES];
+    static int ready = 0;
+    if (ready)
+        return primes;
+
+    static unsigned char composite[SIEVE_LIMIT];
+    int count = 0;
+    for (unsigned int i = 3; i < SIEVE_LIMIT && count < SIEVE_PRIMES; i += 2)
+    {
+        if (composite[i])
+            continue;
+        primes[count++] = i;
+        for (unsigned int j = i * i; j < SIEVE_LIMIT; j += 2 * i)
+            composite[j] = 1;
+    }
+    ready = 1;
+    return primes;
+}
+
+/**
+ * @brief Gera um primo sorteando um ímpar novo a cada tentativa (método original).
+ *
+ * Mantido para primos pequenos e como referência no benchmark de geração. As
+ * bases do Miller-Rabin saem de um fluxo derivado, de modo que os candidatos
+ * sorteados dependem apenas de rng.
+ */
+void generate_prime_trial(mpz_t prime, int bits, drbg *rng)
+{
+    drbg bases;
+    drbg_fork(&bases, rng);
+    do
+    {
+        drbg_urandomb(prime, rng, bits);
+        mpz_setbit(prime, bits - 1); // Garante que tenha o número de bits correto
+        mpz_setbit(prime, 0);        // Garante que seja ímpar
+        thread_stats.starts++;
+        thread_stats.candidates++;
+        thread_stats.tested++;
+    } while (!miller_rabin_test(prime, MILLER_RABIN_ITERATIONS, &bases) ||
+             mpz_sizeinbase(prime, 2) != bits);
+}
+
+/**
+ * @brief Corpo da busca de generate_prime_cancelable (sem a consolidação das estatísticas).
+ */
+static int prime_search(mpz_t prime, int bits, drbg *rng, atomic_int *cancel)
+{
+    if (bits < SIEVE_MIN_BITS)
+    {
+        generate_prime_trial(prime, bits, rng);
+        return 1;
+    }
+
+    const unsigned int *primes = sieve_small_primes();
+    unsigned int residues[SIEVE_PRIMES];
+    uint64_t sieve[SIEVE_WINDOW / 64];
+    drbg bases;
+    drbg_fork(&bases, rng);
+    mpz_t start;
+    mpz_init(start);
+
+    for (;;)
+    {
+        // Ponto de partida: ímpar aleatório com os dois bits mais altos ligados,
+        // para que o produto de dois primos de 'bits' bits tenha exatamente 2 * bits bits
+        drbg_urandomb(start, rng, bits);
+        mpz_setbit(start, bits - 1);
+        mpz_setbit(start, bits - 2);
+        mpz_setbit(start, 0);
+        thread_stats.starts++;
+        for (int i = 0; i < SIEVE_PRIMES; i++)
+            residues[i] = mpz_fdiv_ui(start, primes[i]);
+
+        // Percorre janelas até sair do intervalo de 'bits' bits
+        for (;;)
+        {
+            // Candidato j é start + 2j; marca j quando (r + 2j) ≡ 0 (mod p)
+            memset(sieve, 0, sizeof(sieve));
+            for (int i = 0; i < SIEVE_PRIMES; i++)
+            {
+                unsigned int p = primes[i];
+                unsigned int r = residues[i];
+                unsigned int j = r == 0 ? 0 : (unsigned int)(((uint64_t)(p - r) * ((p + 1) / 2)) % p);
+                for (; j < SIEVE_WINDOW; j += p)
+                    sieve[j / 64] |= 1ULL << (j % 64);
+            }
+
+            for (unsigned int j = 0; j < SIEVE_WINDOW; j++)
+            {
+                thread_stats.candidates++;
+                if (sieve[j / 64] & (1ULL << (j % 64)))
+                {
+                    thread_stats.sieved++;
+                    continue;
+                }
+                if (cancel && atomic_load_explicit(cancel, memory_order_relaxed))
+                {
+                    mpz_clear(start);
+                    return 0;
+                }
+                mpz_add_ui(prime, start, 2 * (unsigned long)j);
+                if (mpz_sizeinbase(prime, 2) != (size_t)bits)
+                    break;
+                thread_stats.tested++;
+                if (is_probable_prime(prime, bits, &bases))
+                {
+                    mpz_clear(start);
+                    return 1;
+                }
+            }
+
+            // Avança para a próxima janela
+            mpz_add_ui(start, start, 2 * SIEVE_WINDOW);
+            if (mpz_sizeinbase(start, 2) != (size_t)bits)
+                break; // Sorteia um novo ponto de partida
+            for (int i = 0; i < SIEVE_PRIMES; i++)
+                residues[i] = (residues[i] + 2 * SIEVE_WINDOW) % primes[i];
+        }
+    }
+}
+
+/**
+ * @brief Gera um número primo com um número específico de bits, com cancelamento cooperativo.
+ *
+ * Busca incremental com crivo: a partir de um único ponto de partida aleatório
+ * (ímpar), calcula-se uma vez o resto módulo cada primo pequeno. Em seguida,
+ * para cada janela de SIEVE_WINDOW candidatos ímpares consecutivos, um crivo de
+ * bits marca os múltiplos desses primos, e o teste de primalidade selecionado
+ * em prime_test_mode roda apenas nos sobreviventes. Entre janelas, os restos são
+ * atualizados sem divisões longas.
+ *
+ * Os pontos de partida saem de rng e as bases do Miller-Rabin de um fluxo
+ * derivado dele na entrada. Assim, com a mesma semente, todos os testes de
+ * primalidade percorrem exatamente os mesmos candidatos. Com --stats, os
+ * contadores da busca e a sua duração são somados aos totais do processo.
+ *
+ * @param prime Variável mpz_t para armazenar o primo.
+ * @param bits O número de bits do primo.
+ * @param rng Gerador de números aleatórios (DRBG).
+ * @param cancel Sinal consultado antes de cada teste de primalidade (pode ser NULL).
+ * @return 1 se um primo foi encontrado, 0 se a busca foi cancelada.
+ */
+int generate_prime_cancelable(mpz_t prime, int bits, drbg *rng, atomic_int *cancel)
+{
+    memset(&thread_stats, 0, sizeof(thread_stats)); // Descarta contagens feitas fora de uma busca
+    double start = keygen_stats_enabled ? monotonic_seconds() : 0;
+    int found = prime_search(prime, bits, rng, cancel);
+    keygen_stats_merge(found, keygen_stats_enabled ? monotonic_seconds() - start : 0);
+    return found;
+}
+
+/**
+ * @brief Gera um número primo com um número específico de bits.
+ * @param prime Variável mpz_t para armazenar o primo.
+ * @param bits O número de bits do primo.
+ * @param rng Gerador de números aleatórios (DRBG).
+ */
+void generate_prime(mpz_t prime, int bits, drbg *rng)
+{
+    generate_prime_cancelable(prime, bits, rng, NULL);
+}
+
+// --- Geração Paralela de Primos ---
+
+/**
+ * @brief Estado compartilhado pelas threads que buscam os primos p e q.
+ *
+ * Cada primo verificado preenche o próximo slot livre (p, depois q). Quando os
+ * dois estão preenchidos, 'done' cancela as buscas em andamento.
+ */
+typedef struct
+{
+    int bits;
+    pthread_mutex_t lock;
+    mpz_t primes[2];
+    int filled;
+    atomic_int done;
+} prime_pool;
+
+typedef struct
+{
+    prime_pool *pool;
+    drbg rng; // Fluxo aleatório próprio da thread
+} prime_worker;
+
+/**
+ * @brief Laço de uma thread de busca: gera primos até os dois slots estarem preenchidos.
+ */
+static void *prime_worker_run(void *arg)
+{
+    prime_worker *worker = (prime_worker *)arg;
+    prime_pool *pool = worker->pool;
+    mpz_t candidate;
+    mpz_init(candidate);
+
+    while (!atomic_load(&pool->done) && generate_prime_cancelable(candidate, pool->bits, &worker->rng, &pool->done))
+    {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->filled < 2 && (pool->filled == 0 || mpz_cmp(candidate, pool->primes[0]) != 0))
+        {
+            mpz_set(pool->primes[pool->filled++], candidate);
+            if (pool->filled == 2)
+                atomic_store(&pool->done, 1);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    mpz_clear(candidate);
+    return NULL;
+}
+
+/**
+ * @brief Ponto de entrada das threads criadas: busca e libera o motor de Miller-Rabin da thread.
+ */
+static void *prime_worker_thread(void *arg)
+{
+    prime_worker_run(arg);
+    mr_thread_engine_release();
+    return NULL;
+}
+
+/**
+ * @brief Número de threads da geração de primos (keygen_threads ou processadores online).
+ */
+int keygen_thread_count()
+{
+    if (keygen_threads > 0)
+        return keygen_threads;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+/**
+ * @brief Gera dois primos distintos de 'bits' bits em paralelo.
+ *
+ * Cada thread recebe um fluxo derivado de rng (drbg_fork) e busca primos
+ * com o crivo no seu próprio fluxo aleatório. A thread chamadora também trabalha;
+ * se a criação de alguma thread falhar, a busca segue com as que existirem.
+ *
+ * @param p Primeiro primo (saída).
+ * @param q Segundo primo (saída), diferente de p.
+ * @param bits Número de bits de cada primo.
+ * @param rng Gerador de onde derivam os fluxos das threads.
+ * @param threads Número de threads (incluindo a chamadora).
+ */
+void generate_prime_pair(mpz_t p, mpz_t q, int bits, drbg *rng, int threads)
+{
+    if (threads < 1)
+        threads = 1;
+
+    sieve_small_primes(); // Monta a tabela antes de as threads a consultarem
+
+    prime_pool pool;
+    pool.bits = bits;
+    pool.filled = 0;
+    atomic_init(&pool.done, 0);
+    pthread_mutex_init(&pool.lock, NULL);
+    mpz_inits(pool.primes[0], pool.primes[1], NULL);
+
+    prime_worker *workers = malloc(threads * sizeof(prime_worker));
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    int *started = calloc(threads, sizeof(int));
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i].pool = &pool;
+        drbg_fork(&workers[i].rng, rng);
+    }
+
+    for (int i = 1; i < threads; i++)
+        started[i] = pthread_create(&tids[i], NULL, prime_worker_thread, &workers[i]) == 0;
+    prime_worker_run(&workers[0]);
+    for (int i = 1; i < threads; i++)
+        if (started[i])
+            pthread_join(tids[i], NULL);
+
+    mpz_set(p, pool.primes[0]);
+    mpz_set(q, pool.primes[1]);
+
+    free(workers);
+    free(tids);
+    free(started);
+    mpz_clears(pool.primes[0], pool.primes[1], NULL);
+    pthread_mutex_destroy(&pool.lock);
+}
+
+/**
+ * @brief Calcula n, e = 65537 e d a partir de dois primos distintos.
+ * @param n Módulo RSA (saída).
+ * @param e Expoente público (saída).
+ * @param d Expoente privado (saída).
+ * @param p Primo p.
+ * @param q Primo q.
+ * @return 1 em sucesso, 0 se e não for coprimo com phi(n).
+ */
+int rsa_derive_exponents(mpz_t n, mpz_t e, mpz_t d, const mpz_t p, const mpz_t q)
+{
+    mpz_t phi, t;
+    mpz_inits(phi, t, NULL);
+
+    mpz_mul(n, p, q); // n = p * q
+
+    mpz_sub_ui(phi, p, 1);
+    mpz_sub_ui(t, q, 1);
+    mpz_mul(phi, phi, t); // phi = (p-1) * (q-1)
+
+    mpz_set_ui(e, 65537); // e = 65537
+
+    // Com mdc(e, phi) = 1, o inverso modular existe
+    int ok = mpz_invert(d, e, phi) != 0;
+
+    mpz_clears(phi, t, NULL);
+    return ok;
+}
+
+/**
+ * @brief Gera um par de chaves RSA (pública e privada).
+ * @param n Módulo RSA (saída).
+ * @param e Expoente público (saída).
+ * @param d Expoente privado (saída).
+ * @param p_out Primo p (saída opcional, pode ser NULL).
+ * @param q_out Primo q (saída opcional, pode ser NULL).
+ * @param bits Número de bits para o módulo n.
+ * @param rng Gerador de onde saem os primos.
+ */
+void generate_rsa_keys(mpz_t n, mpz_t e, mpz_t d, mpz_t p_out, mpz_t q_out, int bits, drbg *rng)
+{
+    mpz_t p, q;
+    mpz_inits(p, q, NULL);
+
+    // Se e e phi não forem coprimos, sorteia outro par
+    do
+    {
+        generate_prime_pair(p, q, bits / 2, rng, keygen_thread_count()); // Garante que p != q
+    } while (!rsa_derive_exponents(n, e, d, p, q));
+
+    if (p_out)
+        mpz_set(p_out, p);
+    if (q_out)
+        mpz_set(q_out, q);
+
+    mpz_clears(p, q, NULL);
+}
+
+/**
+ * @brief Função de Geração de Máscara (MGF1) para OAEP.
+ *
+ * A seed é absorvida uma única vez e o estado da esponja é guardado; cada bloco
+ * SHA3-256(seed || contador) parte de uma cópia desse estado e só absorve os 4
+ * bytes do contador. Os blocos completos da seed custam uma permutação no total,
+ * e não uma por contador.
+ *
+ * @param seed Seed para gerar a máscara.
+ * @param seed_len Comprimento da seed.
+ * @param mask Buffer para a máscara gerada (saída).
+ * @param mask_len Comprimento da máscara a ser gerada.
+ */
+void mgf1(const unsigned char *seed, size_t seed_len, unsigned char *mask, size_t mask_len)
+{
+    unsigned char counter[4];
+    size_t h_len = SHA3_256_DIGEST_SIZE;
+    size_t offset = 0;
+
+    keccak_sponge prefix;
+    keccak_init(&prefix, SHA3_256_RATE, SHA3_DOMAIN);
+    keccak_absorb(&prefix, seed, seed_len);
+
+    for (uint32_t i = 0; offset < mask_len; i++)
+    {
+        counter[0] = (i >> 24) & 0xFF;
+        counter[1] = (i >> 16) & 0xFF;
+        counter[2] = (i >> 8) & 0xFF;
+        counter[3] = i & 0xFF;
+
+        keccak_sponge sponge = prefix;
+        keccak_absorb(&sponge, counter, 4);
+        keccak_finalize(&sponge);
+
+        size_t copy_len = (offset + h_len <= mask_len) ? h_len : mask_len - offset;
+        keccak_squeeze(&sponge, mask + offset, copy_len);
+        offset += h_len;
+    }
+}
+
+static _Thread_local oaep_ctx thread_oaep_ctx;
+
+static const char *const sign_domain_labels[SIGN_DOMAIN_COUNT] = {"segcomp-plain", "segcomp-merkle-v1",
+                                                                  "segcomp-chunks-v1"};
+
+/**
+ * @brief Label OAEP de um domínio de assinatura.
+ */
+const char *sign_domain_label(sign_domain domain)
+{
+    return sign_domain_labels[domain];
+}
+
+/**
+ * @brief Prepara um contexto OAEP para módulos de k bytes, com o lHash de cada domínio.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int oaep_ctx_init(oaep_ctx *ctx, int k)
+{
+    unsigned int h_len = SHA3_256_DIGEST_SIZE;
+
+    memset(ctx, 0, sizeof(*ctx));
+    if (k < (int)(2 * h_len + 2))
+        return 0; // Módulo pequeno demais para OAEP
+    ctx->db_len = k - h_len - 1;
+    ctx->scratch = (unsigned char *)malloc(ctx->db_len);
+    if (!ctx->scratch)
+        return 0;
+    for (int d = 0; d < SIGN_DOMAIN_COUNT; d++)
+        sha3_256((const unsigned char *)sign_domain_labels[d], strlen(sign_domain_labels[d]), ctx->l_hash[d]);
+    ctx->k = k;
+    return 1;
+}
+
+/**
+ * @brief Libera o rascunho do contexto, apagando-o antes (contém a máscara do DB).
+ */
+void oaep_ctx_clear(oaep_ctx *ctx)
+{
+    if (ctx->scratch)
+    {
+        memset(ctx->scratch, 0, ctx->db_len);
+        free(ctx->scratch);
+    }
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+/**
+ * @brief Contexto OAEP da thread atual para módulos de k bytes.
+ *
+ * É refeito apenas quando o tamanho do módulo muda, então um lote de operações
+ * com a mesma chave não aloca nada depois da primeira.
+ *
+ * @return Ponteiro para o contexto, ou NULL em falha.
+ */
+oaep_ctx *oaep_thread_ctx(int k)
+{
+    oaep_ctx *ctx = &thread_oaep_ctx;
+    if (ctx->k != k)
+    {
+        oaep_ctx_clear(ctx);
+        if (!oaep_ctx_init(ctx, k))
+            return NULL;
+    }
+    return ctx;
+}
+
+/**
+ * @brief Libera o contexto OAEP da thread atual (chamar antes de a thread terminar).
+ */
+void oaep_thread_ctx_release()
+{
+    oaep_ctx_clear(&thread_oaep_ctx);
+}
+
+/**
+ * @brief Implementa o padding RSA-OAEP.
+ *
+ * EM = 0x00 || maskedSeed || maskedDB é montado direto em 'padded': a semente e o
+ * DB são escritos nas suas posições finais e mascarados no lugar.
+ *
+ * @param ctx Contexto OAEP do tamanho do módulo.
+ * @param domain Domínio da assinatura (define a label).
+ * @param message Mensagem a ser formatada.
+ * @param message_len Comprimento da mensagem.
+ * @param padded Buffer de saída com ctx->k bytes.
+ * @param rng Gerador da semente do OAEP.
+ * @return OAEP_OK em sucesso, OAEP_TOO_LONG se a mensagem não couber no módulo.
+ */
+oaep_status rsa_oaep_pad(oaep_ctx *ctx, sign_domain domain, const unsigned char *message, size_t message_len,
+                         unsigned char *padded, drbg *rng)
+{
+    size_t h_len = SHA3_256_DIGEST_SIZE;
+
+    if (message_len > ctx->db_len - h_len - 1)
+        return OAEP_TOO_LONG;
+
+    unsigned char *seed = padded + 1;
+    unsigned char *db = padded + 1 + h_len;
+    size_t ps_len = ctx->db_len - h_len - 1 - message_len;
+
+    // DB = lHash || PS || 0x01 || M
+    padded[0] = 0x00;
+    memcpy(db, ctx->l_hash[domain], h_len);
+    memset(db + h_len, 0, ps_len);
+    db[h_len + ps_len] = 0x01;
+    memcpy(db + h_len + ps_len + 1, message, message_len);
+
+    drbg_bytes(rng, seed, h_len);
+
+    mgf1(seed, h_len, ctx->scratch, ctx->db_len);
+    for (size_t i = 0; i < ctx->db_len; i++)
+    {
+        db[i] ^= ctx->scratch[i];
+    }
+
+    unsigned char seed_mask[SHA3_256_DIGEST_SIZE];
+    mgf1(db, ctx->db_len, seed_mask, h_len);
+    for (size_t i = 0; i < h_len; i++)
+    {
+        seed[i] ^= seed_mask[i];
+    }
+
+    return OAEP_OK;
+}
+
+/**
+ * @brief Remove o padding RSA-OAEP.
+ * @param ctx Contexto OAEP do tamanho do módulo.
+ * @param domain Domínio esperado (a label precisa ser a usada no padding).
+ * @param padded Mensagem formatada (ctx->k bytes).
+ * @param message Buffer para a mensagem original (saída).
+ * @param capacity Tamanho do buffer 'message'.
+ * @param message_len Ponteiro para o comprimento da mensagem (saída).
+ * @return OAEP_OK em sucesso, ou o motivo da rejeição.
+ */
+oaep_status rsa_oaep_unpad(oaep_ctx *ctx, sign_domain domain, const unsigned char *padded, unsigned char *message,
+                           size_t capacity, size_t *message_len)
+{
+    size_t h_len = SHA3_256_DIGEST_SIZE;
+    const unsigned char *masked_seed = padded + 1;
+    const unsigned char *masked_db = padded + 1 + h_len;
+
+    if (padded[0] != 0x00)
+        return OAEP_BAD_FIRST_BYTE;
+
+    unsigned char seed[SHA3_256_DIGEST_SIZE];
+    mgf1(masked_db, ctx->db_len, seed, h_len);
+    for (size_t i = 0; i < h_len; i++)
+    {
+        seed[i] ^= masked_seed[i];
+    }
+
+    // O DB é desmascarado sobre a própria máscara
+    unsigned char *db = ctx->scratch;
+    mgf1(seed, h_len, db, ctx->db_len);
+    for (size_t i = 0; i < ctx->db_len; i++)
+    {
+        db[i] ^= masked_db[i];
+    }
+
+    if (memcmp(db, ctx->l_hash[domain], h_len) != 0)
+        return OAEP_BAD_LABEL;
+
+    // Encontra o separador 0x01
+    size_t separator_idx = h_len;
+    while (separator_idx < ctx->db_len && db[separator_idx] == 0x00)
+    {
+        separator_idx++;
+    }
+
+    if (separator_idx == ctx->db_len || db[separator_idx] != 0x01)
+        return OAEP_NO_SEPARATOR;
+
+    *message_len = ctx->db_len - separator_idx - 1;
+    if (*message_len > capacity)
+        return OAEP_TOO_SMALL;
+    memcpy(message, db + separator_idx + 1, *message_len);
+
+    return OAEP_OK;
+}
+
+/**
+ * @brief Descrição de um resultado de rsa_oaep_pad ou rsa_oaep_unpad, para mensagens de erro.
+ */
+const char *oaep_status_message(oaep_status status)
+{
+    switch (status)
+    {
+    case OAEP_OK:
+        return "OK";
+    case OAEP_TOO_LONG:
+        return "Mensagem muito longa para OAEP";
+    case OAEP_BAD_FIRST_BYTE:
+        return "Primeiro byte diferente de zero";
+    case OAEP_BAD_LABEL:
+        return "lHash não corresponde";
+    case OAEP_NO_SEPARATOR:
+        return "Separador 0x01 não encontrado";
+    case OAEP_TOO_SMALL:
+        return "Mensagem maior que o buffer de saída";
+    }
+    return "Erro desconhecido";
+}
+
+// --- Chaves RSA ---
+
+/**
+ * @brief Inicializa uma chave RSA vazia.
+ */
+void rsa_key_init(rsa_key *key)
+{
+    mpz_inits(key->n, key->e, key->d, key->p, key->q, key->dp, key->dq, key->qinv, NULL);
+    key->is_private = 0;
+    key->has_crt = 0;
+    memset(key->fingerprint, 0, sizeof(key->fingerprint));
+    memset(&key->mont, 0, sizeof(key->mont));
+}
+
+/**
+ * @brief Libera os recursos de uma chave RSA.
+ */
+void rsa_key_clear(rsa_key *key)
+{
+    mpz_clears(key->n, key->e, key->d, key->p, key->q, key->dp, key->dq, key->qinv, NULL);
+    if (key->mont.n)
+        mont_ctx_clear(&key->mont);
+}
+
+/**
+ * @brief Calcula a impressão digital de uma chave: SHA3-256(n || e).
+ *
+ * n é serializado em k bytes big-endian (k = tamanho do módulo em bytes) e
+ * e na menor representação big-endian.
+ *
+ * @param n Módulo.
+ * @param e Expoente público.
+ * @param fingerprint Buffer de saída (32 bytes).
+ */
+void rsa_key_fingerprint(const mpz_t n, const mpz_t e, unsigned char *fingerprint)
+{
+    size_t n_len = mpz_sizeinbase(n, 256);
+    size_t e_len = mpz_sizeinbase(e, 256);
+    unsigned char *buffer = calloc(n_len + e_len, 1);
+    size_t count;
+
+    mpz_export(buffer, &count, 1, 1, 0, 0, n);
+    mpz_export(buffer + n_len, &count, 1, 1, 0, 0, e);
+    sha3_256(buffer, n_len + e_len, fingerprint);
+    free(buffer);
+}
+
+/**
+ * @brief Calcula dp, dq e qinv a partir de p, q e d.
+ */
+void rsa_key_compute_crt(rsa_key *key)
+{
+    mpz_t t;
+    mpz_init(t);
+    mpz_sub_ui(t, key->p, 1);
+    mpz_mod(key->dp, key->d, t);
+    mpz_sub_ui(t, key->q, 1);
+    mpz_mod(key->dq, key->d, t);
+    mpz_invert(key->qinv, key->q, key->p);
+    mpz_clear(t);
+    key->has_crt = 1;
+}
+
+/**
+ * @brief Recupera os primos p e q a partir de n, e e d.
+ *
+ * Usa o método probabilístico padrão: escrevendo e*d - 1 = 2^t * r, para uma
+ * base g, a sequência g^r, g^(2r), ... revela uma raiz quadrada não trivial de 1
+ * módulo n, cujo mdc com n é um fator.
+ *
+ * @return 1 em sucesso, 0 se nenhuma base revelou um fator.
+ */
+int rsa_recover_primes(const mpz_t n, const mpz_t e, const mpz_t d, mpz_t p, mpz_t q)
+{
+    mpz_t k, r, y, x, n_minus_1;
+    mpz_inits(k, r, y, x, n_minus_1, NULL);
+    mpz_sub_ui(n_minus_1, n, 1);
+
+    mpz_mul(k, e, d);
+    mpz_sub_ui(k, k, 1);
+    unsigned long t = mpz_scan1(k, 0);
+    mpz_tdiv_q_2exp(r, k, t);
+
+    int found = 0;
+    for (unsigned long g = 2; g < 100 && !found && t > 0; g++)
+    {
+        mpz_set_ui(x, g);
+        mpz_powm(y, x, r, n);
+        if (mpz_cmp_ui(y, 1) == 0 || mpz_cmp(y, n_minus_1) == 0)
+            continue;
+
+        for (unsigned long i = 0; i < t; i++)
+        {
+            mpz_powm_ui(x, y, 2, n);
+            if (mpz_cmp_ui(x, 1) == 0)
+            {
+                // y é raiz quadrada não trivial de 1
+                mpz_sub_ui(y, y, 1);
+                mpz_gcd(p, y, n);
+                mpz_divexact(q, n, p);
+                found = 1;
+                break;
+            }
+            if (mpz_cmp(x, n_minus_1) == 0)
+                break;
+            mpz_set(y, x);
+        }
+    }
+
+    mpz_clears(k, r, y, x, n_minus_1, NULL);
+    return found;
+}
+
+/**
+ * @brief Completa uma chave após carregar n, e (e d): calcula a impressão
+ * digital e o contexto de Montgomery.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int rsa_key_finalize(rsa_key *key)
+{
+    rsa_key_fingerprint(key->n, key->e, key->fingerprint);
+    return mont_ctx_init(&key->mont, key->n);
+}
+
+/**
+ * @brief Tamanho do módulo da chave em bits.
+ */
+int rsa_key_bits(const rsa_key *key)
+{
+    return (int)mpz_sizeinbase(key->n, 2);
+}
+
+/**
+ * @brief Tamanho do módulo da chave em bytes (k, no OAEP e nas assinaturas).
+ */
+int rsa_key_bytes(const rsa_key *key)
+{
+    return (rsa_key_bits(key) + 7) / 8;
+}
+
+/**
+ * @brief Operação privada RSA (assinatura): out = m^d mod n.
+ *
+ * Usa o Teorema Chinês do Resto quando os parâmetros CRT estão disponíveis,
+ * trocando uma exponenciação de |n| bits por duas de |n|/2 bits.
+ */
+void rsa_private_op(const rsa_key *key, mpz_t out, const mpz_t m)
+{
+    if (!key->has_crt)
+    {
+        mpz_powm(out, m, key->d, key->n);
+        return;
+    }
+
+    mpz_t sp, sq, h;
+    mpz_inits(sp, sq, h, NULL);
+    mpz_powm(sp, m, key->dp, key->p);
+    mpz_powm(sq, m, key->dq, key->q);
+
+    // Recombinação de Garner: s = sq + q * (qinv * (sp - sq) mod p)
+    mpz_sub(h, sp, sq);
+    mpz_mul(h, h, key->qinv);
+    mpz_mod(h, h, key->p);
+    mpz_mul(out, h, key->q);
+    mpz_add(out, out, sq);
+    mpz_clears(sp, sq, h, NULL);
+}
+
+/**
+ * @brief Operação privada RSA em lote (até MB_LANES mensagens com a mesma chave).
+ *
+ * Com AVX-512 IFMA e parâmetros CRT, as exponenciações módulo p e módulo q das
+ * mensagens do lote rodam em paralelo nas lanes SIMD; caso contrário, cada
+ * mensagem passa por rsa_private_op.
+ *
+ * @param key Chave privada.
+ * @param out Assinaturas (saída, count valores inicializados).
+ * @param in Mensagens formatadas (count valores).
+ * @param count Número de mensagens (1 a MB_LANES).
+ * @param use_ifma 0 para forçar o caminho do GMP.
+ * @return 1 se o caminho IFMA foi usado, 0 se foi usado o GMP.
+ */
+int rsa_private_op_batch(const rsa_key *key, mpz_t *out, mpz_t *in, int count, int use_ifma)
+{
+#ifdef MB_IFMA_BUILD
+    if (use_ifma && key->has_crt && count > 0 && count <= MB_LANES && mb_ifma_available())
+    {
+        mpz_t sp[MB_LANES], sq[MB_LANES], h;
+        for (int k = 0; k < count; k++)
+            mpz_inits(sp[k], sq[k], NULL);
+        mpz_init(h);
+
+        int ok = mb_powm_lanes(sp, in, count, key->dp, key->p) && mb_powm_lanes(sq, in, count, key->dq, key->q);
+        for (int k = 0; ok && k < count; k++)
+        {
+            // Recombinação de Garner, como em rsa_private_op
+            mpz_sub(h, sp[k], sq[k]);
+            mpz_mul(h, h, key->qinv);
+            mpz_mod(h, h, key->p);
+            mpz_mul(out[k], h, key->q);
+            mpz_add(out[k], out[k], sq[k]);
+        }
+
+        for (int k = 0; k < count; k++)
+            mpz_clears(sp[k], sq[k], NULL);
+        mpz_clear(h);
+        if (ok)
+            return 1;
+    }
+#else
+    (void)use_ifma;
+#endif
+
+    for (int k = 0; k < count; k++)
+        rsa_private_op(key, out[k], in[k]);
+    return 0;
+}
+
+// --- Assinatura de digest ---
+
+/**
+ * @brief Assina um digest SHA3-256 já calculado (padding OAEP + operação privada).
+ *
+ * É todo o trabalho do host de assinatura: o custo não depende do tamanho do
+ * artefato, que nunca precisa chegar até a chave.
+ *
+ * @param key Chave privada.
+ * @param domain Domínio da assinatura (SIGN_DOMAIN_PLAIN para arquivos assinados simples).
+ * @param digest Digest SHA3-256 (SHA3_256_DIGEST_SIZE bytes).
+ * @param signature Buffer de saída com rsa_key_bytes(key) bytes (big-endian, zeros à esquerda).
+ * @param rng Gerador da semente do OAEP.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int rsa_sign_digest(const rsa_key *key, sign_domain domain, const unsigned char *digest, unsigned char *signature,
+                    drbg *rng)
+{
+    int k = rsa_key_bytes(key);
+    oaep_ctx *oaep = oaep_thread_ctx(k);
+    if (!oaep)
+        return 0;
+
+    // Temporários da operação vêm da arena
+    arena_begin();
+    unsigned char *padded = (unsigned char *)arena_alloc(k);
+    double t = trace_start();
+    int ok = rsa_oaep_pad(oaep, domain, digest, SHA3_256_DIGEST_SIZE, padded, rng) == OAEP_OK;
+    trace_stop(TRACE_OAEP, t);
+    if (ok)
+    {
+        t = trace_start();
+        mpz_t m, s;
+        mpz_inits(m, s, NULL);
+        mpz_import(m, k, 1, sizeof(unsigned char), 0, 0, padded);
+        rsa_private_op(key, s, m);
+
+        size_t written;
+        memset(signature, 0, k);
+        mpz_export(signature + k - mpz_sizeinbase(s, 256), &written, 1, sizeof(unsigned char), 0, 0, s);
+        mpz_clears(m, s, NULL);
+        trace_stop(TRACE_MODEXP, t);
+    }
+    memset(padded, 0, k);
+    arena_free(padded, k);
+    arena_end();
+    return ok;
+}
+
+/**
+ * @brief Recupera o digest contido em uma assinatura (operação pública + remoção do OAEP).
+ *
+ * A assinatura é válida para um conteúdo quando o digest recuperado é igual ao
+ * SHA3-256 desse conteúdo.
+ *
+ * @param key Chave pública.
+ * @param domain Domínio esperado: assinaturas de outro domínio são rejeitadas.
+ * @param signature Assinatura (big-endian).
+ * @param signature_len Comprimento da assinatura.
+ * @param digest Digest recuperado (saída, SHA3_256_DIGEST_SIZE bytes).
+ * @return 1 em sucesso, 0 se a assinatura não tiver um padding OAEP válido no domínio.
+ */
+int rsa_recover_digest(const rsa_key *key, sign_domain domain, const unsigned char *signature, size_t signature_len,
+                       unsigned char *digest)
+{
+    int k = rsa_key_bytes(key);
+    oaep_ctx *oaep = oaep_thread_ctx(k);
+    if (!oaep)
+        return 0;
+
+    arena_begin();
+    unsigned char *padded = (unsigned char *)arena_alloc(k);
+    memset(padded, 0, k);
+    int decrypted = 0;
+    double t = trace_start();
+
+    if (mpz_cmp_ui(key->e, 65537) == 0)
+    {
+        // Caminho rápido: e = 65537 no domínio de Montgomery
+        decrypted = rsa_verify_e65537(&key->mont, signature, signature_len, padded, k);
+    }
+    else
+    {
+        mpz_t s, m;
+        mpz_inits(s, m, NULL);
+        mpz_import(s, signature_len, 1, sizeof(unsigned char), 0, 0, signature);
+        mpz_powm(m, s, key->e, key->n);
+
+        // Garantir que a saída tenha o tamanho k (zeros à esquerda)
+        size_t m_len = mpz_sizeinbase(m, 256);
+        if (m_len <= (size_t)k)
+        {
+            size_t written;
+            mpz_export(padded + k - m_len, &written, 1, sizeof(unsigned char), 0, 0, m);
+            decrypted = 1;
+        }
+        mpz_clears(s, m, NULL);
+    }
+    trace_stop(TRACE_MODEXP, t);
+
+    t = trace_start();
+    size_t digest_len = 0;
+    int ok = decrypted &&
+             rsa_oaep_unpad(oaep, domain, padded, digest, SHA3_256_DIGEST_SIZE, &digest_len) == OAEP_OK &&
+             digest_len == SHA3_256_DIGEST_SIZE;
+    trace_stop(TRACE_OAEP, t);
+    arena_free(padded, k);
+    arena_end();
+    return ok;
+}
+
+// --- Pool de chaves pré-geradas ---
+
+#define KEYPOOL_REFILL_NICE 19 // Prioridade mínima para as threads de reposição
+
+/**
+ * @brief Gera uma chave privada completa (com CRT, impressão digital e Montgomery).
+ * @return 1 em sucesso, 0 em falha.
+ */
+int rsa_key_generate(rsa_key *key, int bits, drbg *rng, int threads)
+{
+    do
+    {
+        generate_prime_pair(key->p, key->q, bits / 2, rng, threads);
+    } while (!rsa_derive_exponents(key->n, key->e, key->d, key->p, key->q));
+
+    key->is_private = 1;
+    rsa_key_compute_crt(key);
+    return rsa_key_finalize(key);
+}
+
+/**
+ * @brief Laço de uma thread de reposição: gera chaves enquanto houver espaço no pool.
+ */
+static void *keypool_refill_run(void *arg)
+{
+    keypool *pool = (keypool *)arg;
+
+#ifdef __linux__
+    // No Linux, a prioridade é por thread
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), KEYPOOL_REFILL_NICE);
+#endif
+
+    // Gerador próprio da thread, semeado com entropia do sistema
+    drbg *rng = thread_rng();
+    if (!rng)
+    {
+        // Sem canal de erro numa thread de fundo: a falha aparece nas métricas
+        pthread_mutex_lock(&pool->lock);
+        pool->failed_refillers++;
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->running && pool->count + pool->pending >= pool->depth)
+            pthread_cond_wait(&pool->not_full, &pool->lock);
+        int running = pool->running;
+        if (running)
+            pool->pending++;
+        pthread_mutex_unlock(&pool->lock);
+        if (!running)
+            break;
+
+        rsa_key key;
+        rsa_key_init(&key);
+        double start = monotonic_seconds();
+        int ok = rsa_key_generate(&key, pool->bits, rng, 1);
+        double elapsed = monotonic_seconds() - start;
+
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        pool->generate_seconds += elapsed;
+        if (ok && pool->running)
+        {
+            pool->keys[(pool->head + pool->count) % pool->depth] = key; // Movida sem cópia profunda
+            pool->count++;
+            pool->generated++;
+            pthread_cond_signal(&pool->not_empty);
+            ok = 2;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if (ok != 2)
+            rsa_key_clear(&key);
+    }
+    mr_thread_engine_release();
+    thread_rng_release();
+    return NULL;
+}
+
+/**
+ * @brief Inicia um pool de 'depth' chaves de 'bits' bits com 'refillers' threads de reposição.
+ * @return 1 em sucesso, 0 em falha (errno = EINVAL para parâmetros inválidos, ENOMEM ou o erro de
+ *         pthread_create).
+ */
+int keypool_start(keypool *pool, int depth, int bits, int refillers)
+{
+    if (depth <= 0 || depth > KEYPOOL_MAX_DEPTH || refillers <= 0 || refillers > KEYPOOL_MAX_REFILLERS)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->keys = malloc(depth * sizeof(rsa_key));
+    if (!pool->keys)
+    {
+        errno = ENOMEM;
+        return 0;
+    }
+    pool->depth = depth;
+    pool->bits = bits;
+    pool->running = 1;
+    pool->started = monotonic_seconds();
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+
+    sieve_small_primes(); // Monta a tabela antes de as threads a consultarem
+    int create_error = 0;
+    for (int i = 0; i < refillers; i++)
+    {
+        int rc = pthread_create(&pool->refillers[pool->refiller_count], NULL, keypool_refill_run, pool);
+        if (rc == 0)
+            pool->refiller_count++;
+        else
+            create_error = rc;
+    }
+    if (pool->refiller_count == 0)
+    {
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->not_full);
+        pthread_cond_destroy(&pool->not_empty);
+        free(pool->keys);
+        pool->keys = NULL;
+        errno = create_error;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Para as threads de reposição e libera as chaves restantes.
+ */
+void keypool_stop(keypool *pool)
+{
+    if (!pool->keys)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->running = 0;
+    pthread_cond_broadcast(&pool->not_full);
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    // Uma thread no meio de uma geração termina a chave atual antes de sair
+    for (int i = 0; i < pool->refiller_count; i++)
+        pthread_join(pool->refillers[i], NULL);
+
+    for (int i = 0; i < pool->count; i++)
+        rsa_key_clear(&pool->keys[(pool->head + i) % pool->depth]);
+    free(pool->keys);
+    pool->keys = NULL;
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->not_full);
+    pthread_cond_destroy(&pool->not_empty);
+}
+
+/**
+ * @brief Retira uma chave do pool, esperando a reposição se ele estiver vazio.
+ * @param pool Pool em execução.
+ * @param key Chave de saída (não inicializada; liberar com rsa_key_clear).
+ * @return 1 em sucesso, 0 se o pool foi parado.
+ */
+int keypool_take(keypool *pool, rsa_key *key)
+{
+    double start = monotonic_seconds();
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == 0)
+        pool->waits++;
+    while (pool->running && pool->count == 0)
+        pthread_cond_wait(&pool->not_empty, &pool->lock);
+    if (pool->count == 0)
+    {
+        pthread_mutex_unlock(&pool->lock);
+        return 0;
+    }
+
+    *key = pool->keys[pool->head];
+    pool->head = (pool->head + 1) % pool->depth;
+    pool->count--;
+    pool->provisioned++;
+    pool->provision_seconds += monotonic_seconds() - start;
+    pthread_cond_signal(&pool->not_full);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+/**
+ * @brief Imprime as métricas do pool: profundidade, reposição e provisionamento.
+ */
+void keypool_print_metrics(FILE *out, keypool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    double uptime = monotonic_seconds() - pool->started;
+    fprintf(out, "Profundidade: %d/%d chave(s) de %d bits\n", pool->count, pool->depth, pool->bits);
+    fprintf(out, "Threads de reposição: %d (nice %d)\n", pool->refiller_count, KEYPOOL_REFILL_NICE);
+    if (pool->failed_refillers > 0)
+        fprintf(out, "Threads de reposição encerradas sem fonte de entropia: %d\n", pool->failed_refillers);
+    fprintf(out, "Chaves geradas: %lu | provisionadas: %lu | provisionamentos com espera: %lu\n", pool->generated,
+            pool->provisioned, pool->waits);
+    fprintf(out, "Taxa de reposição: %.2f chave(s)/s (média desde o início, %.1f s)\n",
+            uptime > 0 ? pool->generated / uptime : 0.0, uptime);
+    if (pool->generated > 0)
+        fprintf(out, "Tempo médio de geração por chave: %.1f ms\n", pool->generate_seconds * 1e3 / pool->generated);
+    if (pool->provisioned > 0)
+        fprintf(out, "Latência média de provisionamento: %.3f ms\n",
+                pool->provision_seconds * 1e3 / pool->provisioned);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// --- Arquivos de chave ---
+
+/**
+ * @brief Lê o conteúdo completo de um arquivo.
+ * @param filename Nome do arquivo.
+ * @param buffer Ponteiro para o buffer que armazenará o conteúdo.
+ * @param len Ponteiro para o tamanho do conteúdo lido.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int read_file_content(const char *filename, unsigned char **buffer, size_t *len)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    *buffer = malloc(*len);
+    if (!*buffer)
+    {
+        fclose(f);
+        return 0;
+    }
+    if (fread(*buffer, 1, *len, f) != *len)
+    {
+        free(*buffer);
+        fclose(f);
+        return 0;
+    }
+    fclose(f);
+    return 1;
+}
+
+/**
+ * @brief Salva n e um expoente em um arquivo de chave hexadecimal.
+ * @param filename Nome do arquivo.
+ * @param n Módulo n.
+ * @param exp Expoente e ou d.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int save_key_hex(const char *filename, const mpz_t n, const mpz_t exp)
+{
+    FILE *f = fopen(filename, "w");
+    if (!f)
+        return 0;
+
+    char *n_str = mpz_get_str(NULL, 16, n);
+    char *exp_str = mpz_get_str(NULL, 16, exp);
+    fprintf(f, "%s\n%s", n_str, exp_str);
+    fclose(f);
+
+    arena_free(n_str, strlen(n_str) + 1);
+    arena_free(exp_str, strlen(exp_str) + 1);
+    return 1;
+}
+
+/**
+ * @brief Lê n e um expoente de um texto de chave hexadecimal em memória.
+ * @param data Texto da chave (dois números hexadecimais separados por espaço ou quebra de linha).
+ * @param len Comprimento do texto.
+ * @param n Módulo n (saída).
+ * @param exp Expoente e ou d (saída).
+ * @return 1 em sucesso, 0 em falha.
+ */
+int parse_key_hex(const unsigned char *data, size_t len, mpz_t n, mpz_t exp)
+{
+    char *text = (char *)malloc(len + 1);
+    if (!text)
+        return 0;
+    memcpy(text, data, len);
+    text[len] = '\0';
+
+    char *save;
+    char *n_str = strtok_r(text, " \t\r\n", &save);
+    char *exp_str = n_str ? strtok_r(NULL, " \t\r\n", &save) : NULL;
+    int ok = exp_str && mpz_set_str(n, n_str, 16) == 0 && mpz_set_str(exp, exp_str, 16) == 0;
+
+    memset(text, 0, len); // Pode conter d
+    free(text);
+    return ok;
+}
+
+/**
+ * @brief Carrega uma chave RSA (pública ou privada) de um arquivo.
+ * @param filename Nome do arquivo da chave.
+ * @param n Módulo n (saída).
+ * @param exp Expoente e ou d (saída).
+ * @return 1 em sucesso, 0 em falha.
+ */
+int load_key(const char *filename, mpz_t n, mpz_t exp)
+{
+    unsigned char *data;
+    size_t len;
+    if (!read_file_content(filename, &data, &len))
+        return 0;
+
+    int ok = parse_key_hex(data, len, n, exp);
+    memset(data, 0, len);
+    free(data);
+    return ok;
+}
+
+/**
+ * @brief Verifica se 'bits' é um dos tamanhos de módulo aceitos (key_sizes).
+ */
+int key_size_supported(int bits)
+{
+    for (int i = 0; i < KEY_SIZE_COUNT; i++)
+        if (key_sizes[i] == bits)
+            return 1;
+    return 0;
+}
+
+// --- Formato binário de chaves ---
+//
+// Cabeçalho (KEY_BIN_HEADER_SIZE bytes):
+//   0  magic "RSAK"         4  versão (u8)          5  tipo (u8)
+//   6  flags (u16)          8  bits de n (u32)      12 limbs de n (u32)
+//   16 limbs de p/q (u32)   20 reservado (u32)      24 e (u64)
+//   32 n0inv (u64)          40 impressão digital SHA3-256(n || e)
+// Corpo: n, [d], [p, q, dp, dq, qinv], cada um com largura fixa de limbs de
+// 64 bits em big-endian. Por fim, SHA3-256 de todos os bytes anteriores.
+// R^2 mod n não é gravado: a carga o recalcula a partir de n (versão 2).
+
+static void put_be32(unsigned char *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (v >> (24 - 8 * i)) & 0xFF;
+}
+
+static void put_be64(unsigned char *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (v >> (56 - 8 * i)) & 0xFF;
+}
+
+static uint32_t get_be32(const unsigned char *p)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t get_be64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+/**
+ * @brief Escreve z em exatamente nl limbs de 64 bits big-endian.
+ */
+static void put_mpz_limbs(unsigned char *p, const mpz_t z, size_t nl)
+{
+    size_t count;
+    size_t width = nl * 8;
+    size_t len = mpz_sizeinbase(z, 256);
+    memset(p, 0, width);
+    mpz_export(p + width - len, &count, 1, 1, 0, 0, z);
+}
+
+/**
+ * @brief Serializa uma chave no formato binário.
+ * @param key Chave (com contexto de Montgomery e impressão digital calculados).
+ * @param is_private 1 para incluir também d e os parâmetros CRT.
+ * @param len Tamanho do buffer gerado (saída).
+ * @return Buffer alocado com malloc (liberar com free), ou NULL em falha.
+ */
+unsigned char *rsa_key_to_binary(const rsa_key *key, int is_private, size_t *len)
+{
+    if (is_private && !key->is_private)
+        return NULL;
+
+    size_t nl = key->mont.nlimbs;
+    int with_crt = is_private && key->has_crt;
+    size_t hl = 0;
+    if (with_crt)
+        hl = mpz_size(key->p) > mpz_size(key->q) ? mpz_size(key->p) : mpz_size(key->q);
+
+    size_t total = KEY_BIN_HEADER_SIZE + nl * 8 + (is_private ? nl * 8 : 0) + 5 * hl * 8 + SHA3_256_DIGEST_SIZE;
+    unsigned char *buffer = calloc(total, 1);
+    if (!buffer)
+        return NULL;
+
+    memcpy(buffer, KEY_BIN_MAGIC, 4);
+    buffer[4] = KEY_BIN_VERSION;
+    buffer[5] = is_private ? KEY_BIN_TYPE_PRIVATE : KEY_BIN_TYPE_PUBLIC;
+    buffer[6] = 0;
+    buffer[7] = with_crt ? KEY_BIN_FLAG_CRT : 0;
+    put_be32(buffer + 8, mpz_sizeinbase(key->n, 2));
+    put_be32(buffer + 12, nl);
+    put_be32(buffer + 16, hl);
+    put_be64(buffer + 24, mpz_get_ui(key->e));
+    put_be64(buffer + 32, key->mont.n0inv);
+    memcpy(buffer + 40, key->fingerprint, SHA3_256_DIGEST_SIZE);
+
+    unsigned char *p = buffer + KEY_BIN_HEADER_SIZE;
+    for (size_t i = 0; i < nl; i++)
+        put_be64(p + (nl - 1 - i) * 8, key->mont.n[i]);
+    p += nl * 8;
+
+    if (is_private)
+    {
+        put_mpz_limbs(p, key->d, nl);
+        p += nl * 8;
+    }
+    if (with_crt)
+    {
+        const mpz_srcptr crt[5] = {key->p, key->q, key->dp, key->dq, key->qinv};
+        for (int i = 0; i < 5; i++)
+        {
+            put_mpz_limbs(p, crt[i], hl);
+            p += hl * 8;
+        }
+    }
+    sha3_256(buffer, p - buffer, p);
+    *len = total;
+    return buffer;
+}
+
+/**
+ * @brief Salva uma chave no formato binário.
+ * @param filename Nome do arquivo.
+ * @param key Chave (com contexto de Montgomery e impressão digital calculados).
+ * @param is_private 1 para gravar também d e os parâmetros CRT.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int save_key_binary(const char *filename, const rsa_key *key, int is_private)
+{
+    size_t total;
+    unsigned char *buffer = rsa_key_to_binary(key, is_private, &total);
+    if (!buffer)
+        return 0;
+
+    FILE *f = fopen(filename, "wb");
+    int ok = f && fwrite(buffer, 1, total, f) == total;
+    if (f)
+        ok = fclose(f) == 0 && ok;
+    memset(buffer, 0, total);
+    free(buffer);
+    return ok;
+}
+
+/**
+ * @brief Carrega e valida uma chave no formato binário a partir da memória.
+ *
+ * O SHA3-256 final não tem chave: só detecta corrupção acidental, e qualquer um
+ * pode recalculá-lo. Por isso os campos derivados não são tomados como
+ * confiáveis: o contexto de Montgomery é recalculado a partir de n (n0inv do
+ * cabeçalho precisa coincidir) e, com CRT, confere-se p * q = n, dp = d mod (p - 1),
+ * dq = d mod (q - 1) e qinv * q = 1 mod p.
+ *
+ * @param key Chave inicializada com rsa_key_init (saída).
+ * @param buffer Chave serializada.
+ * @param len Tamanho de buffer.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int rsa_key_from_binary(rsa_key *key, const unsigned char *buffer, size_t len)
+{
+    int ok = 0;
+    if (len < KEY_BIN_HEADER_SIZE + SHA3_256_DIGEST_SIZE || memcmp(buffer, KEY_BIN_MAGIC, 4) != 0 ||
+        buffer[4] != KEY_BIN_VERSION)
+        goto done;
+
+    int type = buffer[5];
+    uint32_t flags = ((uint32_t)buffer[6] << 8) | buffer[7];
+    uint32_t bits = get_be32(buffer + 8);
+    size_t nl = get_be32(buffer + 12);
+    size_t hl = get_be32(buffer + 16);
+    uint64_t e = get_be64(buffer + 24);
+    mp_limb_t n0inv = get_be64(buffer + 32);
+    int is_private = type == KEY_BIN_TYPE_PRIVATE;
+    int with_crt = (flags & KEY_BIN_FLAG_CRT) != 0;
+
+    if ((type != KEY_BIN_TYPE_PUBLIC && !is_private) || (flags & ~KEY_BIN_FLAG_CRT) ||
+        (with_crt && (!is_private || hl == 0 || hl > nl)) || (!with_crt && hl != 0) ||
+        nl == 0 || nl > KEY_BIN_MAX_LIMBS || (e & 1) == 0)
+        goto done;
+
+    size_t expected = KEY_BIN_HEADER_SIZE + nl * 8 + (is_private ? nl * 8 : 0) + 5 * hl * 8 + SHA3_256_DIGEST_SIZE;
+    if (len != expected)
+        goto done;
+
+    unsigned char checksum[SHA3_256_DIGEST_SIZE];
+    sha3_256(buffer, len - SHA3_256_DIGEST_SIZE, checksum);
+    if (memcmp(checksum, buffer + len - SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE) != 0)
+        goto done;
+
+    // Contexto de Montgomery recalculado a partir de n
+    const unsigned char *p = buffer + KEY_BIN_HEADER_SIZE;
+    mpz_import(key->n, nl * 8, 1, 1, 0, 0, p);
+    mpz_set_ui(key->e, e);
+    if (mpz_size(key->n) != nl || mpz_sizeinbase(key->n, 2) != bits || !mont_ctx_init(&key->mont, key->n) ||
+        key->mont.n0inv != n0inv)
+        goto done;
+    p += nl * 8;
+
+    if (is_private)
+    {
+        mpz_import(key->d, nl * 8, 1, 1, 0, 0, p);
+        p += nl * 8;
+        key->is_private = 1;
+    }
+    if (with_crt)
+    {
+        mpz_ptr crt[5] = {key->p, key->q, key->dp, key->dq, key->qinv};
+        for (int i = 0; i < 5; i++)
+        {
+            mpz_import(crt[i], hl * 8, 1, 1, 0, 0, p);
+            p += hl * 8;
+        }
+
+        // p * q = n e dp, dq, qinv derivados de p, q e d
+        mpz_t t, pm1;
+        mpz_inits(t, pm1, NULL);
+        mpz_mul(t, key->p, key->q);
+        int consistent = mpz_cmp(t, key->n) == 0 && mpz_cmp_ui(key->p, 1) > 0 && mpz_cmp_ui(key->q, 1) > 0;
+        if (consistent)
+        {
+            mpz_sub_ui(pm1, key->p, 1);
+            mpz_mod(t, key->d, pm1);
+            consistent = mpz_cmp(t, key->dp) == 0;
+            mpz_sub_ui(pm1, key->q, 1);
+            mpz_mod(t, key->d, pm1);
+            consistent &= mpz_cmp(t, key->dq) == 0;
+            mpz_mul(t, key->qinv, key->q);
+            mpz_mod(t, t, key->p);
+            consistent &= mpz_cmp_ui(t, 1) == 0 && mpz_cmp(key->qinv, key->p) < 0;
+        }
+        mpz_clears(t, pm1, NULL);
+        if (!consistent)
+            goto done;
+        key->has_crt = 1;
+    }
+
+    rsa_key_fingerprint(key->n, key->e, key->fingerprint);
+    ok = memcmp(key->fingerprint, buffer + 40, SHA3_256_DIGEST_SIZE) == 0;
+
+done:
+    return ok;
+}
+
+/**
+ * @brief Carrega e valida uma chave no formato binário (uma única leitura do arquivo).
+ * @param filename Nome do arquivo.
+ * @param key Chave inicializada com rsa_key_init (saída).
+ * @return 1 em sucesso, 0 em falha.
+ */
+int load_key_binary(const char *filename, rsa_key *key)
+{
+    unsigned char *buffer;
+    size_t len;
+    if (!read_file_content(filename, &buffer, &len))
+        return 0;
+
+    int ok = rsa_key_from_binary(key, buffer, len);
+    memset(buffer, 0, len);
+    free(buffer);
+    return ok;
+}
+
+/**
+ * @brief Verifica se um arquivo está no formato binário de chaves.
+ */
+int is_binary_key_file(const char *filename)
+{
+    unsigned char magic[4];
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        return 0;
+    int is_binary = fread(magic, 1, 4, f) == 4 && memcmp(magic, KEY_BIN_MAGIC, 4) == 0;
+    fclose(f);
+    return is_binary;
+}
+
+/**
+ * @brief Carrega uma chave em memória, em qualquer formato (hexadecimal ou binário).
+ *
+ * O formato é reconhecido pela assinatura "RSAK" do binário. A chave privada
+ * hexadecimal não guarda e; nesse caso assume-se e = 65537, o valor sempre
+ * usado por generate_rsa_keys.
+ *
+ * @param key Chave inicializada com rsa_key_init (saída).
+ * @param data Conteúdo do arquivo de chave.
+ * @param len Tamanho do conteúdo.
+ * @param want_private 1 se a chave deve conter d.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int rsa_key_load_memory(rsa_key *key, const unsigned char *data, size_t len, int want_private)
+{
+    if (len >= 4 && memcmp(data, KEY_BIN_MAGIC, 4) == 0)
+        return rsa_key_from_binary(key, data, len) && (!want_private || key->is_private);
+
+    if (!parse_key_hex(data, len, key->n, want_private ? key->d : key->e))
+        return 0;
+    if (want_private)
+    {
+        mpz_set_ui(key->e, 65537);
+        key->is_private = 1;
+    }
+    return rsa_key_finalize(key);
+}
+
+/**
+ * @brief Carrega uma chave de um arquivo em qualquer formato (hexadecimal ou binário).
+ * @param filename Nome do arquivo da chave.
+ * @param key Chave inicializada com rsa_key_init (saída).
+ * @param want_private 1 se a chave deve conter d.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int load_rsa_key(const char *filename, rsa_key *key, int want_private)
+{
+    unsigned char *data;
+    size_t len;
+    if (!read_file_content(filename, &data, &len))
+        return 0;
+
+    int ok = rsa_key_load_memory(key, data, len, want_private);
+    memset(data, 0, len);
+    free(data);
+    return ok;
+}
+
+// --- Keyring indexado por impressão digital ---
+
+/**
+ * @brief Converte bytes em uma string hexadecimal minúscula.
+ * @param bytes Dados de entrada.
+ * @param len Comprimento dos dados.
+ * @param hex Buffer de saída (2 * len + 1 bytes).
+ */
+void bytes_to_hex(const unsigned char *bytes, size_t len, char *hex)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++)
+    {
+        hex[2 * i] = digits[bytes[i] >> 4];
+        hex[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+    hex[2 * len] = '\0';
+}
+
+/**
+ * @brief Converte uma string hexadecimal em bytes.
+ * @param hex String de entrada (exatamente 2 * len dígitos).
+ * @param bytes Buffer de saída.
+ * @param len Número de bytes esperados.
+ * @return 1 em sucesso, 0 se a string for inválida.
+ */
+int hex_to_bytes(const char *hex, unsigned char *bytes, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int byte;
+        if (!isxdigit((unsigned char)hex[2 * i]) || !isxdigit((unsigned char)hex[2 * i + 1]) ||
+            sscanf(hex + 2 * i, "%2x", &byte) != 1)
+            return 0;
+        bytes[i] = byte;
+    }
+    return !isxdigit((unsigned char)hex[2 * len]);
+}
+
+static size_t keyring_slot(const keyring *kr, const unsigned char *fingerprint)
+{
+    uint64_t h;
+    memcpy(&h, fingerprint, sizeof(h));
+    return h & (kr->capacity - 1);
+}
+
+/**
+ * @brief Busca uma chave pela impressão digital em O(1).
+ * @return Ponteiro para a chave, ou NULL se não estiver no keyring.
+ */
+const rsa_key *keyring_find(const keyring *kr, const unsigned char *fingerprint)
+{
+    if (kr->capacity == 0)
+        return NULL;
+
+    for (size_t i = keyring_slot(kr, fingerprint);; i = (i + 1) & (kr->capacity - 1))
+    {
+        if (kr->slots[i] == 0)
+            return NULL;
+        const rsa_key *key = &kr->keys[kr->slots[i] - 1];
+        if (memcmp(key->fingerprint, fingerprint, SHA3_256_DIGEST_SIZE) == 0)
+            return key;
+    }
+}
+
+/**
+ * @brief Libera um keyring.
+ */
+void keyring_clear(keyring *kr)
+{
+    for (size_t i = 0; i < kr->count; i++)
+        rsa_key_clear(&kr->keys[i]);
+    free(kr->keys);
+    free(kr->slots);
+    memset(kr, 0, sizeof(*kr));
+}
+
+/**
+ * @brief Carrega todas as chaves públicas (hexadecimais ou binárias) de um diretório.
+ *
+ * Arquivos que não são chaves válidas são ignorados, assim como chaves
+ * repetidas (mesma impressão digital).
+ *
+ * @param kr Keyring de saída.
+ * @param dirname Caminho do diretório.
+ * @return 1 em sucesso, 0 se o diretório não puder ser lido ou faltar memória.
+ */
+int keyring_load(keyring *kr, const char *dirname)
+{
+    memset(kr, 0, sizeof(*kr));
+    DIR *dir = opendir(dirname);
+    if (!dir)
+        return 0;
+
+    size_t alloc = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        char path[4096];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dirname, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        if (kr->count == alloc)
+        {
+            size_t grown = alloc ? alloc * 2 : 16;
+            rsa_key *keys = realloc(kr->keys, grown * sizeof(rsa_key));
+            if (!keys)
+            {
+                closedir(dir);
+                keyring_clear(kr);
+                return 0;
+            }
+            kr->keys = keys;
+            alloc = grown;
+        }
+        rsa_key *key = &kr->keys[kr->count];
+        rsa_key_init(key);
+        if (load_rsa_key(path, key, 0))
+            kr->count++;
+        else
+            rsa_key_clear(key);
+    }
+    closedir(dir);
+
+    // Fator de carga <= 1/2
+    kr->capacity = 1;
+    while (kr->capacity < 2 * kr->count)
+        kr->capacity <<= 1;
+    kr->slots = calloc(kr->capacity, sizeof(size_t));
+    if (!kr->slots)
+    {
+        keyring_clear(kr);
+        return 0;
+    }
+
+    size_t unique = 0;
+    for (size_t i = 0; i < kr->count; i++)
+    {
+        rsa_key *key = &kr->keys[i];
+        if (keyring_find(kr, key->fingerprint))
+        {
+            rsa_key_clear(key);
+            continue;
+        }
+        if (unique != i)
+            kr->keys[unique] = *key; // mpz_t e mont_ctx são movidos sem cópia profunda
+
+        size_t slot = keyring_slot(kr, key->fingerprint);
+        while (kr->slots[slot] != 0)
+            slot = (slot + 1) & (kr->capacity - 1);
+        kr->slots[slot] = ++unique;
+    }
+    kr->count = unique;
+    return 1;
+}
+
+// --- Arquivo assinado ---
+
+/**
+ * @brief Função wrapper para calcular SHA3-256.
+ * @param input Dados de entrada.
+ * @param input_len Comprimento dos dados.
+ * @param output Ponteiro para o buffer do hash (será alocado).
+ * @param output_len Ponteiro para o comprimento do hash.
+ */
+void sha3_hash(const unsigned char *input, size_t input_len, unsigned char **output, unsigned int *output_len)
+{
+    *output = malloc(SHA3_256_DIGEST_SIZE);
+    sha3_256(input, input_len, *output);
+    *output_len = SHA3_256_DIGEST_SIZE;
+}
+
+/**
+ * @brief Monta o texto de um arquivo assinado (.signed) com os cabeçalhos da impressão digital e do tamanho da chave.
+ * @param key Chave usada na assinatura.
+ * @param content_b64 Conteúdo em Base64.
+ * @param sig_b64 Assinatura em Base64.
+ * @param len Tamanho do texto gerado (saída).
+ * @return Texto alocado com malloc (liberar com free), ou NULL em falha.
+ */
+char *signed_file_format(const rsa_key *key, const char *content_b64, const char *sig_b64, size_t *len)
+{
+    char fingerprint_hex[2 * SHA3_256_DIGEST_SIZE + 1];
+    bytes_to_hex(key->fingerprint, SHA3_256_DIGEST_SIZE, fingerprint_hex);
+
+    const char *format = "%s%s\n%s%d\n-----BEGIN SIGNED MESSAGE-----\n%s\n"
+                         "-----BEGIN SIGNATURE-----\n%s\n-----END SIGNATURE-----\n";
+    int bits = rsa_key_bits(key);
+    int total = snprintf(NULL, 0, format, FINGERPRINT_HEADER, fingerprint_hex, KEY_BITS_HEADER, bits, content_b64,
+                         sig_b64);
+    char *text = total < 0 ? NULL : (char *)malloc(total + 1);
+    if (!text)
+        return NULL;
+    snprintf(text, total + 1, format, FINGERPRINT_HEADER, fingerprint_hex, KEY_BITS_HEADER, bits, content_b64,
+             sig_b64);
+    *len = total;
+    return text;
+}
+
+/**
+ * @brief Grava um arquivo assinado (.signed) com os cabeçalhos da impressão digital e do tamanho da chave.
+ * @param signed_filename Nome do arquivo de saída.
+ * @param key Chave usada na assinatura.
+ * @param content_b64 Conteúdo em Base64.
+ * @param sig_b64 Assinatura em Base64.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int write_signed_file(const char *signed_filename, const rsa_key *key, const char *content_b64, const char *sig_b64)
+{
+    size_t len;
+    char *text = signed_file_format(key, content_b64, sig_b64, &len);
+    if (!text)
+        return 0;
+
+    FILE *out_file = fopen(signed_filename, "w");
+    int ok = out_file && fwrite(text, 1, len, out_file) == len;
+    if (out_file)
+        ok = fclose(out_file) == 0 && ok;
+    free(text);
+    return ok;
+}
+
+#define CHUNK_LABEL "segcomp-chunked-v1"
+#define CHUNK_INDEX_BEGIN "-----BEGIN CHUNK INDEX-----"
+#define CHUNK_INDEX_END "-----END CHUNK INDEX-----"
+
+/**
+ * @brief Valor assinado no modo por blocos:
+ *        SHA3-256(rótulo || tamanho do bloco || tamanho da mensagem || digests dos blocos),
+ *        com os tamanhos em 64 bits big-endian.
+ */
+static void chunked_signed_digest(const chunk_index *idx, uint64_t content_len, unsigned char *out)
+{
+    unsigned char sizes[16];
+    for (int i = 0; i < 8; i++)
+    {
+        sizes[i] = (idx->chunk_size >> (56 - 8 * i)) & 0xFF;
+        sizes[8 + i] = (content_len >> (56 - 8 * i)) & 0xFF;
+    }
+
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHA3_DOMAIN);
+    keccak_absorb(&sponge, (const unsigned char *)CHUNK_LABEL, strlen(CHUNK_LABEL));
+    keccak_absorb(&sponge, sizes, sizeof(sizes));
+    keccak_absorb(&sponge, idx->digests, idx->count * SHA3_256_DIGEST_SIZE);
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, out, SHA3_256_DIGEST_SIZE);
+}
+
+/**
+ * @brief Número de blocos de uma mensagem de 'content_len' bytes.
+ */
+static uint64_t chunk_count_for(uint64_t content_len, uint64_t chunk_size)
+{
+    return content_len / chunk_size + (content_len % chunk_size != 0);
+}
+
+/**
+ * @brief Lê um inteiro decimal sem sinal que ocupa todo o texto.
+ * @return 1 em sucesso, 0 se o texto tiver outros caracteres ou o valor não couber em 64 bits.
+ */
+static int parse_u64(const char *text, uint64_t *value)
+{
+    if (!isdigit((unsigned char)*text))
+        return 0;
+    char *end;
+    errno = 0;
+    unsigned long long v = strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0')
+        return 0;
+    *value = v;
+    return 1;
+}
+
+/**
+ * @brief Estado da leitura do índice de blocos no cabeçalho de um arquivo assinado.
+ */
+typedef struct
+{
+    chunk_index *idx;
+    int in_index;         // Entre CHUNK_INDEX_BEGIN e CHUNK_INDEX_END
+    uint64_t filled;      // Digests já lidos
+    int ended;            // CHUNK_INDEX_END encontrado
+    uint64_t max_digests; // Digests que cabem no arquivo (cada linha do índice tem 64 caracteres)
+} chunk_parse_state;
+
+/**
+ * @brief Lê uma linha do cabeçalho do modo por blocos (tamanhos, contagem ou digest do índice).
+ * @return 1 se a linha foi reconhecida e é válida, 0 caso contrário.
+ */
+static int chunk_index_line(chunk_parse_state *st, const char *line, size_t line_len)
+{
+    char buffer[128];
+    while (line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r'))
+        line_len--;
+    if (line_len >= sizeof(buffer))
+        return 0;
+    memcpy(buffer, line, line_len);
+    buffer[line_len] = '\0';
+
+    chunk_index *idx = st->idx;
+    if (st->in_index)
+    {
+        if (strcmp(buffer, CHUNK_INDEX_END) == 0)
+        {
+            st->in_index = 0;
+            st->ended = 1;
+            return 1;
+        }
+        return st->filled < idx->count &&
+               hex_to_bytes(buffer, idx->digests + st->filled++ * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE);
+    }
+    if (strncmp(buffer, CHUNK_SIZE_HEADER, strlen(CHUNK_SIZE_HEADER)) == 0)
+    {
+        return parse_u64(buffer + strlen(CHUNK_SIZE_HEADER), &idx->chunk_size) && idx->chunk_size > 0 &&
+               idx->chunk_size % 3 == 0;
+    }
+    if (strncmp(buffer, CONTENT_LENGTH_HEADER, strlen(CONTENT_LENGTH_HEADER)) == 0)
+        return parse_u64(buffer + strlen(CONTENT_LENGTH_HEADER), &idx->content_len);
+    if (strncmp(buffer, CHUNKS_HEADER, strlen(CHUNKS_HEADER)) == 0 && !idx->digests)
+    {
+        // A contagem precisa ser a dos tamanhos já lidos e caber no próprio arquivo,
+        // o que limita a alocação antes de qualquer digest ser lido
+        uint64_t count;
+        if (!parse_u64(buffer + strlen(CHUNKS_HEADER), &count) || idx->chunk_size == 0 ||
+            count != chunk_count_for(idx->content_len, idx->chunk_size) || count > st->max_digests ||
+            count > SIZE_MAX / SHA3_256_DIGEST_SIZE)
+            return 0;
+        idx->count = count;
+        idx->digests = malloc(count ? count * SHA3_256_DIGEST_SIZE : 1);
+        return idx->digests != NULL;
+    }
+    if (strcmp(buffer, CHUNK_INDEX_BEGIN) == 0)
+    {
+        st->in_index = idx->digests != NULL && !st->ended;
+        return st->in_index;
+    }
+    return 0;
+}
+
+/**
+ * @brief Confere que o índice lido está completo (ou ausente, na assinatura simples).
+ * @return 1 se o índice for consistente, 0 caso contrário.
+ */
+static int chunk_index_complete(const chunk_parse_state *st)
+{
+    const chunk_index *idx = st->idx;
+    if (idx->chunk_size == 0 && !idx->digests)
+        return 1;
+    return idx->digests && st->ended && st->filled == idx->count;
+}
+
+/**
+ * @brief Libera os buffers de uma mensagem assinada.
+ */
+void signed_message_clear(signed_message *msg)
+{
+    free(msg->content);
+    free(msg->signature);
+    free(msg->chunks.digests);
+    memset(msg, 0, sizeof(*msg));
+}
+
+/**
+ * @brief Decodifica o Base64 de um bloco do arquivo assinado, removendo as quebras de linha.
+ * @return Dados alocados com malloc, ou NULL se o Base64 for inválido.
+ */
+static unsigned char *signed_block_decode(const char *start, const char *end, size_t *out_len)
+{
+    char *b64 = (char *)malloc(end - start + 1);
+    if (!b64)
+        return NULL;
+    size_t len = 0;
+    for (const char *c = start; c < end; c++)
+    {
+        if (*c != '\n' && *c != '\r')
+            b64[len++] = *c;
+    }
+
+    unsigned char *data;
+    if (len == 0)
+    {
+        data = (unsigned char *)malloc(1); // Mensagem vazia
+        *out_len = 0;
+    }
+    else
+    {
+        data = base64_decode(b64, len, out_len);
+    }
+    free(b64);
+    return data;
+}
+
+/**
+ * @brief Lê um arquivo assinado em memória: cabeçalhos, mensagem e assinatura.
+ * @param text Texto do arquivo assinado.
+ * @param len Tamanho do texto.
+ * @param msg Mensagem decodificada (saída; liberar com signed_message_clear).
+ * @return 1 em sucesso, 0 se a mensagem não for encontrada ou não for Base64 válido.
+ */
+int signed_file_parse(const char *text, size_t len, signed_message *msg)
+{
+    static const char begin_message[] = "-----BEGIN SIGNED MESSAGE-----";
+    static const char begin_signature[] = "-----BEGIN SIGNATURE-----";
+    static const char end_signature[] = "-----END SIGNATURE-----";
+
+    memset(msg, 0, sizeof(*msg));
+    double t = trace_start();
+    const char *end = text + len;
+    const char *content_start = NULL, *content_end = NULL;
+    const char *sig_start = NULL, *sig_end = NULL;
+    chunk_parse_state chunks = {&msg->chunks, 0, 0, 0, len / (2 * SHA3_256_DIGEST_SIZE)};
+
+    for (const char *line = text; line < end;)
+    {
+        const char *newline = memchr(line, '\n', end - line);
+        const char *next = newline ? newline + 1 : end;
+        size_t line_len = next - line;
+
+        if (chunks.in_index)
+        {
+            if (!chunk_index_line(&chunks, line, line_len))
+                return 0;
+        }
+        else if (line_len >= sizeof(begin_message) - 1 &&
+                 memcmp(line, begin_message, sizeof(begin_message) - 1) == 0)
+        {
+            content_start = next;
+        }
+        else if (line_len >= sizeof(begin_signature) - 1 &&
+                 memcmp(line, begin_signature, sizeof(begin_signature) - 1) == 0)
+        {
+            if (content_start && !content_end)
+                content_end = line;
+            sig_start = next;
+        }
+        else if (line_len >= sizeof(end_signature) - 1 && memcmp(line, end_signature, sizeof(end_signature) - 1) == 0)
+        {
+            if (sig_start)
+                sig_end = line;
+            break;
+        }
+        else if (!content_start && line_len > strlen(FINGERPRINT_HEADER) &&
+                 memcmp(line, FINGERPRINT_HEADER, strlen(FINGERPRINT_HEADER)) == 0)
+        {
+            msg->has_fingerprint = hex_to_bytes(line + strlen(FINGERPRINT_HEADER), msg->fingerprint,
+                                                SHA3_256_DIGEST_SIZE);
+        }
+        else if (!content_start && line_len > strlen(KEY_BITS_HEADER) &&
+                 memcmp(line, KEY_BITS_HEADER, strlen(KEY_BITS_HEADER)) == 0)
+        {
+            msg->bits = atoi(line + strlen(KEY_BITS_HEADER));
+        }
+        else if (!content_start && line_len > 0 && *line != '\n' && *line != '\r' &&
+                 !chunk_index_line(&chunks, line, line_len) && msg->chunks.chunk_size != 0)
+        {
+            return 0; // Cabeçalho do modo por blocos inválido
+        }
+        line = next;
+    }
+
+    if (!content_start || !content_end || !chunk_index_complete(&chunks))
+        return 0;
+    msg->content = signed_block_decode(content_start, content_end, &msg->content_len);
+    if (!msg->content)
+        return 0;
+    if (sig_start && sig_end)
+        msg->signature = signed_block_decode(sig_start, sig_end, &msg->signature_len);
+    trace_stop(TRACE_BASE64, t);
+    return 1;
+}
+
+/**
+ * @brief Lê um arquivo assinado do disco (ver signed_file_parse).
+ * @return 1 em sucesso, 0 em falha.
+ */
+int read_signed_file(const char *filename, signed_message *msg)
+{
+    unsigned char *text;
+    size_t len;
+    memset(msg, 0, sizeof(*msg));
+    double t = trace_start();
+    if (!read_file_content(filename, &text, &len))
+        return 0;
+    trace_stop(TRACE_READ, t);
+    int ok = signed_file_parse((const char *)text, len, msg);
+    free(text);
+    return ok;
+}
+
+/**
+ * @brief Assina uma mensagem em memória e devolve o texto completo do arquivo assinado.
+ * @param key Chave privada.
+ * @param content Mensagem.
+ * @param content_len Tamanho da mensagem.
+ * @param rng Gerador da semente do OAEP.
+ * @param out_len Tamanho do texto gerado (saída).
+ * @return Texto alocado com malloc (liberar com free), ou NULL em falha.
+ */
+char *rsa_sign_message(const rsa_key *key, const unsigned char *content, size_t content_len, drbg *rng,
+                       size_t *out_len)
+{
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    double t = trace_start();
+    sha3_256(content, content_len, digest);
+    trace_stop(TRACE_HASH, t);
+
+    int k = rsa_key_bytes(key);
+    unsigned char *signature = (unsigned char *)malloc(k);
+    if (!signature || !rsa_sign_digest(key, SIGN_DOMAIN_PLAIN, digest, signature, rng))
+    {
+        free(signature);
+        return NULL;
+    }
+
+    t = trace_start();
+    size_t content_b64_len, sig_b64_len;
+    char *content_b64 = base64_encode(content, content_len, &content_b64_len);
+    char *sig_b64 = base64_encode(signature, k, &sig_b64_len);
+    char *text = content_b64 && sig_b64 ? signed_file_format(key, content_b64, sig_b64, out_len) : NULL;
+    trace_stop(TRACE_BASE64, t);
+
+    free(signature);
+    free(content_b64);
+    free(sig_b64);
+    return text;
+}
+
+/**
+ * @brief Verifica uma mensagem assinada já decodificada com a chave pública informada.
+ * @return VERIFY_OK se a assinatura for válida; caso contrário, o motivo da falha.
+ */
+verify_status rsa_verify_message(const rsa_key *key, const signed_message *msg)
+{
+    if (msg->chunks.chunk_size != 0)
+    {
+        // Por blocos: a assinatura cobre o índice, e cada bloco é conferido contra o seu digest
+        verify_status status = rsa_verify_chunk_index(key, msg);
+        if (status != VERIFY_OK)
+            return status;
+        if (msg->content_len != msg->chunks.content_len)
+            return VERIFY_BAD_DIGEST;
+
+        double t = trace_start();
+        for (uint64_t i = 0; i < msg->chunks.count && status == VERIFY_OK; i++)
+        {
+            unsigned char digest[SHA3_256_DIGEST_SIZE];
+            uint64_t offset = i * msg->chunks.chunk_size;
+            uint64_t len = msg->content_len - offset < msg->chunks.chunk_size ? msg->content_len - offset
+                                                                               : msg->chunks.chunk_size;
+            sha3_256(msg->content + offset, len, digest);
+            if (memcmp(digest, msg->chunks.digests + i * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE) != 0)
+                status = VERIFY_BAD_DIGEST; // Para no primeiro bloco corrompido
+        }
+        trace_stop(TRACE_HASH, t);
+        return status;
+    }
+
+    if (!msg->signature)
+        return VERIFY_NO_SIGNATURE;
+    if (msg->bits != 0 && msg->bits != rsa_key_bits(key))
+        return VERIFY_KEY_MISMATCH;
+
+    unsigned char signed_digest[SHA3_256_DIGEST_SIZE], digest[SHA3_256_DIGEST_SIZE];
+    if (!rsa_recover_digest(key, SIGN_DOMAIN_PLAIN, msg->signature, msg->signature_len, signed_digest))
+        return VERIFY_BAD_PADDING;
+    double t = trace_start();
+    sha3_256(msg->content, msg->content_len, digest);
+    trace_stop(TRACE_HASH, t);
+    return memcmp(signed_digest, digest, SHA3_256_DIGEST_SIZE) == 0 ? VERIFY_OK : VERIFY_BAD_DIGEST;
+}
+
+// --- Assinatura por blocos ---
+//
+// No modo por blocos, a mensagem é dividida em blocos de tamanho fixo (múltiplo
+// de 3), e o cabeçalho do arquivo assinado traz um índice com o SHA3-256 de cada
+// bloco; a assinatura cobre o índice. Como o Base64 da mensagem fica em uma única
+// linha e cada bloco vira exatamente 4/3 do seu tamanho em Base64, o bloco i
+// começa em uma posição conhecida do arquivo: os blocos podem ser conferidos em
+// paralelo, um intervalo pode ser conferido sozinho, e a verificação para no
+// primeiro bloco corrompido.
+
+/**
+ * @brief Lê exatamente 'len' bytes a partir de 'offset'.
+ * @return 1 em sucesso, 0 em erro de leitura ou fim de arquivo prematuro.
+ */
+static int pread_full(int fd, unsigned char *buffer, size_t len, uint64_t offset)
+{
+    while (len > 0)
+    {
+        ssize_t got = pread(fd, buffer, len, (off_t)offset);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return 0;
+        buffer += got;
+        len -= got;
+        offset += got;
+    }
+    return 1;
+}
+
+/**
+ * @brief Tamanho do bloco i (o último pode ser menor).
+ */
+static uint64_t chunk_length(const chunk_index *idx, uint64_t i)
+{
+    uint64_t offset = i * idx->chunk_size;
+    return idx->content_len - offset < idx->chunk_size ? idx->content_len - offset : idx->chunk_size;
+}
+
+typedef struct
+{
+    chunk_index *idx;
+    const unsigned char *content; // Mensagem em memória, ou NULL para ler de 'fd'
+    int fd;
+    atomic_ullong next; // Próximo bloco a calcular
+    atomic_int failed;
+} chunk_hash_job;
+
+/**
+ * @brief Thread de hash dos blocos a assinar: pega o próximo bloco até acabarem.
+ */
+static void *chunk_hash_worker(void *arg)
+{
+    chunk_hash_job *job = (chunk_hash_job *)arg;
+    chunk_index *idx = job->idx;
+    unsigned char *buffer = job->content ? NULL : malloc(idx->chunk_size);
+    if (!job->content && !buffer)
+    {
+        atomic_store(&job->failed, 1);
+        return NULL;
+    }
+
+    uint64_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < idx->count && !atomic_load(&job->failed))
+    {
+        uint64_t len = chunk_length(idx, i);
+        const unsigned char *data = job->content + i * idx->chunk_size;
+        if (!job->content)
+        {
+            if (!pread_full(job->fd, buffer, len, i * idx->chunk_size))
+            {
+                atomic_store(&job->failed, 1);
+                break;
+            }
+            data = buffer;
+        }
+        sha3_256(data, len, idx->digests + i * SHA3_256_DIGEST_SIZE);
+    }
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Executa 'worker' em 'threads' threads (a chamadora inclusive).
+ */
+static void run_workers(void *(*worker)(void *), void *job, int threads)
+{
+    pthread_t *tids = threads > 1 ? malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    int started = 0;
+    for (int t = 1; tids && t < threads; t++, started++)
+    {
+        if (pthread_create(&tids[started], NULL, worker, job) != 0)
+            break;
+    }
+    worker(job);
+    for (int t = 0; t < started; t++)
+        pthread_join(tids[t], NULL);
+    free(tids);
+}
+
+/**
+ * @brief Monta o índice de uma mensagem em memória ou em um arquivo, com o hash dos blocos em paralelo.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int chunk_index_build(chunk_index *idx, const unsigned char *content, int fd, uint64_t content_len,
+                             uint64_t chunk_size, int threads)
+{
+    memset(idx, 0, sizeof(*idx));
+    if (chunk_size == 0 || chunk_size % 3 != 0)
+        return 0;
+    idx->chunk_size = chunk_size;
+    idx->content_len = content_len;
+    idx->count = chunk_count_for(content_len, chunk_size);
+    if (idx->count > SIZE_MAX / SHA3_256_DIGEST_SIZE)
+        return 0;
+    idx->digests = malloc(idx->count ? idx->count * SHA3_256_DIGEST_SIZE : 1);
+    if (!idx->digests)
+        return 0;
+
+    chunk_hash_job job;
+    job.idx = idx;
+    job.content = content;
+    job.fd = fd;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.failed, 0);
+    if (threads < 1)
+        threads = 1;
+    if ((uint64_t)threads > idx->count)
+        threads = idx->count ? (int)idx->count : 1;
+
+    double t = trace_start();
+    run_workers(chunk_hash_worker, &job, threads);
+    trace_stop(TRACE_HASH, t);
+    return !atomic_load(&job.failed);
+}
+
+/**
+ * @brief Assina o índice e grava o cabeçalho completo até a linha que abre a mensagem.
+ * @param sig_b64 Recebe a assinatura em Base64 (liberar com free).
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int chunked_header_write(FILE *out, const rsa_key *key, const chunk_index *idx, drbg *rng, char **sig_b64)
+{
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    chunked_signed_digest(idx, idx->content_len, digest);
+
+    int k = rsa_key_bytes(key);
+    unsigned char *signature = malloc(k);
+    size_t sig_b64_len;
+    int signed_ok = signature && rsa_sign_digest(key, SIGN_DOMAIN_CHUNKS, digest, signature, rng);
+    *sig_b64 = signed_ok ? base64_encode(signature, k, &sig_b64_len) : NULL;
+    free(signature);
+    if (!*sig_b64)
+        return 0;
+
+    char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+    bytes_to_hex(key->fingerprint, SHA3_256_DIGEST_SIZE, hex);
+    fprintf(out, "%s%s\n%s%d\n%s%llu\n%s%llu\n%s%llu\n%s\n", FINGERPRINT_HEADER, hex, KEY_BITS_HEADER,
+            rsa_key_bits(key), CHUNK_SIZE_HEADER, (unsigned long long)idx->chunk_size, CONTENT_LENGTH_HEADER,
+            (unsigned long long)idx->content_len, CHUNKS_HEADER, (unsigned long long)idx->count, CHUNK_INDEX_BEGIN);
+    for (uint64_t i = 0; i < idx->count; i++)
+    {
+        bytes_to_hex(idx->digests + i * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE, hex);
+        fprintf(out, "%s\n", hex);
+    }
+    fprintf(out, "%s\n-----BEGIN SIGNED MESSAGE-----\n", CHUNK_INDEX_END);
+    return 1;
+}
+
+/**
+ * @brief Assina uma mensagem em memória no modo por blocos.
+ * @param chunk_size Tamanho do bloco em bytes (múltiplo de 3; CHUNK_DEFAULT_SIZE por padrão).
+ * @param threads Threads do hash dos blocos.
+ * @return Texto do arquivo assinado (liberar com free), ou NULL em falha.
+ */
+char *rsa_sign_message_chunked(const rsa_key *key, const unsigned char *content, size_t content_len,
+                               uint64_t chunk_size, int threads, drbg *rng, size_t *out_len)
+{
+    chunk_index idx;
+    char *text = NULL, *sig_b64 = NULL;
+    if (!chunk_index_build(&idx, content, -1, content_len, chunk_size, threads))
+    {
+        free(idx.digests);
+        return NULL;
+    }
+
+    FILE *out = open_memstream(&text, out_len);
+    int ok = out && chunked_header_write(out, key, &idx, rng, &sig_b64);
+    if (ok)
+    {
+        double t = trace_start();
+        size_t content_b64_len;
+        char *content_b64 = base64_encode(content, content_len, &content_b64_len);
+        ok = content_b64 != NULL;
+        if (ok)
+            fprintf(out, "%s\n-----BEGIN SIGNATURE-----\n%s\n-----END SIGNATURE-----\n", content_b64, sig_b64);
+        free(content_b64);
+        trace_stop(TRACE_BASE64, t);
+    }
+    if (out && fclose(out) != 0)
+        ok = 0;
+    if (!ok)
+    {
+        free(text);
+        text = NULL;
+    }
+    free(sig_b64);
+    free(idx.digests);
+    return text;
+}
+
+/**
+ * @brief Assina um arquivo no modo por blocos, lendo-o em blocos (sem carregá-lo inteiro).
+ *
+ * O arquivo é lido duas vezes: uma para o hash paralelo dos blocos e outra para
+ * gravar o Base64, bloco a bloco.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int sign_file_chunked(const char *filename, const char *signed_filename, const rsa_key *key, uint64_t chunk_size,
+                      int threads, drbg *rng)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        if (fd >= 0)
+            close(fd);
+        return 0;
+    }
+
+    chunk_index idx;
+    char *sig_b64 = NULL;
+    unsigned char *buffer = NULL;
+    FILE *out = NULL;
+    int ok = chunk_index_build(&idx, NULL, fd, (uint64_t)st.st_size, chunk_size, threads) &&
+             (buffer = malloc(chunk_size)) != NULL && (out = fopen(signed_filename, "w")) != NULL &&
+             chunked_header_write(out, key, &idx, rng, &sig_b64);
+
+    double t = trace_start();
+    for (uint64_t i = 0; ok && i < idx.count; i++)
+    {
+        uint64_t len = chunk_length(&idx, i);
+        size_t b64_len;
+        char *b64 = pread_full(fd, buffer, len, i * chunk_size) ? base64_encode(buffer, len, &b64_len) : NULL;
+        ok = b64 && fwrite(b64, 1, b64_len, out) == b64_len;
+        free(b64);
+    }
+    if (ok)
+        fprintf(out, "\n-----BEGIN SIGNATURE-----\n%s\n-----END SIGNATURE-----\n", sig_b64);
+    trace_stop(TRACE_WRITE, t);
+
+    if (out && fclose(out) != 0)
+        ok = 0;
+    close(fd);
+    free(buffer);
+    free(sig_b64);
+    free(idx.digests);
+    return ok;
+}
+
+/**
+ * @brief Lê de um arquivo assinado por blocos só o cabeçalho, o índice e a assinatura,
+ *        sem a mensagem (msg->content fica NULL).
+ *
+ * A posição do Base64 da mensagem é guardada em msg->chunks.body_offset, e a
+ * assinatura é procurada logo depois do fim calculado do Base64.
+ * @return 1 em sucesso, 0 se o arquivo não puder ser lido ou não for assinado por blocos.
+ */
+int read_signed_file_index(const char *filename, signed_message *msg)
+{
+    memset(msg, 0, sizeof(*msg));
+    double t = trace_start();
+    FILE *f = fopen(filename, "rb");
+    struct stat st;
+    if (!f || fstat(fileno(f), &st) != 0)
+    {
+        if (f)
+            fclose(f);
+        return 0;
+    }
+
+    chunk_parse_state chunks = {&msg->chunks, 0, 0, 0, (uint64_t)st.st_size / (2 * SHA3_256_DIGEST_SIZE)};
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t line_len;
+    int ok = 0;
+    while ((line_len = getline(&line, &capacity, f)) > 0)
+    {
+        if (strncmp(line, "-----BEGIN SIGNED MESSAGE-----", 30) == 0 && !chunks.in_index)
+        {
+            ok = msg->chunks.chunk_size != 0 && chunk_index_complete(&chunks);
+            break;
+        }
+        if (!chunks.in_index && strncmp(line, FINGERPRINT_HEADER, strlen(FINGERPRINT_HEADER)) == 0)
+            msg->has_fingerprint = hex_to_bytes(line + strlen(FINGERPRINT_HEADER), msg->fingerprint,
+                                                SHA3_256_DIGEST_SIZE);
+        else if (!chunks.in_index && strncmp(line, KEY_BITS_HEADER, strlen(KEY_BITS_HEADER)) == 0)
+            msg->bits = atoi(line + strlen(KEY_BITS_HEADER));
+        else if (!chunk_index_line(&chunks, line, line_len) && (chunks.in_index || msg->chunks.chunk_size != 0))
+            break;
+    }
+
+    // Depois do Base64 (4 caracteres por grupo de 3 bytes, em uma única linha) vem a assinatura
+    static const char begin_signature[] = "\n-----BEGIN SIGNATURE-----\n";
+    char marker[sizeof(begin_signature) - 1];
+    uint64_t b64_len = (msg->chunks.content_len + 2) / 3 * 4;
+    off_t body = ok ? ftello(f) : -1;
+    ok = body >= 0 && fseeko(f, body + (off_t)b64_len, SEEK_SET) == 0 &&
+         fread(marker, 1, sizeof(marker), f) == sizeof(marker) && memcmp(marker, begin_signature, sizeof(marker)) == 0 &&
+         (line_len = getline(&line, &capacity, f)) > 0;
+    if (ok)
+    {
+        while (line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r'))
+            line[--line_len] = '\0';
+        msg->chunks.body_offset = (uint64_t)body;
+        msg->signature = line_len > 0 ? base64_decode(line, line_len, &msg->signature_len) : NULL;
+    }
+    free(line);
+    fclose(f);
+    trace_stop(TRACE_READ, t);
+    return ok;
+}
+
+/**
+ * @brief Verifica a assinatura do índice de blocos (custo constante, sem ler a mensagem).
+ * @return VERIFY_OK se a assinatura do índice for válida; caso contrário, o motivo da falha.
+ */
+verify_status rsa_verify_chunk_index(const rsa_key *key, const signed_message *msg)
+{
+    if (!msg->signature)
+        return VERIFY_NO_SIGNATURE;
+    if (msg->bits != 0 && msg->bits != rsa_key_bits(key))
+        return VERIFY_KEY_MISMATCH;
+
+    unsigned char signed_digest[SHA3_256_DIGEST_SIZE], digest[SHA3_256_DIGEST_SIZE];
+    if (!rsa_recover_digest(key, SIGN_DOMAIN_CHUNKS, msg->signature, msg->signature_len, signed_digest))
+        return VERIFY_BAD_PADDING;
+    chunked_signed_digest(&msg->chunks, msg->chunks.content_len, digest);
+    return memcmp(signed_digest, digest, SHA3_256_DIGEST_SIZE) == 0 ? VERIFY_OK : VERIFY_BAD_DIGEST;
+}
+
+typedef struct
+{
+    const chunk_index *idx;
+    int fd;
+    atomic_ullong next; // Próximo bloco a conferir
+    uint64_t last;      // Fim (exclusivo) do intervalo
+    atomic_ullong bad;  // Menor bloco corrompido encontrado (UINT64_MAX = nenhum)
+} chunk_verify_job;
+
+/**
+ * @brief Thread de verificação: confere blocos em ordem crescente até o fim do
+ *        intervalo ou até que um bloco anterior seja dado como corrompido.
+ *
+ * Como os blocos são distribuídos em ordem e cada thread termina o bloco em
+ * andamento, todos os blocos anteriores ao menor bloco corrompido são conferidos.
+ */
+static void *chunk_verify_worker(void *arg)
+{
+    chunk_verify_job *job = (chunk_verify_job *)arg;
+    const chunk_index *idx = job->idx;
+    size_t b64_capacity = idx->chunk_size / 3 * 4;
+    char *b64 = malloc(b64_capacity);
+
+    uint64_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->last && i < atomic_load(&job->bad))
+    {
+        uint64_t len = chunk_length(idx, i);
+        size_t b64_len = (len + 2) / 3 * 4, decoded_len;
+        unsigned char digest[SHA3_256_DIGEST_SIZE];
+        unsigned char *decoded = b64 && pread_full(job->fd, (unsigned char *)b64, b64_len,
+                                                   idx->body_offset + i * b64_capacity)
+                                     ? base64_decode(b64, b64_len, &decoded_len)
+                                     : NULL;
+        int good = decoded && decoded_len == len;
+        if (good)
+        {
+            sha3_256(decoded, len, digest);
+            good = memcmp(digest, idx->digests + i * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE) == 0;
+        }
+        free(decoded);
+        if (!good)
+        {
+            unsigned long long current = atomic_load(&job->bad);
+            while (i < current && !atomic_compare_exchange_weak(&job->bad, &current, i))
+                ;
+        }
+    }
+    free(b64);
+    return NULL;
+}
+
+/**
+ * @brief Confere os blocos [first, last) de um arquivo assinado por blocos contra o índice,
+ *        em 'threads' threads, parando no primeiro bloco corrompido.
+ *
+ * Apenas os dados; a assinatura do índice é conferida por rsa_verify_chunk_index.
+ * @param msg Resultado de read_signed_file_index.
+ * @param bad_chunk Recebe o primeiro bloco corrompido ou ilegível (pode ser NULL).
+ * @return VERIFY_OK se todos os blocos do intervalo conferirem, VERIFY_BAD_DIGEST caso contrário.
+ */
+verify_status verify_chunked_file(const char *filename, const signed_message *msg, uint64_t first, uint64_t last,
+                                  int threads, uint64_t *bad_chunk)
+{
+    const chunk_index *idx = &msg->chunks;
+    if (last > idx->count)
+        last = idx->count;
+    if (first >= last)
+        return VERIFY_OK;
+
+    chunk_verify_job job;
+    job.idx = idx;
+    job.fd = open(filename, O_RDONLY);
+    job.last = last;
+    atomic_init(&job.next, first);
+    atomic_init(&job.bad, UINT64_MAX);
+    if (job.fd < 0)
+    {
+        if (bad_chunk)
+            *bad_chunk = first;
+        return VERIFY_BAD_DIGEST;
+    }
+    if (threads < 1)
+        threads = 1;
+    if ((uint64_t)threads > last - first)
+        threads = (int)(last - first);
+
+    double t = trace_start();
+    run_workers(chunk_verify_worker, &job, threads);
+    trace_stop(TRACE_HASH, t);
+    close(job.fd);
+
+    uint64_t bad = atomic_load(&job.bad);
+    if (bad == UINT64_MAX)
+        return VERIFY_OK;
+    if (bad_chunk)
+        *bad_chunk = bad;
+    return VERIFY_BAD_DIGEST;
+}
+
+// --- Pedido e resposta da assinatura remota ---
+
+/**
+ * @brief Grava um pedido de assinatura: apenas o digest SHA3-256 do artefato.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int write_digest_request(const char *filename, const unsigned char *digest)
+{
+    FILE *f = fopen(filename, "w");
+    if (!f)
+        return 0;
+
+    char digest_hex[2 * SHA3_256_DIGEST_SIZE + 1];
+    bytes_to_hex(digest, SHA3_256_DIGEST_SIZE, digest_hex);
+    fprintf(f, "%s%s\n", DIGEST_HEADER, digest_hex);
+    return fclose(f) == 0;
+}
+
+/**
+ * @brief Lê o digest de um pedido de assinatura.
+ * @return 1 em sucesso, 0 se o arquivo não puder ser lido ou não tiver um digest válido.
+ */
+int read_digest_request(const char *filename, unsigned char *digest)
+{
+    FILE *f = fopen(filename, "r");
+    if (!f)
+        return 0;
+
+    char line[256];
+    int ok = 0;
+    while (!ok && fgets(line, sizeof(line), f))
+    {
+        if (strncmp(line, DIGEST_HEADER, strlen(DIGEST_HEADER)) == 0)
+            ok = hex_to_bytes(line + strlen(DIGEST_HEADER), digest, SHA3_256_DIGEST_SIZE);
+    }
+    fclose(f);
+    return ok;
+}
+
+/**
+ * @brief Grava a resposta do host de assinatura: chave usada, digest assinado e assinatura.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int write_digest_response(const char *filename, const rsa_key *key, const unsigned char *digest, const char *sig_b64)
+{
+    FILE *f = fopen(filename, "w");
+    if (!f)
+        return 0;
+
+    char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+    bytes_to_hex(key->fingerprint, SHA3_256_DIGEST_SIZE, hex);
+    fprintf(f, "%s%s\n", FINGERPRINT_HEADER, hex);
+    fprintf(f, "%s%d\n", KEY_BITS_HEADER, rsa_key_bits(key));
+    bytes_to_hex(digest, SHA3_256_DIGEST_SIZE, hex);
+    fprintf(f, "%s%s\n", DIGEST_HEADER, hex);
+    fprintf(f, "-----BEGIN SIGNATURE-----\n");
+    fprintf(f, "%s\n", sig_b64);
+    fprintf(f, "-----END SIGNATURE-----\n");
+    return fclose(f) == 0;
+}
+
+/**
+ * @brief Lê a resposta do host de assinatura.
+ * @param filename Nome do arquivo de resposta.
+ * @param fingerprint Impressão digital da chave (saída).
+ * @param digest Digest assinado (saída).
+ * @param sig_b64 Assinatura em Base64 (saída, liberar com free).
+ * @return 1 em sucesso, 0 se faltar algum campo.
+ */
+int read_digest_response(const char *filename, unsigned char *fingerprint, unsigned char *digest, char **sig_b64)
+{
+    FILE *f = fopen(filename, "r");
+    if (!f)
+        return 0;
+
+    char line[4096]; // A assinatura ocupa uma única linha (até 16384 bits)
+    int has_fingerprint = 0, has_digest = 0, reading_sig = 0;
+    *sig_b64 = NULL;
+    while (fgets(line, sizeof(line), f))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (reading_sig)
+        {
+            if (strcmp(line, "-----END SIGNATURE-----") == 0)
+                break;
+            if (!*sig_b64)
+                *sig_b64 = strdup(line);
+        }
+        else if (strncmp(line, FINGERPRINT_HEADER, strlen(FINGERPRINT_HEADER)) == 0)
+            has_fingerprint = hex_to_bytes(line + strlen(FINGERPRINT_HEADER), fingerprint, SHA3_256_DIGEST_SIZE);
+        else if (strncmp(line, DIGEST_HEADER, strlen(DIGEST_HEADER)) == 0)
+            has_digest = hex_to_bytes(line + strlen(DIGEST_HEADER), digest, SHA3_256_DIGEST_SIZE);
+        else if (strcmp(line, "-----BEGIN SIGNATURE-----") == 0)
+            reading_sig = 1;
+    }
+    fclose(f);
+
+    if (!has_fingerprint || !has_digest || !*sig_b64)
+    {
+        free(*sig_b64);
+        *sig_b64 = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// --- Manifesto Merkle de diretórios ---
+//
+// Um diretório inteiro é assinado com uma única operação privada: os arquivos
+// são ordenados pelo caminho relativo, cada um vira uma folha
+// SHA3-256(0x00 || tamanho do caminho || caminho || SHA3-256(arquivo)), cada nó
+// interno é SHA3-256(0x01 || esquerda || direita), e um nó sem par sobe sem ser
+// combinado. A assinatura cobre SHA3-256(rótulo || número de arquivos || raiz).
+// Uma prova de inclusão traz os irmãos do caminho da folha até a raiz e a
+// assinatura, de modo que um arquivo é verificado sem ler os demais.
+
+#define MERKLE_LABEL "segcomp-merkle-manifest-v1"
+#define MERKLE_LEAF_PREFIX 0x00
+#define MERKLE_NODE_PREFIX 0x01
+#define MERKLE_PATH_MAX 4096
+#define MERKLE_BEGIN_MANIFEST "-----BEGIN MERKLE MANIFEST-----"
+#define MERKLE_BEGIN_PROOF "-----BEGIN MERKLE PROOF-----"
+#define MERKLE_BEGIN_SIGNATURE "-----BEGIN SIGNATURE-----"
+#define MERKLE_END_SIGNATURE "-----END SIGNATURE-----"
+#define MERKLE_DIGEST_PREFIX "sha3-256:"
+
+/**
+ * @brief Hash de uma folha: caminho relativo e digest do arquivo.
+ */
+static void merkle_leaf(const char *path, const unsigned char *digest, unsigned char *out)
+{
+    unsigned char header[5];
+    size_t len = strlen(path);
+    header[0] = MERKLE_LEAF_PREFIX;
+    for (int i = 0; i < 4; i++)
+        header[1 + i] = (len >> (24 - 8 * i)) & 0xFF;
+
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHA3_DOMAIN);
+    keccak_absorb(&sponge, header, sizeof(header));
+    keccak_absorb(&sponge, (const unsigned char *)path, len);
+    keccak_absorb(&sponge, digest, SHA3_256_DIGEST_SIZE);
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, out, SHA3_256_DIGEST_SIZE);
+}
+
+/**
+ * @brief Hash de um nó interno (out pode coincidir com left).
+ */
+static void merkle_node(const unsigned char *left, const unsigned char *right, unsigned char *out)
+{
+    unsigned char buffer[1 + 2 * SHA3_256_DIGEST_SIZE];
+    buffer[0] = MERKLE_NODE_PREFIX;
+    memcpy(buffer + 1, left, SHA3_256_DIGEST_SIZE);
+    memcpy(buffer + 1 + SHA3_256_DIGEST_SIZE, right, SHA3_256_DIGEST_SIZE);
+    sha3_256(buffer, sizeof(buffer), out);
+}
+
+/**
+ * @brief Sobe um nível da árvore no lugar: 'count' nós viram (count + 1) / 2.
+ */
+static size_t merkle_reduce(unsigned char *level, size_t count)
+{
+    size_t next = 0;
+    for (size_t i = 0; i < count; i += 2, next++)
+    {
+        unsigned char *dst = level + next * SHA3_256_DIGEST_SIZE;
+        if (i + 1 < count)
+            merkle_node(level + i * SHA3_256_DIGEST_SIZE, level + (i + 1) * SHA3_256_DIGEST_SIZE, dst);
+        else
+            memmove(dst, level + i * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE); // Sem par: sobe inalterado
+    }
+    return next;
+}
+
+/**
+ * @brief Folhas de todos os arquivos do manifesto.
+ * @return Buffer com count * 32 bytes (liberar com free), ou NULL em falha.
+ */
+static unsigned char *merkle_leaves(const merkle_manifest *m)
+{
+    unsigned char *level = malloc(m->count * SHA3_256_DIGEST_SIZE);
+    for (size_t i = 0; level && i < m->count; i++)
+        merkle_leaf(m->paths[i], m->digests + i * SHA3_256_DIGEST_SIZE, level + i * SHA3_256_DIGEST_SIZE);
+    return level;
+}
+
+/**
+ * @brief Calcula a raiz da árvore a partir dos caminhos e digests do manifesto.
+ * @return 1 em sucesso, 0 se o manifesto estiver vazio ou faltar memória.
+ */
+static int merkle_compute_root(const merkle_manifest *m, unsigned char *root)
+{
+    if (m->count == 0)
+        return 0;
+    unsigned char *level = merkle_leaves(m);
+    if (!level)
+        return 0;
+    for (size_t n = m->count; n > 1;)
+        n = merkle_reduce(level, n);
+    memcpy(root, level, SHA3_256_DIGEST_SIZE);
+    free(level);
+    return 1;
+}
+
+/**
+ * @brief Valor assinado: SHA3-256(rótulo || número de arquivos (64 bits, big-endian) || raiz).
+ */
+static void merkle_signed_digest(const unsigned char *root, size_t count, unsigned char *out)
+{
+    unsigned char count_be[8];
+    for (int i = 0; i < 8; i++)
+        count_be[i] = ((uint64_t)count >> (56 - 8 * i)) & 0xFF;
+
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHA3_DOMAIN);
+    keccak_absorb(&sponge, (const unsigned char *)MERKLE_LABEL, strlen(MERKLE_LABEL));
+    keccak_absorb(&sponge, count_be, sizeof(count_be));
+    keccak_absorb(&sponge, root, SHA3_256_DIGEST_SIZE);
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, out, SHA3_256_DIGEST_SIZE);
+}
+
+/**
+ * @brief Acrescenta um caminho à lista do manifesto.
+ * @return 1 em sucesso, 0 em falha de alocação.
+ */
+static int merkle_add_path(merkle_manifest *m, size_t *alloc, const char *path)
+{
+    if (m->count == *alloc)
+    {
+        size_t grown = *alloc ? *alloc * 2 : 64;
+        char **paths = realloc(m->paths, grown * sizeof(char *));
+        if (!paths)
+            return 0;
+        m->paths = paths;
+        *alloc = grown;
+    }
+    m->paths[m->count] = strdup(path);
+    return m->paths[m->count++] != NULL;
+}
+
+/**
+ * @brief Registra em m->skipped a entrada 'rel/name', que não pode entrar no manifesto.
+ * @return 1 em sucesso, 0 em falha de alocação.
+ */
+static int merkle_add_skipped(merkle_manifest *m, const char *rel, const char *name, merkle_skip_reason reason)
+{
+    size_t rel_len = strlen(rel), name_len = strlen(name);
+    merkle_skipped *skipped = realloc(m->skipped, (m->skipped_count + 1) * sizeof(merkle_skipped));
+    if (!skipped)
+        return 0;
+    m->skipped = skipped;
+
+    // Montado sem buffer fixo: o caminho pode ser justamente o que passou do limite
+    char *path = malloc(rel_len + name_len + 2);
+    if (!path)
+        return 0;
+    memcpy(path, rel, rel_len);
+    size_t len = rel_len;
+    if (rel_len && name_len)
+        path[len++] = '/';
+    memcpy(path + len, name, name_len + 1);
+
+    m->skipped[m->skipped_count].path = path;
+    m->skipped[m->skipped_count++].reason = reason;
+    return 1;
+}
+
+/**
+ * @brief Percorre 'base/rel' recursivamente e coleta os arquivos regulares.
+ *
+ * Nenhuma entrada é ignorada em silêncio: as que não podem entrar no manifesto
+ * (nome com quebra de linha, caminho longo demais, link simbólico ou arquivo
+ * especial, entrada ilegível) vão para m->skipped, e assim um arquivo colocado
+ * no diretório depois da assinatura sempre aparece na verificação.
+ * @return 1 em sucesso, 0 se o diretório raiz não puder ser aberto ou faltar memória.
+ */
+static int merkle_collect(merkle_manifest *m, size_t *alloc, const char *base, const char *rel)
+{
+    char dir_path[MERKLE_PATH_MAX];
+    DIR *dir = NULL;
+    if (snprintf(dir_path, sizeof(dir_path), "%s%s%s", base, *rel ? "/" : "", rel) < (int)sizeof(dir_path))
+        dir = opendir(dir_path);
+    if (!dir)
+        return *rel ? merkle_add_skipped(m, rel, "", MERKLE_SKIP_UNREADABLE) : 0;
+
+    int ok = 1;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        char child_rel[MERKLE_PATH_MAX], child_path[MERKLE_PATH_MAX];
+        struct stat st;
+        if (strpbrk(entry->d_name, "\r\n"))
+            ok = merkle_add_skipped(m, rel, entry->d_name, MERKLE_SKIP_NAME);
+        else if (snprintf(child_rel, sizeof(child_rel), "%s%s%s", rel, *rel ? "/" : "", entry->d_name) >=
+                     (int)sizeof(child_rel) ||
+                 snprintf(child_path, sizeof(child_path), "%s/%s", base, child_rel) >= (int)sizeof(child_path))
+            ok = merkle_add_skipped(m, rel, entry->d_name, MERKLE_SKIP_TOO_LONG);
+        else if (lstat(child_path, &st) != 0)
+            ok = merkle_add_skipped(m, rel, entry->d_name, MERKLE_SKIP_UNREADABLE);
+        else if (S_ISDIR(st.st_mode))
+            ok = merkle_collect(m, alloc, base, child_rel);
+        else if (S_ISREG(st.st_mode))
+            ok = merkle_add_path(m, alloc, child_rel);
+        else
+            ok = merkle_add_skipped(m, rel, entry->d_name, MERKLE_SKIP_SPECIAL);
+    }
+    closedir(dir);
+    return ok;
+}
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+typedef struct
+{
+    merkle_manifest *m;
+    const char *base;
+    atomic_size_t next; // Próximo arquivo a calcular
+    atomic_int failed;  // Índice + 1 do primeiro arquivo ilegível (0 = nenhum)
+} merkle_hash_job;
+
+/**
+ * @brief Thread de hash: pega o próximo arquivo da fila até acabarem.
+ */
+static void *merkle_hash_worker(void *arg)
+{
+    merkle_hash_job *job = (merkle_hash_job *)arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->m->count && !atomic_load(&job->failed))
+    {
+        char path[MERKLE_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", job->base, job->m->paths[i]);
+        FILE *f = fopen(path, "rb");
+        int ok = f && sha3_256_stream(f, job->m->digests + i * SHA3_256_DIGEST_SIZE);
+        if (f)
+            fclose(f);
+        if (!ok)
+        {
+            int expected = 0;
+            atomic_compare_exchange_strong(&job->failed, &expected, (int)i + 1);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Monta o manifesto de um diretório: lista e ordena os arquivos, calcula
+ *        os digests em 'threads' threads e a raiz da árvore.
+ *
+ * As entradas que não podem entrar no manifesto ficam em m->skipped (também em
+ * caso de falha); merkle_manifest_sign recusa um manifesto com alguma delas.
+ *
+ * @param failed_path Recebe o caminho do arquivo ilegível em caso de falha (pode ser NULL).
+ * @return 1 em sucesso, 0 em falha (diretório vazio ou ilegível).
+ */
+int merkle_manifest_build(merkle_manifest *m, const char *dirname, int threads, const char **failed_path)
+{
+    memset(m, 0, sizeof(*m));
+    size_t alloc = 0;
+    if (failed_path)
+        *failed_path = NULL;
+    if (!merkle_collect(m, &alloc, dirname, "") || m->count == 0)
+        return 0;
+    qsort(m->paths, m->count, sizeof(char *), compare_paths);
+
+    m->digests = malloc(m->count * SHA3_256_DIGEST_SIZE);
+    if (!m->digests)
+        return 0;
+
+    if (threads < 1)
+        threads = 1;
+    if ((size_t)threads > m->count)
+        threads = (int)m->count;
+
+    merkle_hash_job job;
+    job.m = m;
+    job.base = dirname;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.failed, 0);
+
+    run_workers(merkle_hash_worker, &job, threads);
+
+    int failed = atomic_load(&job.failed);
+    if (failed)
+    {
+        if (failed_path)
+            *failed_path = m->paths[failed - 1];
+        return 0;
+    }
+    return merkle_compute_root(m, m->root);
+}
+
+/**
+ * @brief Assina a raiz do manifesto (uma única operação privada).
+ * @return 1 em sucesso, 0 em falha ou se alguma entrada do diretório ficou de fora (m->skipped).
+ */
+int merkle_manifest_sign(merkle_manifest *m, const rsa_key *key, drbg *rng)
+{
+    if (m->skipped_count > 0)
+        return 0;
+
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    merkle_signed_digest(m->root, m->count, digest);
+
+    free(m->signature);
+    m->signature_len = rsa_key_bytes(key);
+    m->signature = malloc(m->signature_len);
+    if (!m->signature || !rsa_sign_digest(key, SIGN_DOMAIN_MERKLE, digest, m->signature, rng))
+    {
+        free(m->signature);
+        m->signature = NULL;
+        return 0;
+    }
+    memcpy(m->fingerprint, key->fingerprint, SHA3_256_DIGEST_SIZE);
+    m->has_fingerprint = 1;
+    m->bits = rsa_key_bits(key);
+    return 1;
+}
+
+/**
+ * @brief Verifica a assinatura da raiz do manifesto.
+ * @return VERIFY_OK se a assinatura for válida; caso contrário, o motivo da falha.
+ */
+verify_status merkle_manifest_verify(const merkle_manifest *m, const rsa_key *key)
+{
+    if (!m->signature)
+        return VERIFY_NO_SIGNATURE;
+    if (m->bits != 0 && m->bits != rsa_key_bits(key))
+        return VERIFY_KEY_MISMATCH;
+
+    unsigned char signed_digest[SHA3_256_DIGEST_SIZE], digest[SHA3_256_DIGEST_SIZE];
+    if (!rsa_recover_digest(key, SIGN_DOMAIN_MERKLE, m->signature, m->signature_len, signed_digest))
+        return VERIFY_BAD_PADDING;
+    merkle_signed_digest(m->root, m->count, digest);
+    return memcmp(signed_digest, digest, SHA3_256_DIGEST_SIZE) == 0 ? VERIFY_OK : VERIFY_BAD_DIGEST;
+}
+
+/**
+ * @brief Procura um caminho no manifesto (busca binária; os caminhos estão ordenados).
+ * @return O índice, ou -1 se o caminho não estiver no manifesto.
+ */
+long merkle_manifest_find(const merkle_manifest *m, const char *path)
+{
+    size_t lo = 0, hi = m->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(m->paths[mid], path);
+        if (cmp == 0)
+            return (long)mid;
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return -1;
+}
+
+/**
+ * @brief Compara um manifesto com o de conteúdo atual do diretório (merkle_manifest_build).
+ *
+ * Os dois lados estão ordenados pelo caminho: uma única passada em paralelo.
+ * Cada entrada de current->skipped também é uma diferença: não listada, ou
+ * ilegível se não pôde ser examinada.
+ *
+ * @param m Manifesto de referência (já verificado).
+ * @param current Manifesto do diretório atual.
+ * @param report Chamada para cada diferença (pode ser NULL).
+ * @param ctx Repassado a 'report'.
+ * @return O número de diferenças.
+ */
+long merkle_manifest_diff(const merkle_manifest *m, const merkle_manifest *current,
+                          void (*report)(void *ctx, const char *path, merkle_diff_kind kind), void *ctx)
+{
+    long differences = 0;
+    size_t i = 0, j = 0;
+    while (i < m->count || j < current->count)
+    {
+        int cmp = i == m->count ? 1 : j == current->count ? -1 : strcmp(m->paths[i], current->paths[j]);
+        const char *path;
+        merkle_diff_kind kind;
+        if (cmp < 0)
+        {
+            path = m->paths[i++];
+            kind = MERKLE_DIFF_MISSING;
+        }
+        else if (cmp > 0)
+        {
+            path = current->paths[j++];
+            kind = MERKLE_DIFF_UNLISTED;
+        }
+        else
+        {
+            int same = memcmp(m->digests + i * SHA3_256_DIGEST_SIZE, current->digests + j * SHA3_256_DIGEST_SIZE,
+                              SHA3_256_DIGEST_SIZE) == 0;
+            path = m->paths[i++];
+            j++;
+            if (same)
+                continue;
+            kind = MERKLE_DIFF_CHANGED;
+        }
+        if (report)
+            report(ctx, path, kind);
+        differences++;
+    }
+
+    for (size_t k = 0; k < current->skipped_count; k++)
+    {
+        const merkle_skipped *s = &current->skipped[k];
+        if (report)
+            report(ctx, s->path, s->reason == MERKLE_SKIP_UNREADABLE ? MERKLE_DIFF_UNREADABLE : MERKLE_DIFF_UNLISTED);
+        differences++;
+    }
+    return differences;
+}
+
+/**
+ * @brief Libera o manifesto.
+ */
+void merkle_manifest_clear(merkle_manifest *m)
+{
+    for (size_t i = 0; i < m->count; i++)
+        free(m->paths[i]);
+    for (size_t i = 0; i < m->skipped_count; i++)
+        free(m->skipped[i].path);
+    free(m->skipped);
+    free(m->paths);
+    free(m->digests);
+    free(m->signature);
+    memset(m, 0, sizeof(*m));
+}
+
+/**
+ * @brief Grava o cabeçalho comum (chave e número de arquivos) de manifestos e provas.
+ */
+static void merkle_write_header(FILE *out, const char *begin, const unsigned char *fingerprint, int bits,
+                                size_t count)
+{
+    char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+    bytes_to_hex(fingerprint, SHA3_256_DIGEST_SIZE, hex);
+    fprintf(out, "%s\n%s%s\n%s%d\nFiles: %zu\n", begin, FINGERPRINT_HEADER, hex, KEY_BITS_HEADER, bits, count);
+}
+
+/**
+ * @brief Grava o bloco final: raiz e assinatura em Base64.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int merkle_write_footer(FILE *out, const unsigned char *root, const unsigned char *signature,
+                               size_t signature_len)
+{
+    char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+    size_t sig_b64_len;
+    char *sig_b64 = base64_encode(signature, signature_len, &sig_b64_len);
+    if (!sig_b64)
+        return 0;
+    bytes_to_hex(root, SHA3_256_DIGEST_SIZE, hex);
+    fprintf(out, "Root: %s%s\n%s\n%s\n%s\n", MERKLE_DIGEST_PREFIX, hex, MERKLE_BEGIN_SIGNATURE, sig_b64,
+            MERKLE_END_SIGNATURE);
+    free(sig_b64);
+    return 1;
+}
+
+/**
+ * @brief Formata o manifesto assinado: cabeçalho, uma linha "<digest>  <caminho>"
+ *        por arquivo, raiz e assinatura.
+ * @return Texto alocado com malloc (liberar com free), ou NULL em falha.
+ */
+char *merkle_manifest_format(const merkle_manifest *m, size_t *len)
+{
+    char *text = NULL;
+    FILE *out = m->signature ? open_memstream(&text, len) : NULL;
+    if (!out)
+        return NULL;
+
+    merkle_write_header(out, MERKLE_BEGIN_MANIFEST, m->fingerprint, m->bits, m->count);
+    for (size_t i = 0; i < m->count; i++)
+    {
+        char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+        bytes_to_hex(m->digests + i * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE, hex);
+        fprintf(out, "%s  %s\n", hex, m->paths[i]);
+    }
+    int ok = merkle_write_footer(out, m->root, m->signature, m->signature_len);
+    if (fclose(out) != 0 || !ok)
+    {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Campos comuns de manifestos e provas enquanto o texto é lido.
+ */
+typedef struct
+{
+    unsigned char fingerprint[SHA3_256_DIGEST_SIZE];
+    int has_fingerprint;
+    int bits;
+    size_t count;
+    int has_count;
+    unsigned char root[SHA3_256_DIGEST_SIZE];
+    int has_root;
+    unsigned char *signature;
+    size_t signature_len;
+} merkle_common;
+
+/**
+ * @brief Lê uma linha de cabeçalho comum (chave, arquivos, raiz) ou o bloco da assinatura.
+ * @param line Linha sem o '\n' final.
+ * @param in_signature Estado do bloco de assinatura (0 antes, 1 dentro, 2 depois).
+ * @return 1 se a linha foi reconhecida, 0 caso contrário.
+ */
+static int merkle_common_line(merkle_common *c, char *line, int *in_signature)
+{
+    if (*in_signature == 1)
+    {
+        if (strcmp(line, MERKLE_END_SIGNATURE) == 0)
+            *in_signature = 2;
+        else if (!c->signature && *line)
+            c->signature = base64_decode(line, strlen(line), &c->signature_len);
+        return 1;
+    }
+    if (strcmp(line, MERKLE_BEGIN_SIGNATURE) == 0)
+    {
+        *in_signature = 1;
+        return 1;
+    }
+    if (strncmp(line, FINGERPRINT_HEADER, strlen(FINGERPRINT_HEADER)) == 0)
+    {
+        c->has_fingerprint = hex_to_bytes(line + strlen(FINGERPRINT_HEADER), c->fingerprint, SHA3_256_DIGEST_SIZE);
+        return 1;
+    }
+    if (strncmp(line, KEY_BITS_HEADER, strlen(KEY_BITS_HEADER)) == 0)
+    {
+        c->bits = atoi(line + strlen(KEY_BITS_HEADER));
+        return 1;
+    }
+    if (strncmp(line, "Files: ", 7) == 0)
+    {
+        c->count = strtoul(line + 7, NULL, 10);
+        c->has_count = 1;
+        return 1;
+    }
+    if (strncmp(line, "Root: " MERKLE_DIGEST_PREFIX, 6 + strlen(MERKLE_DIGEST_PREFIX)) == 0)
+    {
+        c->has_root = hex_to_bytes(line + 6 + strlen(MERKLE_DIGEST_PREFIX), c->root, SHA3_256_DIGEST_SIZE);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Percorre as linhas de um texto, chamando 'fn' para cada uma (sem o '\n').
+ *
+ * O texto é copiado para que cada linha possa ser terminada com '\0'.
+ * @return 1 se o texto começar com 'begin' e todas as linhas forem aceitas, 0 caso contrário.
+ */
+static int merkle_for_each_line(const char *text, size_t len, const char *begin,
+                                int (*fn)(void *ctx, merkle_common *c, char *line), void *ctx,
+                                merkle_common *c)
+{
+    char *copy = malloc(len + 1);
+    if (!copy)
+        return 0;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+
+    int ok = 1, first = 1, in_signature = 0;
+    char *save = NULL;
+    for (char *line = strtok_r(copy, "\n", &save); ok && line; line = strtok_r(NULL, "\n", &save))
+    {
+        line[strcspn(line, "\r")] = '\0';
+        if (first)
+        {
+            ok = strcmp(line, begin) == 0;
+            first = 0;
+        }
+        else if (in_signature == 2)
+            continue; // Texto depois do fim da assinatura é ignorado
+        else if (!merkle_common_line(c, line, &in_signature))
+            ok = fn(ctx, c, line);
+    }
+    free(copy);
+    return ok && !first && c->has_count && c->has_root;
+}
+
+typedef struct
+{
+    merkle_manifest *m;
+    size_t alloc; // Capacidade de paths e digests
+} merkle_parse_ctx;
+
+/**
+ * @brief Linha de arquivo do manifesto: "<digest hex>  <caminho>".
+ */
+static int merkle_manifest_line(void *ctx, merkle_common *c, char *line)
+{
+    merkle_parse_ctx *p = (merkle_parse_ctx *)ctx;
+    merkle_manifest *m = p->m;
+    size_t hex_len = 2 * SHA3_256_DIGEST_SIZE;
+    if (!c->has_count || m->count >= c->count || strlen(line) < hex_len + 3 || line[hex_len] != ' ' ||
+        line[hex_len + 1] != ' ')
+        return 0;
+
+    if (m->count == p->alloc)
+    {
+        size_t grown = p->alloc ? p->alloc * 2 : 64;
+        char **paths = realloc(m->paths, grown * sizeof(char *));
+        if (paths)
+            m->paths = paths;
+        unsigned char *digests = paths ? realloc(m->digests, grown * SHA3_256_DIGEST_SIZE) : NULL;
+        if (!digests)
+            return 0;
+        m->digests = digests;
+        p->alloc = grown;
+    }
+
+    line[hex_len] = '\0';
+    if (!hex_to_bytes(line, m->digests + m->count * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE))
+        return 0;
+    m->paths[m->count] = strdup(line + hex_len + 2);
+    return m->paths[m->count++] != NULL;
+}
+
+/**
+ * @brief Lê um manifesto assinado e confere que a raiz declarada é a das folhas listadas.
+ * @return 1 em sucesso, 0 se o texto for inválido ou a raiz não corresponder.
+ */
+int merkle_manifest_parse(const char *text, size_t len, merkle_manifest *m)
+{
+    memset(m, 0, sizeof(*m));
+    merkle_common c;
+    memset(&c, 0, sizeof(c));
+    merkle_parse_ctx ctx = {m, 0};
+
+    int ok = merkle_for_each_line(text, len, MERKLE_BEGIN_MANIFEST, merkle_manifest_line, &ctx, &c) &&
+             m->count == c.count;
+
+    m->signature = c.signature;
+    m->signature_len = c.signature_len;
+    memcpy(m->fingerprint, c.fingerprint, SHA3_256_DIGEST_SIZE);
+    m->has_fingerprint = c.has_fingerprint;
+    m->bits = c.bits;
+    memcpy(m->root, c.root, SHA3_256_DIGEST_SIZE);
+
+    // Caminhos fora de ordem ou repetidos mudariam as posições das provas
+    for (size_t i = 1; ok && i < m->count; i++)
+        ok = strcmp(m->paths[i - 1], m->paths[i]) < 0;
+
+    unsigned char root[SHA3_256_DIGEST_SIZE];
+    return ok && merkle_compute_root(m, root) && memcmp(root, m->root, SHA3_256_DIGEST_SIZE) == 0;
+}
+
+/**
+ * @brief Monta a prova de inclusão do arquivo 'index' do manifesto.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int merkle_proof_create(const merkle_manifest *m, size_t index, merkle_proof *proof)
+{
+    memset(proof, 0, sizeof(*proof));
+    if (index >= m->count || !m->signature)
+        return 0;
+
+    unsigned char *level = merkle_leaves(m);
+    proof->siblings = malloc(64 * SHA3_256_DIGEST_SIZE); // Profundidade máxima para 2^64 folhas
+    proof->signature = malloc(m->signature_len);
+    proof->path = strdup(m->paths[index]);
+    if (!level || !proof->siblings || !proof->signature || !proof->path)
+    {
+        free(level);
+        merkle_proof_clear(proof);
+        return 0;
+    }
+
+    size_t pos = index;
+    for (size_t n = m->count; n > 1; n = merkle_reduce(level, n), pos /= 2)
+    {
+        size_t sibling = pos ^ 1;
+        if (sibling < n)
+            memcpy(proof->siblings + proof->depth++ * SHA3_256_DIGEST_SIZE, level + sibling * SHA3_256_DIGEST_SIZE,
+                   SHA3_256_DIGEST_SIZE);
+    }
+    free(level);
+
+    proof->index = index;
+    proof->count = m->count;
+    memcpy(proof->digest, m->digests + index * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE);
+    memcpy(proof->root, m->root, SHA3_256_DIGEST_SIZE);
+    memcpy(proof->signature, m->signature, m->signature_len);
+    proof->signature_len = m->signature_len;
+    memcpy(proof->fingerprint, m->fingerprint, SHA3_256_DIGEST_SIZE);
+    proof->has_fingerprint = m->has_fingerprint;
+    proof->bits = m->bits;
+    return 1;
+}
+
+/**
+ * @brief Formata a prova de inclusão.
+ * @return Texto alocado com malloc (liberar com free), ou NULL em falha.
+ */
+char *merkle_proof_format(const merkle_proof *proof, size_t *len)
+{
+    char *text = NULL;
+    FILE *out = open_memstream(&text, len);
+    if (!out)
+        return NULL;
+
+    char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+    merkle_write_header(out, MERKLE_BEGIN_PROOF, proof->fingerprint, proof->bits, proof->count);
+    bytes_to_hex(proof->digest, SHA3_256_DIGEST_SIZE, hex);
+    fprintf(out, "Index: %zu\nPath: %s\nFile-Digest: %s%s\n", proof->index, proof->path, MERKLE_DIGEST_PREFIX, hex);
+    for (size_t i = 0; i < proof->depth; i++)
+    {
+        bytes_to_hex(proof->siblings + i * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE, hex);
+        fprintf(out, "Sibling: %s\n", hex);
+    }
+    int ok = merkle_write_footer(out, proof->root, proof->signature, proof->signature_len);
+    if (fclose(out) != 0 || !ok)
+    {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Linhas próprias da prova: índice, caminho, digest do arquivo e irmãos.
+ */
+static int merkle_proof_line(void *ctx, merkle_common *c, char *line)
+{
+    (void)c; // A contagem de folhas da prova só é conferida depois da leitura
+    merkle_proof *proof = (merkle_proof *)ctx;
+    if (strncmp(line, "Index: ", 7) == 0)
+    {
+        proof->index = strtoul(line + 7, NULL, 10);
+        return 1;
+    }
+    if (strncmp(line, "Path: ", 6) == 0 && !proof->path)
+    {
+        proof->path = strdup(line + 6);
+        return proof->path != NULL;
+    }
+    if (strncmp(line, "File-Digest: " MERKLE_DIGEST_PREFIX, 13 + strlen(MERKLE_DIGEST_PREFIX)) == 0)
+        return hex_to_bytes(line + 13 + strlen(MERKLE_DIGEST_PREFIX), proof->digest, SHA3_256_DIGEST_SIZE);
+    if (strncmp(line, "Sibling: ", 9) == 0 && proof->depth < 64)
+        return hex_to_bytes(line + 9, proof->siblings + proof->depth++ * SHA3_256_DIGEST_SIZE, SHA3_256_DIGEST_SIZE);
+    return 0;
+}
+
+/**
+ * @brief Lê uma prova de inclusão.
+ * @return 1 em sucesso, 0 se o texto for inválido.
+ */
+int merkle_proof_parse(const char *text, size_t len, merkle_proof *proof)
+{
+    memset(proof, 0, sizeof(*proof));
+    merkle_common c;
+    memset(&c, 0, sizeof(c));
+    proof->siblings = malloc(64 * SHA3_256_DIGEST_SIZE);
+    int ok = proof->siblings && merkle_for_each_line(text, len, MERKLE_BEGIN_PROOF, merkle_proof_line, proof, &c);
+
+    proof->count = c.count;
+    proof->signature = c.signature;
+    proof->signature_len = c.signature_len;
+    memcpy(proof->fingerprint, c.fingerprint, SHA3_256_DIGEST_SIZE);
+    proof->has_fingerprint = c.has_fingerprint;
+    proof->bits = c.bits;
+    memcpy(proof->root, c.root, SHA3_256_DIGEST_SIZE);
+    return ok && proof->path && proof->index < proof->count;
+}
+
+/**
+ * @brief Verifica um arquivo com a sua prova de inclusão: o digest do arquivo, o
+ *        caminho até a raiz e a assinatura da raiz.
+ * @param file_digest SHA3-256 do conteúdo atual do arquivo.
+ * @return VERIFY_OK se o arquivo pertencer ao manifesto assinado; caso contrário, o motivo.
+ */
+verify_status merkle_proof_verify(const merkle_proof *proof, const rsa_key *key, const unsigned char *file_digest)
+{
+    if (!proof->signature)
+        return VERIFY_NO_SIGNATURE;
+    if (proof->bits != 0 && proof->bits != rsa_key_bits(key))
+        return VERIFY_KEY_MISMATCH;
+    if (memcmp(file_digest, proof->digest, SHA3_256_DIGEST_SIZE) != 0)
+        return VERIFY_BAD_DIGEST;
+
+    // Sobe da folha até a raiz; a posição e o tamanho de cada nível dizem de que lado está o irmão
+    unsigned char node[SHA3_256_DIGEST_SIZE];
+    merkle_leaf(proof->path, file_digest, node);
+    size_t used = 0, pos = proof->index;
+    for (size_t n = proof->count; n > 1; n = (n + 1) / 2, pos /= 2)
+    {
+        if ((pos ^ 1) >= n)
+            continue; // Sem par neste nível
+        if (used == proof->depth)
+            return VERIFY_BAD_DIGEST;
+        const unsigned char *sibling = proof->siblings + used++ * SHA3_256_DIGEST_SIZE;
+        if (pos & 1)
+            merkle_node(sibling, node, node);
+        else
+            merkle_node(node, sibling, node);
+    }
+    if (used != proof->depth || memcmp(node, proof->root, SHA3_256_DIGEST_SIZE) != 0)
+        return VERIFY_BAD_DIGEST;
+
+    unsigned char signed_digest[SHA3_256_DIGEST_SIZE], digest[SHA3_256_DIGEST_SIZE];
+    if (!rsa_recover_digest(key, SIGN_DOMAIN_MERKLE, proof->signature, proof->signature_len, signed_digest))
+        return VERIFY_BAD_PADDING;
+    merkle_signed_digest(proof->root, proof->count, digest);
+    return memcmp(signed_digest, digest, SHA3_256_DIGEST_SIZE) == 0 ? VERIFY_OK : VERIFY_BAD_DIGEST;
+}
+
+/**
+ * @brief Libera a prova.
+ */
+void merkle_proof_clear(merkle_proof *proof)
+{
+    free(proof->path);
+    free(proof->siblings);
+    free(proof->signature);
+    memset(proof, 0, sizeof(*proof));
+}
+
+// --- Cache de resultados de verificação ---
+//
+// O arquivo do cache tem um cabeçalho de 64 bytes e 'capacity' posições de 64
+// bytes. A chave de cada posição é um SHA3-256 da identidade do arquivo
+// verificado (dispositivo, inode, tamanho, mtime e ctime, ou o digest do
+// conteúdo) e da impressão digital da chave; a posição inicial vem dos
+// primeiros 8 bytes desse digest, como no keyring. A sondagem para em
+// VERIFY_CACHE_PROBES posições: sem espaço, a entrada mais antiga da janela é
+// substituída, de modo que entradas de arquivos alterados nunca são
+// encontradas e acabam sobrescritas.
+
+#define VERIFY_CACHE_MAGIC "RSVC"
+#define VERIFY_CACHE_VERSION 1
+#define VERIFY_CACHE_HEADER_SIZE 64
+#define VERIFY_CACHE_PROBES 16
+#define VERIFY_CACHE_MAX_SLOTS (1ULL << 26) // 4 GiB de posições
+
+/**
+ * @brief Posição do cache (64 bytes).
+ */
+typedef struct
+{
+    unsigned char key[SHA3_256_DIGEST_SIZE];
+    uint64_t stored_at; // Segundos desde a época (0 = posição vazia)
+    uint32_t status;    // verify_status
+    uint32_t reserved;
+    uint64_t check;     // Soma da posição, contra gravações interrompidas
+    uint64_t reserved2;
+} verify_cache_slot;
+
+/**
+ * @brief Soma de verificação (FNV-1a) da chave, do instante e do resultado.
+ */
+static uint64_t verify_cache_check(const verify_cache_slot *slot)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    const unsigned char *p = (const unsigned char *)slot;
+    size_t len = offsetof(verify_cache_slot, check);
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+/**
+ * @brief Lê a capacidade de um cabeçalho de cache existente.
+ * @return A capacidade, ou 0 se o cabeçalho não for de um cache desta versão.
+ */
+static uint64_t verify_cache_header_capacity(const unsigned char *header)
+{
+    uint64_t capacity = get_be64(header + 8);
+    int ok = memcmp(header, VERIFY_CACHE_MAGIC, 4) == 0 && get_be32(header + 4) == VERIFY_CACHE_VERSION &&
+             get_be32(header + 16) == sizeof(verify_cache_slot) && capacity >= VERIFY_CACHE_PROBES &&
+             capacity <= VERIFY_CACHE_MAX_SLOTS && (capacity & (capacity - 1)) == 0;
+    return ok ? capacity : 0;
+}
+
+/**
+ * @brief Abre (ou cria) o cache de verificação e o mapeia na memória.
+ *
+ * Só um arquivo novo ou vazio é inicializado, com 'slots' posições. Um cache
+ * existente é usado com a capacidade do seu cabeçalho; qualquer outro arquivo
+ * (magic, versão ou tamanho diferentes) não é alterado, e a abertura falha com
+ * errno = EINVAL. O caminho é usado como recebido: um caminho relativo é
+ * resolvido a partir do diretório de trabalho atual.
+ * @param slots Número de posições de um cache novo (arredondado para potência de 2).
+ * @return 1 em sucesso, 0 em falha (errno indica o motivo).
+ */
+int verify_cache_open(verify_cache *cache, const char *path, uint64_t slots)
+{
+    memset(cache, 0, sizeof(*cache));
+    if (slots > VERIFY_CACHE_MAX_SLOTS)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+
+    cache->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (cache->fd < 0)
+        return 0;
+    if (flock(cache->fd, LOCK_EX) != 0)
+    {
+        int err = errno;
+        close(cache->fd);
+        errno = err;
+        return 0;
+    }
+
+    struct stat st;
+    unsigned char header[VERIFY_CACHE_HEADER_SIZE];
+    int valid = fstat(cache->fd, &st) == 0;
+    int err = valid ? 0 : errno;
+    if (valid && !S_ISREG(st.st_mode))
+    {
+        valid = 0;
+        err = EINVAL;
+    }
+    else if (valid && st.st_size == 0)
+    {
+        // Arquivo novo (ou vazio): cria o cache com 'slots' posições
+        cache->capacity = 1;
+        while (cache->capacity < slots || cache->capacity < VERIFY_CACHE_PROBES)
+            cache->capacity <<= 1;
+        cache->map_len = VERIFY_CACHE_HEADER_SIZE + cache->capacity * sizeof(verify_cache_slot);
+
+        memset(header, 0, sizeof(header));
+        memcpy(header, VERIFY_CACHE_MAGIC, 4);
+        put_be32(header + 4, VERIFY_CACHE_VERSION);
+        put_be64(header + 8, cache->capacity);
+        put_be32(header + 16, sizeof(verify_cache_slot));
+        valid = ftruncate(cache->fd, (off_t)cache->map_len) == 0 &&
+                pwrite(cache->fd, header, sizeof(header), 0) == (ssize_t)sizeof(header);
+        err = valid ? 0 : errno;
+    }
+    else if (valid)
+    {
+        // Arquivo existente: precisa ser um cache íntegro, que nunca é sobrescrito
+        valid = (uint64_t)st.st_size >= VERIFY_CACHE_HEADER_SIZE &&
+                pread_full(cache->fd, header, sizeof(header), 0) &&
+                (cache->capacity = verify_cache_header_capacity(header)) != 0;
+        cache->map_len = VERIFY_CACHE_HEADER_SIZE + cache->capacity * sizeof(verify_cache_slot);
+        valid = valid && (uint64_t)st.st_size == cache->map_len;
+        err = valid ? 0 : EINVAL;
+    }
+    if (valid)
+    {
+        cache->map = mmap(NULL, cache->map_len, PROT_READ | PROT_WRITE, MAP_SHARED, cache->fd, 0);
+        valid = cache->map != MAP_FAILED;
+        err = valid ? 0 : errno;
+    }
+    flock(cache->fd, LOCK_UN);
+    if (!valid)
+    {
+        close(cache->fd);
+        memset(cache, 0, sizeof(*cache));
+        errno = err;
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Desfaz o mapeamento e fecha o cache.
+ */
+void verify_cache_close(verify_cache *cache)
+{
+    if (cache->map)
+    {
+        munmap(cache->map, cache->map_len);
+        close(cache->fd);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+/**
+ * @brief Chave do cache a partir da identidade do arquivo no sistema de arquivos.
+ *
+ * O ctime entra na chave porque muda a cada escrita, troca de nome ou de
+ * permissões e não pode ser restaurado pelo usuário (ao contrário do mtime).
+ * Arquivos alterados há menos de VERIFY_CACHE_RACY_SECONDS não são aceitos: um
+ * sistema de arquivos com carimbos de tempo grosseiros poderia não distinguir
+ * uma nova escrita no mesmo segundo.
+ * @return 1 em sucesso, 0 se o arquivo não puder ser consultado ou for recente demais.
+ */
+int verify_cache_stat_key(const char *filename, const unsigned char *fingerprint, unsigned char *key)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0 || !S_ISREG(st.st_mode))
+        return 0;
+    time_t now = time(NULL);
+    if (st.st_mtime > now - VERIFY_CACHE_RACY_SECONDS || st.st_ctime > now - VERIFY_CACHE_RACY_SECONDS)
+        return 0;
+
+    unsigned char identity[4 + 7 * 8];
+    memcpy(identity, "stat", 4);
+    put_be64(identity + 4, (uint64_t)st.st_dev);
+    put_be64(identity + 12, (uint64_t)st.st_ino);
+    put_be64(identity + 20, (uint64_t)st.st_size);
+    put_be64(identity + 28, (uint64_t)st.st_mtim.tv_sec);
+    put_be64(identity + 36, (uint64_t)st.st_mtim.tv_nsec);
+    put_be64(identity + 44, (uint64_t)st.st_ctim.tv_sec);
+    put_be64(identity + 52, (uint64_t)st.st_ctim.tv_nsec);
+
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHA3_DOMAIN);
+    keccak_absorb(&sponge, identity, sizeof(identity));
+    keccak_absorb(&sponge, fingerprint, SHA3_256_DIGEST_SIZE);
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, key, SHA3_256_DIGEST_SIZE);
+    return 1;
+}
+
+/**
+ * @brief Chave do cache a partir do conteúdo do arquivo assinado (vale para cópias e
+ *        para a entrada padrão, ao custo de um SHA3-256 do arquivo).
+ */
+void verify_cache_content_key(const unsigned char *data, size_t len, const unsigned char *fingerprint,
+                              unsigned char *key)
+{
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    sha3_256(data, len, digest);
+
+    keccak_sponge sponge;
+    keccak_init(&sponge, SHA3_256_RATE, SHA3_DOMAIN);
+    keccak_absorb(&sponge, (const unsigned char *)"data", 4);
+    keccak_absorb(&sponge, digest, SHA3_256_DIGEST_SIZE);
+    keccak_absorb(&sponge, fingerprint, SHA3_256_DIGEST_SIZE);
+    keccak_finalize(&sponge);
+    keccak_squeeze(&sponge, key, SHA3_256_DIGEST_SIZE);
+}
+
+/**
+ * @brief Posição 'i' (módulo a capacidade) da janela de sondagem de 'key'.
+ */
+static verify_cache_slot *verify_cache_slot_at(verify_cache *cache, const unsigned char *key, unsigned i)
+{
+    uint64_t start = get_be64(key);
+    verify_cache_slot *slots = (verify_cache_slot *)(cache->map + VERIFY_CACHE_HEADER_SIZE);
+    return &slots[(start + i) & (cache->capacity - 1)];
+}
+
+/**
+ * @brief Procura o resultado de uma verificação anterior.
+ * @return 1 se encontrado (resultado em 'status'), 0 caso contrário.
+ */
+int verify_cache_lookup(verify_cache *cache, const unsigned char *key, verify_status *status)
+{
+    if (!cache->map || flock(cache->fd, LOCK_SH) != 0)
+        return 0;
+
+    int found = 0;
+    for (unsigned i = 0; i < VERIFY_CACHE_PROBES && !found; i++)
+    {
+        const verify_cache_slot *slot = verify_cache_slot_at(cache, key, i);
+        if (slot->stored_at == 0)
+            break;
+        if (memcmp(slot->key, key, SHA3_256_DIGEST_SIZE) == 0 && slot->check == verify_cache_check(slot) &&
+            slot->status <= VERIFY_BAD_DIGEST)
+        {
+            *status = (verify_status)slot->status;
+            found = 1;
+        }
+    }
+    flock(cache->fd, LOCK_UN);
+    if (found)
+        cache->hits++;
+    else
+        cache->misses++;
+    return found;
+}
+
+/**
+ * @brief Grava um resultado; sem posição livre na janela, substitui a entrada mais antiga.
+ * @return 1 em sucesso, 0 em falha.
+ */
+int verify_cache_store(verify_cache *cache, const unsigned char *key, verify_status status)
+{
+    if (!cache->map || flock(cache->fd, LOCK_EX) != 0)
+        return 0;
+
+    verify_cache_slot *target = NULL;
+    for (unsigned i = 0; i < VERIFY_CACHE_PROBES; i++)
+    {
+        verify_cache_slot *slot = verify_cache_slot_at(cache, key, i);
+        if (slot->stored_at == 0 || memcmp(slot->key, key, SHA3_256_DIGEST_SIZE) == 0)
+        {
+            target = slot;
+            break;
+        }
+        if (!target || slot->stored_at < target->stored_at)
+            target = slot;
+    }
+
+    verify_cache_slot entry;
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.key, key, SHA3_256_DIGEST_SIZE);
+    entry.stored_at = (uint64_t)time(NULL);
+    entry.status = (uint32_t)status;
+    entry.check = verify_cache_check(&entry);
+    *target = entry;
+    flock(cache->fd, LOCK_UN);
+    cache->stores++;
+    return 1;
+}
+
+/**
+ * @brief Lê a impressão digital do cabeçalho de um arquivo assinado, sem decodificá-lo.
+ * @return 1 se o cabeçalho Key-Fingerprint for encontrado antes da mensagem, 0 caso contrário.
+ */
+int signed_file_fingerprint(const char *text, size_t len, unsigned char *fingerprint)
+{
+    size_t prefix = strlen(FINGERPRINT_HEADER);
+    for (const char *line = text, *end = text + len; line < end;)
+    {
+        const char *newline = memchr(line, '\n', end - line);
+        size_t line_len = (newline ? newline : end) - line;
+        if (line_len >= prefix + 2 * SHA3_256_DIGEST_SIZE && memcmp(line, FINGERPRINT_HEADER, prefix) == 0)
+        {
+            char hex[2 * SHA3_256_DIGEST_SIZE + 1];
+            memcpy(hex, line + prefix, 2 * SHA3_256_DIGEST_SIZE);
+            hex[2 * SHA3_256_DIGEST_SIZE] = '\0';
+            return hex_to_bytes(hex, fingerprint, SHA3_256_DIGEST_SIZE);
+        }
+        if (line_len >= 5 && memcmp(line, "-----", 5) == 0)
+            break; // Início do índice ou da mensagem
+        line = newline ? newline + 1 : end;
+    }
+    return 0;
+}
@@ -0,0 +1,575 @@
+/**
+ * @file rsa_sign.h
+ * @brief API em C da biblioteca librsa_sign (SHA3, Base64, OAEP, geração de chaves,
+ *        assinatura, verificação e formato dos arquivos assinados).
+ *
+ * Todas as funções recebem chaves e buffers em memória; as que leem ou gravam
+ * arquivos são apenas atalhos sobre as versões em memória. A interface de menus
+ * (main.c) é um cliente desta API como qualquer outro serviço.
+ *
+ * Funções que retornam int devolvem 1 em sucesso e 0 em falha, salvo indicação
+ * em contrário. Buffers devolvidos pela biblioteca são liberados com free().
+ *
+ * Autor: Yan Tavares e Eduardo Marques
+ * Disciplina: CIC0201 - Segurança Computacional
+ */
+
+#ifndef RSA_SIGN_H
+#define RSA_SIGN_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <gmp.h>
+
+// Versão da API; muda somente quando uma assinatura pública deixa de ser compatível
+#define RSA_SIGN_API_VERSION 5
+
+// --- Constantes ---
+#define DEFAULT_KEY_BITS 2048
+#define MILLER_RABIN_ITERATIONS 40 // Rodadas fixas da busca por sorteio simples
+#define MR_MONT_MIN_BITS 768       // A partir daqui o Miller-Rabin usa o motor de Montgomery; abaixo, o mpz_powm
+#define SHA3_256_DIGEST_SIZE 32
+#define SHA3_256_RATE 136 // 1088 bits: taxa do SHA3-256 e do SHAKE256 (capacidade de 512 bits)
+#define FINGERPRINT_HEADER "Key-Fingerprint: sha3-256:"
+#define KEY_BITS_HEADER "Key-Bits: "
+#define DIGEST_HEADER "Digest: sha3-256:"
+#define DIGEST_REQUEST_SUFFIX ".sigreq"   // Pedido do cliente: só o digest
+#define DIGEST_RESPONSE_SUFFIX ".sigresp" // Resposta do host: digest, chave e assinatura
+#define CHUNK_SIZE_HEADER "Chunk-Size: "
+#define CONTENT_LENGTH_HEADER "Content-Length: "
+#define CHUNKS_HEADER "Chunks: "
+#define CHUNK_DEFAULT_SIZE (3u << 20) // 3 MiB por bloco: múltiplo de 3, vira 4 MiB de Base64 sem '='
+
+#define DRBG_BUFFER_BYTES (4 * SHA3_256_RATE) // Saída extraída de uma vez (4 blocos do SHAKE256)
+#define BENCHMARK_SEED 20250713UL             // Semente fixa dos benchmarks
+#define MB_LANES 8                            // Assinaturas por lote do motor multi-buffer
+#define KEYPOOL_MAX_DEPTH 256
+#define KEYPOOL_MAX_REFILLERS 64
+#define STATS_DEFAULT_PATH "keygen_stats.json" // Destino padrão do JSON de --stats
+#define VERIFY_CACHE_DEFAULT_PATH "verify_cache.bin" // Cache padrão de --cache, relativo ao diretório atual
+#define VERIFY_CACHE_DEFAULT_SLOTS 65536             // 4 MiB com posições de 64 bytes
+#define VERIFY_CACHE_RACY_SECONDS 2 // Arquivos alterados há menos que isso não entram no cache
+
+// Tamanhos de módulo aceitos na geração de chaves
+#define KEY_SIZE_COUNT 4
+extern const int key_sizes[KEY_SIZE_COUNT];
+
+// --- Tipos ---
+
+// Teste de primalidade usado na geração de primos
+typedef enum
+{
+    PRIMALITY_MILLER_RABIN, // Miller-Rabin com as rodadas do FIPS 186-5
+    PRIMALITY_BPSW          // Baillie-PSW (base 2 + Lucas forte)
+} primality_mode;
+
+/**
+ * @brief Esponja Keccak incremental: absorve em qualquer quantidade de chamadas e,
+ *        depois de keccak_finalize, extrai quantos bytes forem pedidos.
+ */
+typedef struct
+{
+    uint64_t state[25];
+    size_t rate;          // Bytes por bloco (200 - capacidade)
+    size_t pos;           // Posição no bloco atual (absorção ou extração)
+    unsigned char domain; // Sufixo de domínio já com o início do padding 10*1
+} keccak_sponge;
+
+/**
+ * @brief DRBG com buffer: a saída do SHAKE256 é extraída em blocos inteiros para
+ *        'buffer', e cada pedido é um memcpy da parte ainda não usada.
+ *
+ * Bytes entregues são apagados do buffer. Um gerador semeado pelo sistema
+ * (reseed_left > 0) mistura entropia nova do getrandom a cada DRBG_RESEED_BYTES;
+ * um gerador com semente fixa nunca faz isso, e o fluxo é o mesmo do SHAKE256
+ * sem buffer.
+ */
+typedef struct
+{
+    keccak_sponge sponge;                     // SHAKE256 já finalizado, em fase de extração
+    unsigned char buffer[DRBG_BUFFER_BYTES];  // Saída pré-extraída
+    size_t available;                         // Bytes ainda não usados no fim do buffer
+    unsigned long reseed_left;                // Bytes até a próxima mistura de entropia (0 = nunca)
+} drbg;
+
+/**
+ * @brief Contexto de Montgomery para um módulo fixo.
+ *
+ * Guarda apenas constantes, calculadas uma única vez em mont_ctx_init; depois
+ * disso o contexto é somente leitura e pode ser compartilhado entre threads.
+ * Os rascunhos ficam com cada operação. Os limbs são armazenados do
+ * menos para o mais significativo (ordem do GMP).
+ */
+typedef struct
+{
+    mp_size_t nlimbs; // Número de limbs do módulo
+    mp_limb_t n0inv;  // -n^(-1) mod 2^GMP_NUMB_BITS
+    mp_limb_t *n;     // Módulo n
+    mp_limb_t *r2;    // R^2 mod n, com R = 2^(GMP_NUMB_BITS * nlimbs)
+} mont_ctx;
+
+/**
+ * @brief Domínio de uma assinatura: cada modo assina com a sua label OAEP.
+ *
+ * A label entra no DB do OAEP (lHash), então uma assinatura de um modo não
+ * passa na remoção do padding de outro, mesmo que o digest assinado coincida
+ * (por exemplo, um arquivo simples cujo conteúdo seja a mensagem que o
+ * manifesto assina).
+ */
+typedef enum
+{
+    SIGN_DOMAIN_PLAIN,  // Arquivo assinado simples e assinatura de digest ("segcomp-plain")
+    SIGN_DOMAIN_MERKLE, // Raiz de manifesto Merkle ("segcomp-merkle-v1")
+    SIGN_DOMAIN_CHUNKS, // Índice de blocos ("segcomp-chunks-v1")
+    SIGN_DOMAIN_COUNT
+} sign_domain;
+
+/**
+ * @brief Contexto OAEP de um tamanho de módulo: lHash da label de cada domínio e
+ *        o buffer de rascunho da máscara do DB, alocados uma única vez.
+ *
+ * Não é compartilhável entre threads (o rascunho é reutilizado a cada chamada);
+ * use oaep_thread_ctx para obter o contexto da thread atual.
+ */
+typedef struct
+{
+    int k;                                                         // Tamanho do módulo em bytes (0 = não inicializado)
+    size_t db_len;                                                 // k - hLen - 1
+    unsigned char l_hash[SIGN_DOMAIN_COUNT][SHA3_256_DIGEST_SIZE]; // SHA3-256 da label de cada domínio
+    unsigned char *scratch;                                        // db_len bytes: máscara do DB (e o DB no unpad)
+} oaep_ctx;
+
+/**
+ * @brief Resultado de rsa_oaep_pad e rsa_oaep_unpad (texto em oaep_status_message).
+ */
+typedef enum
+{
+    OAEP_OK = 0,         // Sucesso
+    OAEP_TOO_LONG,       // Mensagem longa demais para o módulo
+    OAEP_BAD_FIRST_BYTE, // Primeiro byte diferente de zero
+    OAEP_BAD_LABEL,      // lHash diferente do da label do domínio
+    OAEP_NO_SEPARATOR,   // Separador 0x01 não encontrado
+    OAEP_TOO_SMALL       // Mensagem maior que o buffer de saída
+} oaep_status;
+
+/**
+ * @brief Chave RSA carregada em memória, com os valores pré-calculados.
+ *
+ * Depois de carregada, a chave só é lida pelas operações que recebem
+ * const rsa_key *, e pode ser usada por várias threads ao mesmo tempo.
+ */
+typedef struct
+{
+    mpz_t n, e, d;                                   // d só é usado em chaves privadas
+    mpz_t p, q, dp, dq, qinv;                        // Parâmetros CRT (apenas se has_crt)
+    int is_private;                                  // 1 se d estiver disponível
+    int has_crt;                                     // 1 se os parâmetros CRT estiverem disponíveis
+    unsigned char fingerprint[SHA3_256_DIGEST_SIZE]; // SHA3-256(n || e)
+    mont_ctx mont;                                   // Constantes de Montgomery de n
+} rsa_key;
+
+/**
+ * @brief Pool em memória de pares de chaves prontos para provisionamento.
+ *
+ * Uma fila circular de 'depth' chaves, reposta por threads de baixa prioridade
+ * sempre que um provisionamento abre espaço. Os contadores alimentam as métricas
+ * do menu (profundidade e taxa de reposição).
+ */
+typedef struct
+{
+    rsa_key *keys;
+    int depth, head, count;
+    int pending; // Chaves em geração, já com lugar reservado
+    int bits;
+    int running;
+    pthread_mutex_t lock;
+    pthread_cond_t not_full, not_empty;
+    pthread_t refillers[KEYPOOL_MAX_REFILLERS];
+    int refiller_count;
+
+    // Métricas (protegidas por lock)
+    unsigned long generated;   // Chaves geradas pelas threads de reposição
+    unsigned long provisioned; // Chaves entregues
+    unsigned long waits;       // Provisionamentos que encontraram o pool vazio
+    double generate_seconds;   // Tempo somado das threads gerando chaves
+    double provision_seconds;  // Latência somada dos provisionamentos
+    double started;            // Início do pool (relógio monotônico)
+    int failed_refillers;      // Threads de reposição encerradas por falta de entropia
+} keypool;
+
+/**
+ * @brief Conjunto de chaves públicas confiáveis indexado por impressão digital.
+ *
+ * Tabela hash de endereçamento aberto (sondagem linear) cujo índice são os
+ * primeiros 8 bytes da impressão digital SHA3-256, já uniformemente distribuídos.
+ */
+typedef struct
+{
+    rsa_key *keys;   // Chaves carregadas
+    size_t count;    // Número de chaves
+    size_t *slots;   // Índice + 1 da chave em cada posição (0 = vazio)
+    size_t capacity; // Número de posições (potência de 2)
+} keyring;
+
+/**
+ * @brief Índice de um arquivo assinado por blocos: o SHA3-256 de cada bloco da mensagem.
+ */
+typedef struct
+{
+    uint64_t chunk_size;    // 0 se a assinatura cobrir a mensagem inteira
+    uint64_t content_len;   // Tamanho da mensagem declarado no cabeçalho
+    uint64_t count;         // Número de blocos
+    unsigned char *digests; // count * SHA3_256_DIGEST_SIZE bytes
+    uint64_t body_offset;   // Posição do Base64 da mensagem no arquivo .signed
+} chunk_index;
+
+/**
+ * @brief Conteúdo de um arquivo assinado já decodificado.
+ */
+typedef struct
+{
+    unsigned char *content;                          // Mensagem original
+    size_t content_len;
+    unsigned char *signature;                        // NULL se o arquivo não tiver assinatura
+    size_t signature_len;
+    unsigned char fingerprint[SHA3_256_DIGEST_SIZE]; // Impressão digital da chave do assinante
+    int has_fingerprint;
+    int bits; // Tamanho da chave declarado no cabeçalho (0 se ausente)
+    chunk_index chunks; // Índice dos blocos (chunks.chunk_size == 0 na assinatura simples)
+} signed_message;
+
+/**
+ * @brief Resultado da verificação de uma mensagem assinada.
+ */
+typedef enum
+{
+    VERIFY_OK = 0,       // Assinatura válida
+    VERIFY_NO_SIGNATURE, // Arquivo sem bloco de assinatura
+    VERIFY_KEY_MISMATCH, // Key-Bits do cabeçalho diferente do tamanho da chave
+    VERIFY_BAD_PADDING,  // Assinatura não decifra para um OAEP válido
+    VERIFY_BAD_DIGEST    // Digest assinado diferente do SHA3-256 da mensagem
+} verify_status;
+
+/**
+ * @brief Motivo de uma entrada do diretório ter ficado fora do manifesto.
+ */
+typedef enum
+{
+    MERKLE_SKIP_NAME,      // Nome com '\n' ou '\r', que não cabe numa linha do manifesto
+    MERKLE_SKIP_TOO_LONG,  // Caminho maior que o limite do manifesto
+    MERKLE_SKIP_SPECIAL,   // Link simbólico ou arquivo especial (não é seguido nem lido)
+    MERKLE_SKIP_UNREADABLE // lstat ou opendir falhou
+} merkle_skip_reason;
+
+/**
+ * @brief Entrada do diretório encontrada por merkle_manifest_build que não pode entrar no manifesto.
+ */
+typedef struct
+{
+    char *path; // Caminho relativo, sem escapes
+    merkle_skip_reason reason;
+} merkle_skipped;
+
+/**
+ * @brief Diferença entre um manifesto e o conteúdo atual do diretório.
+ */
+typedef enum
+{
+    MERKLE_DIFF_MISSING,   // Listado no manifesto e ausente do diretório
+    MERKLE_DIFF_UNLISTED,  // Presente no diretório e fora do manifesto
+    MERKLE_DIFF_CHANGED,   // Digest diferente do listado
+    MERKLE_DIFF_UNREADABLE // Entrada do diretório que não pôde ser examinada
+} merkle_diff_kind;
+
+/**
+ * @brief Manifesto Merkle de um diretório: arquivos ordenados pelo caminho e raiz assinada.
+ */
+typedef struct
+{
+    char **paths;             // Caminhos relativos, em ordem crescente (strcmp)
+    unsigned char *digests;   // SHA3-256 de cada arquivo (count * SHA3_256_DIGEST_SIZE bytes)
+    size_t count;
+    unsigned char root[SHA3_256_DIGEST_SIZE];
+    unsigned char *signature; // NULL enquanto o manifesto não for assinado
+    size_t signature_len;
+    unsigned char fingerprint[SHA3_256_DIGEST_SIZE];
+    int has_fingerprint;
+    int bits;
+    merkle_skipped *skipped; // Entradas fora do manifesto (só em merkle_manifest_build)
+    size_t skipped_count;
+} merkle_manifest;
+
+/**
+ * @brief Prova de inclusão de um arquivo no manifesto assinado.
+ */
+typedef struct
+{
+    char *path;
+    size_t index; // Posição do arquivo no manifesto
+    size_t count; // Número de arquivos do manifesto
+    unsigned char digest[SHA3_256_DIGEST_SIZE];
+    unsigned char *siblings; // Irmãos da folha até a raiz (depth * SHA3_256_DIGEST_SIZE bytes)
+    size_t depth;
+    unsigned char root[SHA3_256_DIGEST_SIZE];
+    unsigned char *signature;
+    size_t signature_len;
+    unsigned char fingerprint[SHA3_256_DIGEST_SIZE];
+    int has_fingerprint;
+    int bits;
+} merkle_proof;
+
+/**
+ * @brief Cache persistente de resultados de verificação, mapeado com mmap.
+ *
+ * Tabela de endereçamento aberto (sondagem linear em uma janela limitada) em um
+ * arquivo local, indexada por um SHA3-256 da identidade do arquivo verificado e
+ * da impressão digital da chave. O acesso entre processos é serializado com flock.
+ */
+typedef struct
+{
+    int fd;
+    unsigned char *map; // Cabeçalho seguido das posições
+    size_t map_len;
+    uint64_t capacity; // Número de posições (potência de 2)
+    unsigned long hits, misses, stores; // Contadores deste processo
+} verify_cache;
+
+/**
+ * @brief Etapas medidas pelo rastreamento de latência (--trace).
+ */
+typedef enum
+{
+    TRACE_READ,   // Leitura do arquivo
+    TRACE_HASH,   // SHA3-256 do conteúdo
+    TRACE_OAEP,   // Padding ou unpadding OAEP
+    TRACE_MODEXP, // Operação privada (assinatura) ou pública (verificação)
+    TRACE_BASE64, // Codificação/decodificação Base64 e formatação do arquivo assinado
+    TRACE_WRITE,  // Gravação do resultado
+    TRACE_STAGE_COUNT
+} trace_stage;
+
+/**
+ * @brief Tempo de cada etapa de uma operação.
+ */
+typedef struct
+{
+    double seconds[TRACE_STAGE_COUNT];
+    unsigned used; // Bit s ligado se a etapa s foi medida
+} trace_record;
+
+#define TRACE_BUCKETS 24 // Baldes de potência de 2 em µs: até ~8 s
+
+/**
+ * @brief Histograma por etapa (e do total, na posição TRACE_STAGE_COUNT) de várias operações.
+ */
+typedef struct
+{
+    unsigned long count[TRACE_STAGE_COUNT + 1];
+    unsigned long buckets[TRACE_STAGE_COUNT + 1][TRACE_BUCKETS];
+    double sum[TRACE_STAGE_COUNT + 1], min[TRACE_STAGE_COUNT + 1], max[TRACE_STAGE_COUNT + 1];
+} trace_histogram;
+
+// --- Configuração da geração de chaves ---
+extern primality_mode prime_test_mode;
+extern int prime_test_rounds;          // Rodadas de Miller-Rabin; 0 = tabela do FIPS 186-5
+extern int keygen_threads;             // Threads na geração de primos; 0 = processadores online
+extern int keygen_stats_enabled;       // Coleta os contadores de --stats
+extern const char *keygen_stats_path;  // Destino do JSON de --stats
+
+// --- Funções ---
+
+// Implementação Keccak do zero (SHA3-256 e SHAKE256)
+void keccak_f1600(uint64_t state[25]);
+void keccak_init(keccak_sponge *sponge, size_t rate, unsigned char domain);
+void keccak_absorb(keccak_sponge *sponge, const unsigned char *data, size_t len);
+void keccak_finalize(keccak_sponge *sponge);
+void keccak_squeeze(keccak_sponge *sponge, unsigned char *out, size_t len);
+void sha3_256(const unsigned char *input, size_t input_len, unsigned char *output);
+int sha3_256_stream(FILE *f, unsigned char *output);
+void shake256(const unsigned char *input, size_t input_len, unsigned char *output, size_t output_len);
+
+// Gerador determinístico (DRBG) com SHAKE256
+void drbg_seed(drbg *rng, const unsigned char *seed, size_t seed_len);
+void drbg_seed_ui(drbg *rng, unsigned long seed);
+int drbg_seed_system(drbg *rng);
+void drbg_bytes(drbg *rng, unsigned char *out, size_t len);
+void drbg_fork(drbg *child, drbg *parent);
+drbg *thread_rng(void);
+void thread_rng_release(void);
+void drbg_urandomb(mpz_t r, drbg *rng, mp_bitcnt_t bits);
+void drbg_urandomm(mpz_t r, drbg *rng, const mpz_t n);
+
+// Funções de Base64 (Implementação auto-contida)
+char *base64_encode(const unsigned char *src, size_t src_len, size_t *out_len);
+unsigned char *base64_decode(const char *src, size_t src_len, size_t *out_len);
+
+// Alocador em arena (GMP e buffers temporários)
+void arena_begin(void);
+void arena_end(void);
+void *arena_alloc(size_t size);
+void arena_free(void *p, size_t size);
+void *arena_realloc(void *p, size_t old_size, size_t new_size);
+void arena_install_gmp(void);
+
+// Aritmética de Montgomery (nível mpn)
+int mont_ctx_init(mont_ctx *ctx, const mpz_t n);
+void mont_ctx_clear(mont_ctx *ctx);
+int rsa_verify_e65537(const mont_ctx *ctx, const unsigned char *sig, size_t sig_len, unsigned char *out, size_t k);
+
+// Exponenciação multi-buffer com AVX-512 IFMA
+int mb_ifma_available(void);
+
+// Estatísticas da geração de chaves
+double monotonic_seconds(void);
+void keygen_stats_reset(void);
+void keygen_stats_merge(int found, double seconds);
+void keygen_stats_print(FILE *out, double keygen_seconds);
+int keygen_stats_write_json(const char *path, int bits, int threads, double keygen_seconds);
+
+// Rastreamento de latência por etapa
+void trace_attach(trace_record *rec);
+double trace_start(void);
+void trace_stop(trace_stage stage, double start);
+void trace_record_add(trace_record *rec, trace_stage stage, double seconds);
+const char *trace_stage_name(trace_stage stage);
+void trace_record_print(FILE *out, const trace_record *rec, const char *label);
+void trace_histogram_init(trace_histogram *hist);
+void trace_histogram_add(trace_histogram *hist, const trace_record *rec);
+void trace_histogram_print(FILE *out, const trace_histogram *hist, const char *title);
+
+// Miller-Rabin no domínio de Montgomery
+void mr_thread_engine_release(void);
+int miller_rabin_test_mont(const mpz_t n, int k, drbg *rng);
+int strong_probable_prime_base2(const mpz_t n);
+
+// Funções Criptográficas
+int miller_rabin_test(mpz_t n, int k, drbg *rng);
+int fips_miller_rabin_rounds(int bits);
+int strong_lucas_test(mpz_t n);
+int bpsw_test(mpz_t n);
+int is_probable_prime(mpz_t n, int bits, drbg *rng);
+void generate_prime_trial(mpz_t prime, int bits, drbg *rng);
+int generate_prime_cancelable(mpz_t prime, int bits, drbg *rng, atomic_int *cancel);
+void generate_prime(mpz_t prime, int bits, drbg *rng);
+
+// Geração Paralela de Primos
+int keygen_thread_count(void);
+void generate_prime_pair(mpz_t p, mpz_t q, int bits, drbg *rng, int threads);
+int rsa_derive_exponents(mpz_t n, mpz_t e, mpz_t d, const mpz_t p, const mpz_t q);
+void generate_rsa_keys(mpz_t n, mpz_t e, mpz_t d, mpz_t p_out, mpz_t q_out, int bits, drbg *rng);
+void mgf1(const unsigned char *seed, size_t seed_len, unsigned char *mask, size_t mask_len);
+int oaep_ctx_init(oaep_ctx *ctx, int k);
+void oaep_ctx_clear(oaep_ctx *ctx);
+oaep_ctx *oaep_thread_ctx(int k);
+void oaep_thread_ctx_release(void);
+const char *sign_domain_label(sign_domain domain);
+oaep_status rsa_oaep_pad(oaep_ctx *ctx, sign_domain domain, const unsigned char *message, size_t message_len,
+                         unsigned char *padded, drbg *rng);
+oaep_status rsa_oaep_unpad(oaep_ctx *ctx, sign_domain domain, const unsigned char *padded, unsigned char *message,
+                           size_t capacity, size_t *message_len);
+const char *oaep_status_message(oaep_status status);
+
+// Chaves RSA
+void rsa_key_init(rsa_key *key);
+void rsa_key_clear(rsa_key *key);
+void rsa_key_fingerprint(const mpz_t n, const mpz_t e, unsigned char *fingerprint);
+void rsa_key_compute_crt(rsa_key *key);
+int rsa_recover_primes(const mpz_t n, const mpz_t e, const mpz_t d, mpz_t p, mpz_t q);
+int rsa_key_finalize(rsa_key *key);
+int rsa_key_bits(const rsa_key *key);
+int rsa_key_bytes(const rsa_key *key);
+void rsa_private_op(const rsa_key *key, mpz_t out, const mpz_t m);
+int rsa_private_op_batch(const rsa_key *key, mpz_t *out, mpz_t *in, int count, int use_ifma);
+
+// Assinatura de digest
+int rsa_sign_digest(const rsa_key *key, sign_domain domain, const unsigned char *digest, unsigned char *signature,
+                    drbg *rng);
+int rsa_recover_digest(const rsa_key *key, sign_domain domain, const unsigned char *signature, size_t signature_len,
+                       unsigned char *digest);
+
+// Pool de chaves pré-geradas
+int rsa_key_generate(rsa_key *key, int bits, drbg *rng, int threads);
+int keypool_start(keypool *pool, int depth, int bits, int refillers);
+void keypool_stop(keypool *pool);
+int keypool_take(keypool *pool, rsa_key *key);
+void keypool_print_metrics(FILE *out, keypool *pool);
+
+// Arquivos de chave
+int read_file_content(const char *filename, unsigned char **buffer, size_t *len);
+int save_key_hex(const char *filename, const mpz_t n, const mpz_t exp);
+int parse_key_hex(const unsigned char *data, size_t len, mpz_t n, mpz_t exp);
+int load_key(const char *filename, mpz_t n, mpz_t exp);
+int key_size_supported(int bits);
+
+// Formato binário de chaves
+unsigned char *rsa_key_to_binary(const rsa_key *key, int is_private, size_t *len);
+int save_key_binary(const char *filename, const rsa_key *key, int is_private);
+int rsa_key_from_binary(rsa_key *key, const unsigned char *buffer, size_t len);
+int load_key_binary(const char *filename, rsa_key *key);
+int is_binary_key_file(const char *filename);
+int rsa_key_load_memory(rsa_key *key, const unsigned char *data, size_t len, int want_private);
+int load_rsa_key(const char *filename, rsa_key *key, int want_private);
+
+// Keyring indexado por impressão digital
+void bytes_to_hex(const unsigned char *bytes, size_t len, char *hex);
+int hex_to_bytes(const char *hex, unsigned char *bytes, size_t len);
+const rsa_key *keyring_find(const keyring *kr, const unsigned char *fingerprint);
+void keyring_clear(keyring *kr);
+int keyring_load(keyring *kr, const char *dirname);
+
+// Arquivo assinado
+void sha3_hash(const unsigned char *input, size_t input_len, unsigned char **output, unsigned int *output_len);
+char *signed_file_format(const rsa_key *key, const char *content_b64, const char *sig_b64, size_t *len);
+int write_signed_file(const char *signed_filename, const rsa_key *key, const char *content_b64, const char *sig_b64);
+void signed_message_clear(signed_message *msg);
+int signed_file_parse(const char *text, size_t len, signed_message *msg);
+int read_signed_file(const char *filename, signed_message *msg);
+char *rsa_sign_message(const rsa_key *key, const unsigned char *content, size_t content_len, drbg *rng, size_t *out_len);
+verify_status rsa_verify_message(const rsa_key *key, const signed_message *msg);
+
+// Assinatura por blocos
+char *rsa_sign_message_chunked(const rsa_key *key, const unsigned char *content, size_t content_len,
+                               uint64_t chunk_size, int threads, drbg *rng, size_t *out_len);
+int sign_file_chunked(const char *filename, const char *signed_filename, const rsa_key *key, uint64_t chunk_size,
+                      int threads, drbg *rng);
+int read_signed_file_index(const char *filename, signed_message *msg);
+verify_status rsa_verify_chunk_index(const rsa_key *key, const signed_message *msg);
+verify_status verify_chunked_file(const char *filename, const signed_message *msg, uint64_t first, uint64_t last,
+                                  int threads, uint64_t *bad_chunk);
+
+// Pedido e resposta da assinatura remota
+int write_digest_request(const char *filename, const unsigned char *digest);
+int read_digest_request(const char *filename, unsigned char *digest);
+int write_digest_response(const char *filename, const rsa_key *key, const unsigned char *digest, const char *sig_b64);
+int read_digest_response(const char *filename, unsigned char *fingerprint, unsigned char *digest, char **sig_b64);
+
+// Manifesto Merkle de diretórios
+int merkle_manifest_build(merkle_manifest *m, const char *dirname, int threads, const char **failed_path);
+int merkle_manifest_sign(merkle_manifest *m, const rsa_key *key, drbg *rng);
+verify_status merkle_manifest_verify(const merkle_manifest *m, const rsa_key *key);
+long merkle_manifest_find(const merkle_manifest *m, const char *path);
+long merkle_manifest_diff(const merkle_manifest *m, const merkle_manifest *current,
+                          void (*report)(void *ctx, const char *path, merkle_diff_kind kind), void *ctx);
+void merkle_manifest_clear(merkle_manifest *m);
+char *merkle_manifest_format(const merkle_manifest *m, size_t *len);
+int merkle_manifest_parse(const char *text, size_t len, merkle_manifest *m);
+int merkle_proof_create(const merkle_manifest *m, size_t index, merkle_proof *proof);
+char *merkle_proof_format(const merkle_proof *proof, size_t *len);
+int merkle_proof_parse(const char *text, size_t len, merkle_proof *proof);
+verify_status merkle_proof_verify(const merkle_proof *proof, const rsa_key *key, const unsigned char *file_digest);
+void merkle_proof_clear(merkle_proof *proof);
+
+// Cache de resultados de verificação
+int verify_cache_open(verify_cache *cache, const char *path, uint64_t slots);
+void verify_cache_close(verify_cache *cache);
+int verify_cache_stat_key(const char *filename, const unsigned char *fingerprint, unsigned char *key);
+void verify_cache_content_key(const unsigned char *data, size_t len, const unsigned char *fingerprint,
+                              unsigned char *key);
+int verify_cache_lookup(verify_cache *cache, const unsigned char *key, verify_status *status);
+int verify_cache_store(verify_cache *cache, const unsigned char *key, verify_status status);
+int signed_file_fingerprint(const char *text, size_t len, unsigned char *fingerprint);
+
+#endif // RSA_SIGN_H
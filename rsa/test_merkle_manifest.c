@@ -0,0 +1,196 @@
+/**
+ * @file test_merkle_manifest.c
+ * @brief Teste do manifesto Merkle: cada mudança no diretório aparece na verificação.
+ *
+ * Assina um diretório, relê o manifesto formatado e compara com o diretório
+ * (merkle_manifest_diff) depois de cada alteração:
+ *  - sem alteração, nenhuma diferença;
+ *  - um arquivo novo, fora do manifesto, aparece como não listado;
+ *  - um arquivo cujo nome tem '\n' ou '\r' (que não cabe numa linha do
+ *    manifesto) aparece como não listado, e o manifesto do diretório não pode
+ *    ser assinado;
+ *  - um arquivo alterado e um removido aparecem como tais.
+ *
+ * Compilação: gcc -O2 -o test_merkle_manifest test_merkle_manifest.c rsa_sign.c -lgmp -pthread
+ * Sai com 0 se todos os casos passarem e 1 caso contrário.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <gmp.h>
+
+#include "rsa_sign.h"
+
+#define TEST_KEY_BITS 2048
+
+static int failures = 0;
+
+/**
+ * @brief Registra e imprime o resultado de um caso.
+ */
+static void check(const char *name, int ok)
+{
+    printf("%-60s %s\n", name, ok ? "ok" : "FALHOU");
+    if (!ok)
+        failures++;
+}
+
+/**
+ * @brief Grava (ou sobrescreve) um arquivo pequeno no diretório de teste.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int write_test_file(const char *dir, const char *name, const char *text)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return 0;
+    int ok = fputs(text, f) >= 0;
+    return fclose(f) == 0 && ok;
+}
+
+/**
+ * @brief Remove um arquivo do diretório de teste.
+ */
+static void remove_test_file(const char *dir, const char *name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    unlink(path);
+}
+
+/**
+ * @brief Diferenças relatadas por merkle_manifest_diff.
+ */
+typedef struct
+{
+    long count;
+    char path[256]; // Caminho da última diferença
+    merkle_diff_kind kind;
+} diff_log;
+
+static void record_diff(void *ctx, const char *path, merkle_diff_kind kind)
+{
+    diff_log *log = (diff_log *)ctx;
+    log->count++;
+    snprintf(log->path, sizeof(log->path), "%s", path);
+    log->kind = kind;
+}
+
+/**
+ * @brief Compara o manifesto com o conteúdo atual do diretório.
+ * @param sign_ok Recebe 1 se o manifesto do diretório atual pôde ser assinado (pode ser NULL).
+ * @return O número de diferenças, ou -1 se o diretório não puder ser lido.
+ */
+static long diff_dir(const merkle_manifest *m, const char *dir, const rsa_key *key, diff_log *log, int *sign_ok)
+{
+    merkle_manifest current;
+    const char *failed;
+    memset(log, 0, sizeof(*log));
+    long differences = -1;
+    if (merkle_manifest_build(&current, dir, 1, &failed))
+    {
+        differences = merkle_manifest_diff(m, &current, record_diff, log);
+        if (sign_ok)
+            *sign_ok = merkle_manifest_sign(&current, key, thread_rng());
+    }
+    merkle_manifest_clear(&current);
+    return differences;
+}
+
+/**
+ * @brief Assina o diretório e relê o manifesto a partir do texto formatado.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int sign_dir(const char *dir, const rsa_key *key, merkle_manifest *parsed)
+{
+    merkle_manifest m;
+    const char *failed;
+    size_t len;
+    char *text = NULL;
+    if (merkle_manifest_build(&m, dir, 2, &failed) && merkle_manifest_sign(&m, key, thread_rng()))
+        text = merkle_manifest_format(&m, &len);
+    merkle_manifest_clear(&m);
+    memset(parsed, 0, sizeof(*parsed));
+    int ok = text && merkle_manifest_parse(text, len, parsed);
+    free(text);
+    return ok;
+}
+
+int main(void)
+{
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!rsa_key_generate(&key, TEST_KEY_BITS, thread_rng(), 1))
+    {
+        fprintf(stderr, "Erro: Não foi possível gerar a chave de teste.\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/test_merkle_manifest_XXXXXX";
+    char sub[sizeof(dir) + 4];
+    int ready = mkdtemp(dir) != NULL;
+    snprintf(sub, sizeof(sub), "%s/sub", dir);
+    if (!ready || mkdir(sub, 0700) != 0 || !write_test_file(dir, "a.txt", "primeiro\n") ||
+        !write_test_file(dir, "sub/b.txt", "segundo\n"))
+    {
+        fprintf(stderr, "Erro: Não foi possível criar o diretório de teste.\n");
+        rsa_key_clear(&key);
+        return 1;
+    }
+
+    merkle_manifest m;
+    int ok = sign_dir(dir, &key, &m);
+    check("manifesto assinado é aceito", ok && m.count == 2 && merkle_manifest_verify(&m, &key) == VERIFY_OK);
+    if (ok)
+    {
+        diff_log log;
+        check("diretório sem alteração não tem diferenças", diff_dir(&m, dir, &key, &log, NULL) == 0);
+
+        write_test_file(dir, "sub/extra.txt", "novo\n");
+        check("arquivo novo aparece como não listado", diff_dir(&m, dir, &key, &log, NULL) == 1 &&
+                                                           log.kind == MERKLE_DIFF_UNLISTED &&
+                                                           strcmp(log.path, "sub/extra.txt") == 0);
+        remove_test_file(dir, "sub/extra.txt");
+
+        int sign_ok = 1;
+        write_test_file(dir, "evil\nx", "novo\n");
+        check("nome com '\\n' aparece como não listado", diff_dir(&m, dir, &key, &log, &sign_ok) == 1 &&
+                                                             log.kind == MERKLE_DIFF_UNLISTED &&
+                                                             strcmp(log.path, "evil\nx") == 0);
+        check("diretório com nome com '\\n' não é assinado", !sign_ok);
+        remove_test_file(dir, "evil\nx");
+
+        sign_ok = 1;
+        write_test_file(dir, "sub/cr\rx", "novo\n");
+        check("nome com '\\r' aparece como não listado", diff_dir(&m, dir, &key, &log, &sign_ok) == 1 &&
+                                                             log.kind == MERKLE_DIFF_UNLISTED &&
+                                                             strcmp(log.path, "sub/cr\rx") == 0);
+        check("diretório com nome com '\\r' não é assinado", !sign_ok);
+        remove_test_file(dir, "sub/cr\rx");
+
+        write_test_file(dir, "a.txt", "alterado\n");
+        check("arquivo alterado aparece como alterado", diff_dir(&m, dir, &key, &log, NULL) == 1 &&
+                                                            log.kind == MERKLE_DIFF_CHANGED &&
+                                                            strcmp(log.path, "a.txt") == 0);
+
+        remove_test_file(dir, "a.txt");
+        check("arquivo removido aparece como ausente", diff_dir(&m, dir, &key, &log, NULL) == 1 &&
+                                                           log.kind == MERKLE_DIFF_MISSING &&
+                                                           strcmp(log.path, "a.txt") == 0);
+    }
+    merkle_manifest_clear(&m);
+
+    remove_test_file(dir, "a.txt");
+    remove_test_file(dir, "sub/b.txt");
+    rmdir(sub);
+    rmdir(dir);
+    rsa_key_clear(&key);
+
+    printf("\n%s (%d falha(s)).\n", failures ? "FALHOU" : "Todos os casos passaram", failures);
+    return failures ? 1 : 0;
+}
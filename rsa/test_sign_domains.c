@@ -0,0 +1,244 @@
+/**
+ * @file test_sign_domains.c
+ * @brief Teste de separação de domínios: a assinatura de um modo não é aceita por outro.
+ *
+ * Cada modo (arquivo assinado simples, manifesto Merkle, índice de blocos)
+ * assina com a sua label OAEP. O teste monta os casos de reaproveitamento entre
+ * modos em que o digest assinado coincide, e confere que só a label impede a
+ * aceitação:
+ *  - a assinatura da raiz de um manifesto (ou de um índice de blocos), colada em
+ *    um arquivo simples cujo conteúdo é exatamente a mensagem que ela assina;
+ *  - a assinatura simples desse conteúdo, colada no manifesto (ou no índice).
+ *
+ * Compilação: gcc -O2 -o test_sign_domains test_sign_domains.c rsa_sign.c -lgmp -pthread
+ * Sai com 0 se todos os casos passarem e 1 caso contrário.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <gmp.h>
+
+#include "rsa_sign.h"
+
+#define TEST_KEY_BITS 2048
+#define MERKLE_MESSAGE_LABEL "segcomp-merkle-manifest-v1" // Prefixo da mensagem assinada pelo manifesto
+#define CHUNK_MESSAGE_LABEL "segcomp-chunked-v1"          // Prefixo da mensagem assinada pelo índice de blocos
+#define TEST_CHUNK_SIZE 999                               // Múltiplo de 3
+
+static int failures = 0;
+
+/**
+ * @brief Registra e imprime o resultado de um caso.
+ */
+static void check(const char *name, int ok)
+{
+    printf("%-60s %s\n", name, ok ? "ok" : "FALHOU");
+    if (!ok)
+        failures++;
+}
+
+/**
+ * @brief Grava um arquivo pequeno no diretório de teste.
+ * @return 1 em sucesso, 0 em falha.
+ */
+static int write_test_file(const char *dir, const char *name, const char *text)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return 0;
+    int ok = fputs(text, f) >= 0;
+    return fclose(f) == 0 && ok;
+}
+
+/**
+ * @brief Mensagem que o manifesto assina: label || contagem (big-endian) || raiz.
+ * @return Tamanho da mensagem escrita em 'out'.
+ */
+static size_t merkle_message(const merkle_manifest *m, unsigned char *out)
+{
+    size_t len = strlen(MERKLE_MESSAGE_LABEL);
+    memcpy(out, MERKLE_MESSAGE_LABEL, len);
+    for (int i = 0; i < 8; i++)
+        out[len++] = ((uint64_t)m->count >> (56 - 8 * i)) & 0xFF;
+    memcpy(out + len, m->root, SHA3_256_DIGEST_SIZE);
+    return len + SHA3_256_DIGEST_SIZE;
+}
+
+/**
+ * @brief Mensagem que o índice de blocos assina: label || tamanho do bloco ||
+ *        tamanho da mensagem (big-endian) || digests dos blocos.
+ * @return Mensagem (liberar com free), ou NULL em falha de alocação.
+ */
+static unsigned char *chunk_message(const chunk_index *idx, size_t *len)
+{
+    size_t label_len = strlen(CHUNK_MESSAGE_LABEL);
+    size_t digests_len = idx->count * SHA3_256_DIGEST_SIZE;
+    unsigned char *out = malloc(label_len + 16 + digests_len);
+    if (!out)
+        return NULL;
+    memcpy(out, CHUNK_MESSAGE_LABEL, label_len);
+    for (int i = 0; i < 8; i++)
+    {
+        out[label_len + i] = (idx->chunk_size >> (56 - 8 * i)) & 0xFF;
+        out[label_len + 8 + i] = (idx->content_len >> (56 - 8 * i)) & 0xFF;
+    }
+    memcpy(out + label_len + 16, idx->digests, digests_len);
+    *len = label_len + 16 + digests_len;
+    return out;
+}
+
+/**
+ * @brief Assina 'content' como arquivo simples e devolve a assinatura decodificada.
+ * @return Assinatura (liberar com free), ou NULL em falha.
+ */
+static unsigned char *plain_signature(const rsa_key *key, const unsigned char *content, size_t len,
+                                      size_t *signature_len)
+{
+    size_t text_len;
+    char *text = rsa_sign_message(key, content, len, thread_rng(), &text_len);
+    signed_message msg;
+    if (!text || !signed_file_parse(text, text_len, &msg))
+    {
+        free(text);
+        return NULL;
+    }
+    unsigned char *signature = msg.signature;
+    *signature_len = msg.signature_len;
+    msg.signature = NULL;
+    signed_message_clear(&msg);
+    free(text);
+    return signature;
+}
+
+/**
+ * @brief Casos entre o arquivo simples e o manifesto Merkle.
+ */
+static void test_merkle_domain(const rsa_key *key, const char *dir)
+{
+    merkle_manifest m;
+    const char *failed_path = NULL;
+    int ok = merkle_manifest_build(&m, dir, 1, &failed_path) && merkle_manifest_sign(&m, key, thread_rng());
+    check("manifesto assinado é aceito como manifesto", ok && merkle_manifest_verify(&m, key) == VERIFY_OK);
+    if (!ok)
+        return;
+
+    unsigned char content[64 + SHA3_256_DIGEST_SIZE];
+    size_t content_len = merkle_message(&m, content);
+
+    // Assinatura do manifesto apresentada como a de um arquivo simples
+    signed_message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.content = content;
+    msg.content_len = content_len;
+    msg.signature = m.signature;
+    msg.signature_len = m.signature_len;
+    check("assinatura do manifesto é rejeitada como arquivo simples", rsa_verify_message(key, &msg) != VERIFY_OK);
+
+    // Assinatura simples da mesma mensagem apresentada como a do manifesto
+    size_t plain_len = 0;
+    unsigned char *plain = plain_signature(key, content, content_len, &plain_len);
+    msg.signature = plain;
+    msg.signature_len = plain_len;
+    check("assinatura simples é aceita como arquivo simples", plain && rsa_verify_message(key, &msg) == VERIFY_OK);
+
+    unsigned char *manifest_signature = m.signature;
+    size_t manifest_signature_len = m.signature_len;
+    m.signature = plain;
+    m.signature_len = plain_len;
+    check("assinatura simples é rejeitada como manifesto", plain && merkle_manifest_verify(&m, key) != VERIFY_OK);
+    m.signature = manifest_signature;
+    m.signature_len = manifest_signature_len;
+
+    free(plain);
+    merkle_manifest_clear(&m);
+}
+
+/**
+ * @brief Casos entre o arquivo simples e a assinatura por blocos.
+ */
+static void test_chunk_domain(const rsa_key *key)
+{
+    unsigned char content[4000];
+    for (size_t i = 0; i < sizeof(content); i++)
+        content[i] = (unsigned char)(i * 31 + 7);
+
+    size_t text_len;
+    char *text = rsa_sign_message_chunked(key, content, sizeof(content), TEST_CHUNK_SIZE, 1, thread_rng(), &text_len);
+    signed_message chunked;
+    int ok = text && signed_file_parse(text, text_len, &chunked);
+    free(text);
+    check("assinatura por blocos é aceita", ok && rsa_verify_message(key, &chunked) == VERIFY_OK);
+    if (!ok)
+        return;
+
+    size_t forged_len = 0;
+    unsigned char *forged = chunk_message(&chunked.chunks, &forged_len);
+
+    // Assinatura do índice apresentada como a de um arquivo simples
+    signed_message msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.content = forged;
+    msg.content_len = forged_len;
+    msg.signature = chunked.signature;
+    msg.signature_len = chunked.signature_len;
+    check("assinatura do índice é rejeitada como arquivo simples",
+          forged && rsa_verify_message(key, &msg) != VERIFY_OK);
+
+    // Assinatura simples da mesma mensagem apresentada como a do índice
+    size_t plain_len = 0;
+    unsigned char *plain = forged ? plain_signature(key, forged, forged_len, &plain_len) : NULL;
+    msg.signature = plain;
+    msg.signature_len = plain_len;
+    check("assinatura simples do índice é aceita como arquivo simples",
+          plain && rsa_verify_message(key, &msg) == VERIFY_OK);
+
+    unsigned char *chunk_signature = chunked.signature;
+    size_t chunk_signature_len = chunked.signature_len;
+    chunked.signature = plain;
+    chunked.signature_len = plain_len;
+    check("assinatura simples é rejeitada como índice de blocos",
+          plain && rsa_verify_chunk_index(key, &chunked) != VERIFY_OK);
+    chunked.signature = chunk_signature;
+    chunked.signature_len = chunk_signature_len;
+
+    free(plain);
+    free(forged);
+    signed_message_clear(&chunked);
+}
+
+int main(void)
+{
+    rsa_key key;
+    rsa_key_init(&key);
+    if (!rsa_key_generate(&key, TEST_KEY_BITS, thread_rng(), 1))
+    {
+        fprintf(stderr, "Erro: Não foi possível gerar a chave de teste.\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/test_sign_domains_XXXXXX";
+    if (!mkdtemp(dir) || !write_test_file(dir, "a.txt", "primeiro\n") || !write_test_file(dir, "b.txt", "segundo\n"))
+    {
+        fprintf(stderr, "Erro: Não foi possível criar o diretório de teste.\n");
+        rsa_key_clear(&key);
+        return 1;
+    }
+
+    test_merkle_domain(&key, dir);
+    test_chunk_domain(&key);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/a.txt", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/b.txt", dir);
+    unlink(path);
+    rmdir(dir);
+    rsa_key_clear(&key);
+
+    printf("\n%s (%d falha(s)).\n", failures ? "FALHOU" : "Todos os casos passaram", failures);
+    return failures ? 1 : 0;
+}